@@ -0,0 +1,348 @@
+/**
+ * @file stack_bench.c
+ *
+ * @brief Benchmarks for the core stack operations.
+ *
+ * Measures push, pop, peek, clear, clone, reverse, to_array and contains for
+ * a range of element counts, element sizes and storage modes (pointer
+ * stacks, inline stacks and arena stacks). Every result is printed as one CSV
+ * line with the time per operation, throughput, allocations per operation
+ * and the peak resident set size of the process so far.
+ *
+ * Allocations are counted through the StackAllocator hooks and the element
+ * copy function; the array returned by to_array() comes straight from malloc()
+ * and is not counted. Operations timed as a single call (reverse, clone,
+ * to_array and clear) are run SINGLE_SHOT_RUNS times and report the median.
+ *
+ * Usage: stack_bench [max_count] [repetitions]
+ *
+ * Counts run in powers of ten from 10 up to max_count (default 1000000).
+ *
+ * @author trigologiaa
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "../stack.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+/**
+ * Number of lookups timed by the contains benchmark.
+ */
+#define CONTAINS_LOOKUPS 16
+
+/**
+ * Number of times each single-call operation is timed.
+ */
+#define SINGLE_SHOT_RUNS 5
+
+/**
+ * Largest element size exercised, in bytes.
+ */
+#define MAX_ELEMENT_SIZE 64
+
+/**
+ * @enum Mode
+ *
+ * @brief Storage modes under test.
+ */
+typedef enum Mode {
+  MODE_POINTER, // Pointer stack with malloc'd element copies.
+  MODE_INLINE,  // Inline stack storing elements by value.
+  MODE_ARENA,   // Pointer stack with element copies in the stack arena.
+} Mode;
+
+/**
+ * Names printed for each mode.
+ */
+static const char *const mode_names[] = {"pointer", "inline", "arena"};
+
+/**
+ * Element sizes exercised for every mode.
+ */
+static const size_t element_sizes[] = {8, 64};
+
+/**
+ * Number of allocations made through the counting hooks.
+ */
+static size_t allocations;
+
+/**
+ * Size of the elements copied by the copy functions.
+ */
+static size_t current_size;
+
+/**
+ * @brief Counting allocation hook.
+ */
+static void *count_alloc(void *ctx, size_t size) {
+  (void)ctx;
+  ++allocations;
+  return malloc(size);
+}
+
+/**
+ * @brief Counting reallocation hook.
+ */
+static void *count_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+  (void)ctx;
+  (void)old_size;
+  ++allocations;
+  return realloc(ptr, new_size);
+}
+
+/**
+ * @brief Release hook matching the counting allocator.
+ */
+static void count_free(void *ctx, void *ptr, size_t size) {
+  (void)ctx;
+  (void)size;
+  free(ptr);
+}
+
+/**
+ * Allocator counting every buffer, header and arena allocation.
+ */
+static const StackAllocator counting_allocator = {count_alloc, count_realloc, count_free, NULL};
+
+/**
+ * @brief Copies an element with malloc, counting the allocation.
+ */
+static void *copy_element(const void *element) {
+  ++allocations;
+  void *copy = malloc(current_size);
+  if (copy) {
+    memcpy(copy, element, current_size);
+  }
+  return copy;
+}
+
+/**
+ * @brief Copies an element into the stack arena.
+ */
+static void *copy_to_arena(const void *element, StackArena *arena) {
+  void *copy = arena_alloc(arena, current_size);
+  if (copy) {
+    memcpy(copy, element, current_size);
+  }
+  return copy;
+}
+
+/**
+ * @brief Compares the first bytes of two elements.
+ */
+static int compare_elements(const void *a, const void *b) {
+  return memcmp(a, b, current_size);
+}
+
+/**
+ * @brief Returns the current monotonic time in nanoseconds.
+ */
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/**
+ * @brief Orders two timings for qsort().
+ */
+static int compare_times(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+/**
+ * @brief Returns the median of SINGLE_SHOT_RUNS timings, reordering them.
+ */
+static double median(double *times) {
+  qsort(times, SINGLE_SHOT_RUNS, sizeof(double), compare_times);
+  return times[SINGLE_SHOT_RUNS / 2];
+}
+
+/**
+ * @brief Returns the peak resident set size of the process in kilobytes.
+ */
+static long peak_rss_kb(void) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+/**
+ * @brief Creates an empty stack for a mode and element size.
+ */
+static Stack *make_stack(Mode mode, size_t elem_size) {
+  StackOptions options = {0};
+  options.allocator = &counting_allocator;
+  options.cmp_func = compare_elements;
+  current_size = elem_size;
+  if (mode == MODE_INLINE) {
+    options.element_size = elem_size;
+  } else {
+    options.copy_func = copy_element;
+    options.free_func = free;
+    if (mode == MODE_ARENA) {
+      options.arena_copy_func = copy_to_arena;
+    }
+  }
+  return new_stack_with_options(&options);
+}
+
+/**
+ * @brief Prints one result line.
+ */
+static void report(const char *op, Mode mode, size_t elem_size, size_t count, double ns,
+                   size_t ops, size_t allocs) {
+  double per_op = ops ? ns / (double)ops : 0.0;
+  printf("%s,%s,%zu,%zu,%.2f,%.0f,%.4f,%ld\n", op, mode_names[mode], elem_size, count, per_op,
+         per_op > 0.0 ? 1e9 / per_op : 0.0, ops ? (double)allocs / (double)ops : 0.0,
+         peak_rss_kb());
+  fflush(stdout);
+}
+
+/**
+ * @brief Fills a new stack with count elements.
+ */
+static Stack *filled_stack(Mode mode, size_t elem_size, size_t count,
+                           const unsigned char *element) {
+  Stack *stack = make_stack(mode, elem_size);
+  for (size_t i = 0; stack && i < count; ++i) {
+    if (!push(stack, element)) {
+      free_stack(stack);
+      return NULL;
+    }
+  }
+  return stack;
+}
+
+/**
+ * @brief Runs every benchmark for one configuration.
+ *
+ * @return 0 on success, 1 if a stack could not be built.
+ */
+static int run(Mode mode, size_t elem_size, size_t count) {
+  unsigned char element[MAX_ELEMENT_SIZE] = {1};
+  unsigned char missing[MAX_ELEMENT_SIZE] = {2};
+  Stack *stack = make_stack(mode, elem_size);
+  if (!stack) {
+    return 1;
+  }
+  allocations = 0;
+  double start = now_ns();
+  for (size_t i = 0; i < count; ++i) {
+    if (!push(stack, element)) {
+      free_stack(stack);
+      return 1;
+    }
+  }
+  report("push", mode, elem_size, count, now_ns() - start, count, allocations);
+
+  void *volatile sink = NULL;
+  allocations = 0;
+  start = now_ns();
+  for (size_t i = 0; i < count; ++i) {
+    sink = peek(stack);
+  }
+  report("peek", mode, elem_size, count, now_ns() - start, count, allocations);
+  (void)sink;
+
+  double times[SINGLE_SHOT_RUNS];
+  for (int sample = 0; sample < SINGLE_SHOT_RUNS; ++sample) {
+    allocations = 0;
+    start = now_ns();
+    reverse(stack);
+    times[sample] = now_ns() - start;
+  }
+  report("reverse", mode, elem_size, count, median(times), count, allocations);
+
+  allocations = 0;
+  start = now_ns();
+  for (size_t i = 0; i < CONTAINS_LOOKUPS; ++i) {
+    if (contains(stack, missing)) {
+      break;
+    }
+  }
+  report("contains", mode, elem_size, count, now_ns() - start, CONTAINS_LOOKUPS, allocations);
+
+  for (int sample = 0; sample < SINGLE_SHOT_RUNS; ++sample) {
+    allocations = 0;
+    start = now_ns();
+    Stack *copy = clone(stack);
+    times[sample] = now_ns() - start;
+    free_stack(copy);
+  }
+  report("clone", mode, elem_size, count, median(times), count, allocations);
+
+  if (mode != MODE_ARENA) {
+    for (int sample = 0; sample < SINGLE_SHOT_RUNS; ++sample) {
+      allocations = 0;
+      start = now_ns();
+      size_t n = 0;
+      void **array = to_array(stack, &n);
+      times[sample] = now_ns() - start;
+      for (size_t i = 0; mode == MODE_POINTER && i < n; ++i) {
+        free(array[i]);
+      }
+      free(array);
+    }
+    report("to_array", mode, elem_size, count, median(times), count, allocations);
+  }
+
+  allocations = 0;
+  start = now_ns();
+  for (size_t i = 0; i < count; ++i) {
+    void *popped = pop(stack);
+    if (mode == MODE_POINTER) {
+      free(popped);
+    }
+  }
+  report("pop", mode, elem_size, count, now_ns() - start, count, allocations);
+  free_stack(stack);
+
+  for (int sample = 0; sample < SINGLE_SHOT_RUNS; ++sample) {
+    stack = filled_stack(mode, elem_size, count, element);
+    if (!stack) {
+      return 1;
+    }
+    allocations = 0;
+    start = now_ns();
+    clear(stack);
+    times[sample] = now_ns() - start;
+    free_stack(stack);
+  }
+  report("clear", mode, elem_size, count, median(times), count, allocations);
+  return 0;
+}
+
+/**
+ * @brief Runs the benchmark matrix.
+ *
+ * @param argc Argument count.
+ * @param argv Optional maximum element count and number of repetitions.
+ *
+ * @return 0 on success, 1 on failure.
+ */
+int main(int argc, char **argv) {
+  size_t max_count = argc > 1 ? strtoull(argv[1], NULL, 10) : 1000000;
+  int repetitions = argc > 2 ? atoi(argv[2]) : 1;
+  printf("op,mode,element_size,count,ns_per_op,ops_per_sec,allocs_per_op,peak_rss_kb\n");
+  for (int rep = 0; rep < repetitions; ++rep) {
+    for (size_t count = 10; count <= max_count; count *= 10) {
+      for (int mode = MODE_POINTER; mode <= MODE_ARENA; ++mode) {
+        for (size_t i = 0; i < sizeof(element_sizes) / sizeof(element_sizes[0]); ++i) {
+          if (run((Mode)mode, element_sizes[i], count) != 0) {
+            fprintf(stderr, "allocation failed at count %zu\n", count);
+            return 1;
+          }
+        }
+      }
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,328 @@
+/**
+ * @file blocking_stack.c
+ *
+ * @brief Implementation of a bounded blocking stack.
+ *
+ * This file contains the internal implementation of the BlockingStack defined
+ * in blocking_stack.h. Elements live in an inline Stack protected by a mutex;
+ * two condition variables on CLOCK_MONOTONIC let pushes wait for room and pops
+ * wait for elements, so timeouts are unaffected by wall clock changes. The
+ * optional eventfd is kept equal to the element count under the same mutex.
+ */
+
+// <sched.h>, included by <pthread.h>, declares a GNU clone() that clashes with stack.h.
+#undef _GNU_SOURCE
+#define _POSIX_C_SOURCE 200809L
+
+#include "blocking_stack.h"
+#include "stack.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#endif
+
+/**
+ * @struct BlockingStack
+ *
+ * @brief Internal representation of the blocking stack.
+ */
+struct BlockingStack {
+  pthread_mutex_t lock;     // Protects the other fields.
+  pthread_cond_t not_empty; // Signaled after each push and on close.
+  pthread_cond_t not_full;  // Signaled after each pop and on close.
+  Stack *stack;             // Inline stack holding the elements.
+  size_t capacity;          // Maximum number of elements, or 0.
+  int event_fd;             // Eventfd counting the elements, or -1.
+  bool closed;              // Whether blocking_close() was called.
+};
+
+/**
+ * @brief Computes the absolute CLOCK_MONOTONIC time timeout_ms from now.
+ *
+ * @param deadline Receives the deadline.
+ * @param timeout_ms Positive timeout in milliseconds.
+ */
+static void deadline_after(struct timespec *deadline, long timeout_ms) {
+  clock_gettime(CLOCK_MONOTONIC, deadline);
+  deadline->tv_sec += timeout_ms / 1000;
+  deadline->tv_nsec += (timeout_ms % 1000) * 1000000L;
+  if (deadline->tv_nsec >= 1000000000L) {
+    deadline->tv_sec += 1;
+    deadline->tv_nsec -= 1000000000L;
+  }
+}
+
+/**
+ * @brief Waits on a condition variable until it is signaled or the deadline
+ * passes.
+ *
+ * The lock must be held.
+ *
+ * @param cond Condition variable to wait on.
+ * @param lock Mutex protecting the condition.
+ * @param timeout_ms Timeout the deadline was computed from, 0 or negative.
+ * @param deadline Absolute deadline, used when timeout_ms is positive.
+ *
+ * @return 0 when woken, ETIMEDOUT once the deadline has passed.
+ */
+static int wait_for(pthread_cond_t *cond, pthread_mutex_t *lock, long timeout_ms,
+                    const struct timespec *deadline) {
+  if (timeout_ms == 0) {
+    return ETIMEDOUT;
+  }
+  if (timeout_ms < 0) {
+    return pthread_cond_wait(cond, lock);
+  }
+  return pthread_cond_timedwait(cond, lock, deadline);
+}
+
+/**
+ * @brief Adds delta to the eventfd counter, if there is one.
+ *
+ * A positive delta is written; a negative delta of -1 reads once, which
+ * decrements a semaphore eventfd by one. The lock must be held.
+ *
+ * @param stack Pointer to the BlockingStack.
+ * @param delta 1 after a push, -1 after a pop.
+ */
+static void signal_event(BlockingStack *stack, int delta) {
+  if (stack->event_fd < 0) {
+    return;
+  }
+  uint64_t value = 1;
+  ssize_t done = delta > 0 ? write(stack->event_fd, &value, sizeof(value))
+                           : read(stack->event_fd, &value, sizeof(value));
+  (void)done;
+}
+
+/**
+ * @brief Initializes a new blocking stack structure.
+ *
+ * @param elem_size Size in bytes of each element (must not be 0).
+ * @param capacity Maximum number of elements, or 0 for no limit.
+ *
+ * @return Pointer to the new BlockingStack, or NULL on invalid size or
+ * allocation failure.
+ */
+BlockingStack *new_blocking_stack(size_t elem_size, size_t capacity) {
+  if (elem_size == 0) {
+    return NULL;
+  }
+  BlockingStack *stack = malloc(sizeof(BlockingStack));
+  if (!stack) {
+    return NULL;
+  }
+  StackOptions options = {0};
+  options.element_size = elem_size;
+  options.bound = capacity;
+  stack->stack = new_stack_with_options(&options);
+  if (!stack->stack) {
+    free(stack);
+    return NULL;
+  }
+  pthread_condattr_t attr;
+  bool ok = pthread_condattr_init(&attr) == 0;
+  ok = ok && pthread_condattr_setclock(&attr, CLOCK_MONOTONIC) == 0;
+  bool has_not_empty = ok && pthread_cond_init(&stack->not_empty, &attr) == 0;
+  bool has_not_full = has_not_empty && pthread_cond_init(&stack->not_full, &attr) == 0;
+  bool has_lock = has_not_full && pthread_mutex_init(&stack->lock, NULL) == 0;
+  if (ok) {
+    pthread_condattr_destroy(&attr);
+  }
+  if (!has_lock) {
+    if (has_not_full) {
+      pthread_cond_destroy(&stack->not_full);
+    }
+    if (has_not_empty) {
+      pthread_cond_destroy(&stack->not_empty);
+    }
+    free_stack(stack->stack);
+    free(stack);
+    return NULL;
+  }
+  stack->capacity = capacity;
+  stack->event_fd = -1;
+  stack->closed = false;
+  return stack;
+}
+
+/**
+ * @brief Frees all memory associated with the blocking stack.
+ *
+ * @param stack Pointer to the BlockingStack.
+ */
+void free_blocking_stack(BlockingStack *stack) {
+  if (!stack) {
+    return;
+  }
+  if (stack->event_fd >= 0) {
+    close(stack->event_fd);
+  }
+  pthread_mutex_destroy(&stack->lock);
+  pthread_cond_destroy(&stack->not_full);
+  pthread_cond_destroy(&stack->not_empty);
+  free_stack(stack->stack);
+  free(stack);
+}
+
+/**
+ * @brief Pushes an element, waiting while the stack is full.
+ *
+ * Wakes one waiting pop after the push.
+ *
+ * @param stack Pointer to the BlockingStack.
+ * @param element Pointer to the element to push.
+ * @param timeout_ms Longest wait in milliseconds, 0 not to wait, or
+ * BLOCKING_STACK_FOREVER.
+ *
+ * @return true if the element was pushed, false on timeout, once closed or on
+ * allocation failure.
+ */
+bool blocking_push(BlockingStack *stack, const void *element, long timeout_ms) {
+  if (!stack || !element) {
+    return false;
+  }
+  struct timespec deadline = {0};
+  if (timeout_ms > 0) {
+    deadline_after(&deadline, timeout_ms);
+  }
+  pthread_mutex_lock(&stack->lock);
+  int rc = 0;
+  while (!stack->closed && stack->capacity && size(stack->stack) == stack->capacity &&
+         rc != ETIMEDOUT) {
+    rc = wait_for(&stack->not_full, &stack->lock, timeout_ms, &deadline);
+  }
+  bool pushed = !stack->closed && push(stack->stack, element);
+  if (pushed) {
+    signal_event(stack, 1);
+    pthread_cond_signal(&stack->not_empty);
+  }
+  pthread_mutex_unlock(&stack->lock);
+  return pushed;
+}
+
+/**
+ * @brief Pops the top element, waiting while the stack is empty.
+ *
+ * Wakes one waiting push after the pop.
+ *
+ * @param stack Pointer to the BlockingStack.
+ * @param out Destination buffer for the element.
+ * @param timeout_ms Longest wait in milliseconds, 0 not to wait, or
+ * BLOCKING_STACK_FOREVER.
+ *
+ * @return true if an element was popped, false on timeout or once the stack
+ * is closed and empty.
+ */
+bool blocking_pop(BlockingStack *stack, void *out, long timeout_ms) {
+  if (!stack || !out) {
+    return false;
+  }
+  struct timespec deadline = {0};
+  if (timeout_ms > 0) {
+    deadline_after(&deadline, timeout_ms);
+  }
+  pthread_mutex_lock(&stack->lock);
+  int rc = 0;
+  while (!stack->closed && is_empty(stack->stack) && rc != ETIMEDOUT) {
+    rc = wait_for(&stack->not_empty, &stack->lock, timeout_ms, &deadline);
+  }
+  bool popped = pop_into(stack->stack, out);
+  if (popped) {
+    signal_event(stack, -1);
+    pthread_cond_signal(&stack->not_full);
+  }
+  pthread_mutex_unlock(&stack->lock);
+  return popped;
+}
+
+/**
+ * @brief Pushes an element if the stack is not full, without waiting.
+ *
+ * @param stack Pointer to the BlockingStack.
+ * @param element Pointer to the element to push.
+ *
+ * @return true if the element was pushed, false otherwise.
+ */
+bool blocking_try_push(BlockingStack *stack, const void *element) {
+  return blocking_push(stack, element, 0);
+}
+
+/**
+ * @brief Pops the top element if there is one, without waiting.
+ *
+ * @param stack Pointer to the BlockingStack.
+ * @param out Destination buffer for the element.
+ *
+ * @return true if an element was popped, false if the stack is empty.
+ */
+bool blocking_try_pop(BlockingStack *stack, void *out) {
+  return blocking_pop(stack, out, 0);
+}
+
+/**
+ * @brief Closes the stack and wakes every waiting thread.
+ *
+ * @param stack Pointer to the BlockingStack.
+ */
+void blocking_close(BlockingStack *stack) {
+  if (!stack) {
+    return;
+  }
+  pthread_mutex_lock(&stack->lock);
+  stack->closed = true;
+  pthread_cond_broadcast(&stack->not_empty);
+  pthread_cond_broadcast(&stack->not_full);
+  pthread_mutex_unlock(&stack->lock);
+}
+
+/**
+ * @brief Returns the number of elements in the blocking stack.
+ *
+ * @param stack Pointer to the BlockingStack.
+ *
+ * @return Number of elements.
+ */
+size_t blocking_size(BlockingStack *stack) {
+  if (!stack) {
+    return 0;
+  }
+  pthread_mutex_lock(&stack->lock);
+  size_t count = size(stack->stack);
+  pthread_mutex_unlock(&stack->lock);
+  return count;
+}
+
+/**
+ * @brief Returns an eventfd that is readable while the stack holds elements.
+ *
+ * Created on first use in semaphore mode with the current element count;
+ * every later push adds one and every pop takes one under the lock. Callers
+ * only poll it, so the counter matches the element count.
+ *
+ * @param stack Pointer to the BlockingStack.
+ *
+ * @return The file descriptor, or -1 if eventfd is unavailable.
+ */
+int blocking_event_fd(BlockingStack *stack) {
+  if (!stack) {
+    return -1;
+  }
+  pthread_mutex_lock(&stack->lock);
+#if defined(__linux__)
+  if (stack->event_fd < 0) {
+    size_t count = size(stack->stack);
+    unsigned int initial = count < UINT32_MAX ? (unsigned int)count : UINT32_MAX;
+    stack->event_fd = eventfd(initial, EFD_SEMAPHORE | EFD_NONBLOCK | EFD_CLOEXEC);
+  }
+#endif
+  int fd = stack->event_fd;
+  pthread_mutex_unlock(&stack->lock);
+  return fd;
+}
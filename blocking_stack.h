@@ -0,0 +1,134 @@
+/**
+ * @file blocking_stack.h
+ *
+ * @brief Bounded blocking stack for producer-consumer handoff in C.
+ *
+ * Provides a thread-safe stack of fixed-size elements, built on an inline
+ * Stack from stack.h. Pushes wait while the stack is full and pops wait while
+ * it is empty, each with an optional timeout, so consumers sleep instead of
+ * polling. On Linux an eventfd can signal element availability to epoll or
+ * io_uring event loops.
+ *
+ * @author trigologiaa
+ */
+
+#ifndef BLOCKING_STACK_H
+
+#define BLOCKING_STACK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Timeout value that waits without limit.
+ */
+#define BLOCKING_STACK_FOREVER (-1L)
+
+/**
+ * @typedef BlockingStack
+ *
+ * @brief Opaque struct representing a blocking stack.
+ */
+typedef struct BlockingStack BlockingStack;
+
+/**
+ * @brief Creates a new blocking stack.
+ *
+ * @param elem_size Size in bytes of each element (must not be 0).
+ * @param capacity Maximum number of elements, or 0 for no limit.
+ *
+ * @return Pointer to the new BlockingStack, or NULL on invalid size or
+ * allocation failure.
+ */
+BlockingStack *new_blocking_stack(size_t elem_size, size_t capacity);
+
+/**
+ * @brief Frees all memory associated with the blocking stack.
+ *
+ * No thread may be waiting on the stack.
+ *
+ * @param stack Pointer to the BlockingStack.
+ */
+void free_blocking_stack(BlockingStack *stack);
+
+/**
+ * @brief Pushes an element, waiting while the stack is full.
+ *
+ * @param stack Pointer to the BlockingStack.
+ * @param element Pointer to the element (elem_size bytes) to push.
+ * @param timeout_ms Longest wait in milliseconds, 0 not to wait, or
+ * BLOCKING_STACK_FOREVER.
+ *
+ * @return true if the element was pushed, false on timeout, after
+ * blocking_close() or on allocation failure.
+ */
+bool blocking_push(BlockingStack *stack, const void *element, long timeout_ms);
+
+/**
+ * @brief Pops the top element, waiting while the stack is empty.
+ *
+ * @param stack Pointer to the BlockingStack.
+ * @param out Destination buffer of elem_size bytes.
+ * @param timeout_ms Longest wait in milliseconds, 0 not to wait, or
+ * BLOCKING_STACK_FOREVER.
+ *
+ * @return true if an element was popped, false on timeout or once the stack
+ * is closed and empty.
+ */
+bool blocking_pop(BlockingStack *stack, void *out, long timeout_ms);
+
+/**
+ * @brief Pushes an element if the stack is not full, without waiting.
+ *
+ * @param stack Pointer to the BlockingStack.
+ * @param element Pointer to the element (elem_size bytes) to push.
+ *
+ * @return true if the element was pushed, false otherwise.
+ */
+bool blocking_try_push(BlockingStack *stack, const void *element);
+
+/**
+ * @brief Pops the top element if there is one, without waiting.
+ *
+ * @param stack Pointer to the BlockingStack.
+ * @param out Destination buffer of elem_size bytes.
+ *
+ * @return true if an element was popped, false if the stack is empty.
+ */
+bool blocking_try_pop(BlockingStack *stack, void *out);
+
+/**
+ * @brief Closes the stack and wakes every waiting thread.
+ *
+ * Later pushes fail; pops still return the remaining elements.
+ *
+ * @param stack Pointer to the BlockingStack.
+ */
+void blocking_close(BlockingStack *stack);
+
+/**
+ * @brief Returns the number of elements in the blocking stack.
+ *
+ * @param stack Pointer to the BlockingStack.
+ *
+ * @return Number of elements at the time of the call.
+ */
+size_t blocking_size(BlockingStack *stack);
+
+/**
+ * @brief Returns an eventfd that is readable while the stack holds elements.
+ *
+ * The eventfd is created on first use and counts the elements in semaphore
+ * mode. Register it with epoll, poll or io_uring and call blocking_try_pop()
+ * when it becomes readable. Callers must only poll the descriptor and never
+ * read, write or close it: the stack keeps the counter equal to the element
+ * count itself, and a read or write by the caller makes the two drift apart
+ * for the lifetime of the stack. It is closed by free_blocking_stack().
+ *
+ * @param stack Pointer to the BlockingStack.
+ *
+ * @return The file descriptor, or -1 if eventfd is unavailable.
+ */
+int blocking_event_fd(BlockingStack *stack);
+
+#endif
@@ -0,0 +1,323 @@
+/**
+ * @file concurrent_stack.c
+ *
+ * @brief Implementation of a lock-free concurrent stack.
+ *
+ * This file contains the internal implementation of the ConcurrentStack
+ * defined in concurrent_stack.h. It is a Treiber stack whose nodes live in a
+ * pool of chunks that are never freed while the stack is alive. Nodes are
+ * referenced by 32-bit indices, leaving the upper half of each 64-bit head for
+ * a tag that is incremented on every update, which defeats ABA without double
+ * width compare-and-swap or deferred reclamation.
+ */
+
+#include "concurrent_stack.h"
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * Number of nodes in the first pool chunk. Each further chunk doubles.
+ */
+#define FIRST_CHUNK_SHIFT 6
+
+/**
+ * Maximum number of pool chunks, enough for 2^32 - 2 nodes.
+ */
+#define MAX_CHUNKS 27
+
+/**
+ * Largest node reference; references are index + 1 so that 0 means none.
+ */
+#define MAX_REF UINT32_MAX
+
+/**
+ * Assumed size of a cache line, used to keep hot fields apart.
+ */
+#define CACHE_LINE 64
+
+/**
+ * @struct Node
+ *
+ * @brief One pool node holding an element pointer.
+ */
+typedef struct Node {
+  void *element;         // Element owned by the node while it is on the stack.
+  _Atomic uint32_t next; // Reference of the next node, or 0.
+} Node;
+
+/**
+ * @struct ConcurrentStack
+ *
+ * @brief Internal representation of the concurrent stack.
+ *
+ * head and free_list are tagged references: the low 32 bits hold a node
+ * reference and the high 32 bits a counter bumped on every successful update.
+ * Popped nodes go to free_list and are reused by later pushes.
+ */
+struct ConcurrentStack {
+  alignas(CACHE_LINE) _Atomic uint64_t head;      // Tagged top node.
+  alignas(CACHE_LINE) _Atomic uint64_t free_list; // Tagged free nodes.
+  alignas(CACHE_LINE) _Atomic size_t size;        // Elements pushed or being pushed.
+  _Atomic uint64_t next_unused;                   // First never used node index.
+  _Atomic(Node *) chunks[MAX_CHUNKS];             // Node pool chunks.
+  StackCopyFunc copy;                             // Function to copy elements.
+  StackFreeFunc free_func;                        // Function to free elements.
+};
+
+/**
+ * @brief Returns the node for a reference.
+ *
+ * The chunk holding the node must already be allocated.
+ *
+ * @param stack Pointer to the ConcurrentStack.
+ * @param ref Node reference (index + 1, not 0).
+ *
+ * @return Pointer to the node.
+ */
+static Node *node_at(ConcurrentStack *stack, uint32_t ref) {
+  uint64_t biased = (uint64_t)(ref - 1) + (1u << FIRST_CHUNK_SHIFT);
+  int bit = 63 - __builtin_clzll(biased);
+  int chunk = bit - FIRST_CHUNK_SHIFT;
+  Node *nodes = atomic_load_explicit(&stack->chunks[chunk], memory_order_acquire);
+  return &nodes[biased - (UINT64_C(1) << bit)];
+}
+
+/**
+ * @brief Pushes a node onto a tagged list.
+ *
+ * @param stack Pointer to the ConcurrentStack.
+ * @param list Tagged list head.
+ * @param ref Reference of the node to push.
+ */
+static void list_push(ConcurrentStack *stack, _Atomic uint64_t *list, uint32_t ref) {
+  Node *node = node_at(stack, ref);
+  uint64_t old = atomic_load_explicit(list, memory_order_relaxed);
+  uint64_t new_head;
+  do {
+    atomic_store_explicit(&node->next, (uint32_t)old, memory_order_relaxed);
+    new_head = ((old >> 32) + 1) << 32 | ref;
+  } while (!atomic_compare_exchange_weak_explicit(list, &old, new_head, memory_order_release,
+                                                  memory_order_relaxed));
+}
+
+/**
+ * @brief Pops a node from a tagged list.
+ *
+ * The node may be recycled by another thread between reading its next link
+ * and the compare-and-swap; the tag makes that compare-and-swap fail.
+ *
+ * @param stack Pointer to the ConcurrentStack.
+ * @param list Tagged list head.
+ *
+ * @return Reference of the popped node, or 0 if the list is empty.
+ */
+static uint32_t list_pop(ConcurrentStack *stack, _Atomic uint64_t *list) {
+  uint64_t old = atomic_load_explicit(list, memory_order_acquire);
+  uint64_t new_head;
+  do {
+    uint32_t ref = (uint32_t)old;
+    if (ref == 0) {
+      return 0;
+    }
+    uint32_t next = atomic_load_explicit(&node_at(stack, ref)->next, memory_order_relaxed);
+    new_head = ((old >> 32) + 1) << 32 | next;
+  } while (!atomic_compare_exchange_weak_explicit(list, &old, new_head, memory_order_acquire,
+                                                  memory_order_acquire));
+  return (uint32_t)old;
+}
+
+/**
+ * @brief Takes a node from the free list or from the unused part of the pool.
+ *
+ * Allocates a new pool chunk when the first node of a chunk is handed out.
+ *
+ * @param stack Pointer to the ConcurrentStack.
+ *
+ * @return Reference of the node, or 0 on allocation failure.
+ */
+static uint32_t alloc_node(ConcurrentStack *stack) {
+  uint32_t ref = list_pop(stack, &stack->free_list);
+  if (ref) {
+    return ref;
+  }
+  uint64_t index = atomic_fetch_add_explicit(&stack->next_unused, 1, memory_order_relaxed);
+  if (index >= MAX_REF) {
+    return 0;
+  }
+  uint64_t biased = index + (1u << FIRST_CHUNK_SHIFT);
+  int bit = 63 - __builtin_clzll(biased);
+  int chunk = bit - FIRST_CHUNK_SHIFT;
+  if (!atomic_load_explicit(&stack->chunks[chunk], memory_order_acquire)) {
+    Node *nodes = calloc((size_t)1 << bit, sizeof(Node));
+    if (!nodes) {
+      return 0;
+    }
+    Node *expected = NULL;
+    if (!atomic_compare_exchange_strong_explicit(&stack->chunks[chunk], &expected, nodes,
+                                                 memory_order_acq_rel, memory_order_acquire)) {
+      free(nodes);
+    }
+  }
+  return (uint32_t)(index + 1);
+}
+
+/**
+ * @brief Initializes a new concurrent stack structure.
+ *
+ * No nodes are allocated until the first push.
+ *
+ * @param copy_func Function to copy elements (may be NULL).
+ * @param free_func Function to free elements (may be NULL).
+ *
+ * @return Pointer to the new ConcurrentStack, or NULL on allocation failure.
+ */
+ConcurrentStack *new_concurrent_stack(StackCopyFunc copy_func, StackFreeFunc free_func) {
+  ConcurrentStack *stack = aligned_alloc(_Alignof(ConcurrentStack), sizeof(ConcurrentStack));
+  if (!stack) {
+    return NULL;
+  }
+  atomic_init(&stack->head, 0);
+  atomic_init(&stack->free_list, 0);
+  atomic_init(&stack->size, 0);
+  atomic_init(&stack->next_unused, 0);
+  for (size_t i = 0; i < MAX_CHUNKS; ++i) {
+    atomic_init(&stack->chunks[i], NULL);
+  }
+  stack->copy = copy_func;
+  stack->free_func = free_func;
+  return stack;
+}
+
+/**
+ * @brief Frees all memory associated with the concurrent stack.
+ *
+ * Calls free_func for each remaining element, then releases the node pool.
+ *
+ * @param stack Pointer to the ConcurrentStack.
+ */
+void free_concurrent_stack(ConcurrentStack *stack) {
+  if (!stack) {
+    return;
+  }
+  uint32_t ref = (uint32_t)atomic_load_explicit(&stack->head, memory_order_acquire);
+  while (ref && stack->free_func) {
+    Node *node = node_at(stack, ref);
+    stack->free_func(node->element);
+    ref = atomic_load_explicit(&node->next, memory_order_relaxed);
+  }
+  for (size_t i = 0; i < MAX_CHUNKS; ++i) {
+    free(atomic_load_explicit(&stack->chunks[i], memory_order_relaxed));
+  }
+  free(stack);
+}
+
+/**
+ * @brief Pushes a copy of an element onto the concurrent stack.
+ *
+ * The element is copied using the user-supplied copy function.
+ *
+ * @param stack Pointer to the ConcurrentStack.
+ * @param element Pointer to the element to push.
+ *
+ * @return true if the element was pushed, false otherwise.
+ */
+bool concurrent_push(ConcurrentStack *stack, const void *element) {
+  if (!stack || !stack->copy) {
+    return false;
+  }
+  void *copy = stack->copy(element);
+  if (!copy) {
+    return false;
+  }
+  if (!concurrent_push_owned(stack, copy)) {
+    if (stack->free_func) {
+      stack->free_func(copy);
+    }
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Pushes an element onto the concurrent stack, taking ownership of it.
+ *
+ * size is incremented before the node is published: the release on head
+ * then orders the increment before the decrement of whichever pop takes the
+ * node, so size never drops below zero.
+ *
+ * @param stack Pointer to the ConcurrentStack.
+ * @param element Pointer to the element to push.
+ *
+ * @return true if the element was pushed, false on allocation failure.
+ */
+bool concurrent_push_owned(ConcurrentStack *stack, void *element) {
+  if (!stack) {
+    return false;
+  }
+  uint32_t ref = alloc_node(stack);
+  if (!ref) {
+    return false;
+  }
+  node_at(stack, ref)->element = element;
+  atomic_fetch_add_explicit(&stack->size, 1, memory_order_relaxed);
+  list_push(stack, &stack->head, ref);
+  return true;
+}
+
+/**
+ * @brief Removes and returns the top element of the concurrent stack.
+ *
+ * The node that held the element is recycled through the free list.
+ *
+ * @param stack Pointer to the ConcurrentStack.
+ *
+ * @return Pointer to the removed element. Caller must free it. Returns NULL
+ * if the stack is empty.
+ */
+void *concurrent_pop(ConcurrentStack *stack) {
+  if (!stack) {
+    return NULL;
+  }
+  uint32_t ref = list_pop(stack, &stack->head);
+  if (!ref) {
+    return NULL;
+  }
+  atomic_fetch_sub_explicit(&stack->size, 1, memory_order_relaxed);
+  void *element = node_at(stack, ref)->element;
+  list_push(stack, &stack->free_list, ref);
+  return element;
+}
+
+/**
+ * @brief Checks if the concurrent stack has no elements.
+ *
+ * @param stack Pointer to the ConcurrentStack.
+ *
+ * @return true if empty, false otherwise.
+ */
+bool concurrent_is_empty(const ConcurrentStack *stack) {
+  if (!stack) {
+    return true;
+  }
+  return (uint32_t)atomic_load_explicit(&stack->head, memory_order_acquire) == 0;
+}
+
+/**
+ * @brief Returns the number of elements in the concurrent stack.
+ *
+ * The count is kept apart from head, so it is a hint while other threads
+ * push or pop: it may include pushes still in progress, but never wraps
+ * below zero.
+ *
+ * @param stack Pointer to the ConcurrentStack.
+ *
+ * @return Number of elements.
+ */
+size_t concurrent_size(const ConcurrentStack *stack) {
+  if (!stack) {
+    return 0;
+  }
+  return atomic_load_explicit(&stack->size, memory_order_relaxed);
+}
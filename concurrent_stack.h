@@ -0,0 +1,117 @@
+/**
+ * @file concurrent_stack.h
+ *
+ * @brief Lock-free concurrent stack (Treiber stack) in C.
+ *
+ * Provides a stack that any number of threads may push to and pop from
+ * concurrently without locks. Push and pop are single compare-and-swap
+ * operations on a tagged head, which protects against the ABA problem.
+ *
+ * Element ownership follows stack.h: push copies the element with the
+ * user-supplied StackCopyFunc (which must be thread-safe), pop hands the
+ * element to the caller, and StackFreeFunc releases whatever is left when the
+ * stack is freed.
+ *
+ * @author trigologiaa
+ */
+
+#ifndef CONCURRENT_STACK_H
+
+#define CONCURRENT_STACK_H
+
+#include "stack.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @typedef ConcurrentStack
+ *
+ * @brief Opaque struct representing a lock-free concurrent stack.
+ */
+typedef struct ConcurrentStack ConcurrentStack;
+
+/**
+ * @brief Creates a new concurrent stack.
+ *
+ * @param copy_func Function to copy elements (may be NULL for a move-only
+ * stack filled with concurrent_push_owned()).
+ * @param free_func Function to free elements (may be NULL).
+ *
+ * @return Pointer to the new ConcurrentStack, or NULL on allocation failure.
+ */
+ConcurrentStack *new_concurrent_stack(StackCopyFunc copy_func, StackFreeFunc free_func);
+
+/**
+ * @brief Frees all memory associated with the concurrent stack.
+ *
+ * Calls free_func for each remaining element. No other thread may use the
+ * stack concurrently.
+ *
+ * @param stack Pointer to the ConcurrentStack.
+ */
+void free_concurrent_stack(ConcurrentStack *stack);
+
+/**
+ * @brief Pushes a copy of an element onto the concurrent stack.
+ *
+ * Lock-free. Safe to call from any thread.
+ *
+ * @param stack Pointer to the ConcurrentStack.
+ * @param element Pointer to the element to push.
+ *
+ * @return true if the element was pushed, false on allocation failure or for
+ * move-only stacks.
+ */
+bool concurrent_push(ConcurrentStack *stack, const void *element);
+
+/**
+ * @brief Pushes an element onto the concurrent stack, taking ownership of it.
+ *
+ * copy_func is not called. Lock-free. Safe to call from any thread.
+ *
+ * @param stack Pointer to the ConcurrentStack.
+ * @param element Pointer to the element to push.
+ *
+ * @return true if the element was pushed, false on allocation failure (the
+ * caller then still owns element).
+ */
+bool concurrent_push_owned(ConcurrentStack *stack, void *element);
+
+/**
+ * @brief Removes and returns the top element of the concurrent stack.
+ *
+ * Lock-free. Safe to call from any thread.
+ *
+ * @param stack Pointer to the ConcurrentStack.
+ *
+ * @return Pointer to the removed element. Caller must free it. Returns NULL
+ * if the stack is empty.
+ */
+void *concurrent_pop(ConcurrentStack *stack);
+
+/**
+ * @brief Checks if the concurrent stack is empty.
+ *
+ * The answer may be stale by the time it is returned if other threads are
+ * pushing or popping.
+ *
+ * @param stack Pointer to the ConcurrentStack.
+ *
+ * @return true if empty, false otherwise.
+ */
+bool concurrent_is_empty(const ConcurrentStack *stack);
+
+/**
+ * @brief Returns the number of elements in the concurrent stack.
+ *
+ * Only a hint while other threads are pushing or popping: the count may
+ * already include pushes that have not completed, but it is never below zero
+ * and is exact once the stack is quiescent.
+ *
+ * @param stack Pointer to the ConcurrentStack.
+ *
+ * @return Number of elements.
+ */
+size_t concurrent_size(const ConcurrentStack *stack);
+
+#endif
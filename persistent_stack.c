@@ -0,0 +1,264 @@
+/**
+ * @file persistent_stack.c
+ *
+ * @brief Implementation of a persistent stack.
+ *
+ * This file contains the internal implementation of the PersistentStack
+ * defined in persistent_stack.h. Each version is the top node of a cons list;
+ * a node holds a reference to the node below it, so releasing the last
+ * reference to a version walks down its list until it reaches a node that is
+ * still shared. Nodes are carved from chunks and recycled through a free
+ * list.
+ */
+
+#include "persistent_stack.h"
+#include <stdlib.h>
+
+/**
+ * Number of nodes allocated per pool chunk.
+ */
+#define PERSISTENT_POOL_CHUNK 256
+
+/**
+ * @struct PersistentStack
+ *
+ * @brief One node of the shared cons list.
+ */
+struct PersistentStack {
+  PersistentStack *next; // Node below, or next free node while pooled.
+  void *element;         // Element owned by the node.
+  size_t refs;           // Number of references to this node.
+  size_t size;           // Number of elements from this node down.
+};
+
+/**
+ * @struct PoolChunk
+ *
+ * @brief One block of pool nodes.
+ */
+typedef struct PoolChunk {
+  struct PoolChunk *next;                       // Previously allocated chunk.
+  PersistentStack nodes[PERSISTENT_POOL_CHUNK]; // Nodes carved from the chunk.
+} PoolChunk;
+
+/**
+ * @struct PersistentPool
+ *
+ * @brief Internal representation of the node pool.
+ */
+struct PersistentPool {
+  PoolChunk *chunks;       // All allocated chunks.
+  PersistentStack *free;   // Recycled nodes.
+  size_t unused;           // Never used nodes left in the newest chunk.
+  StackCopyFunc copy;      // Function to copy elements.
+  StackFreeFunc free_func; // Function to free elements.
+};
+
+/**
+ * @brief Takes a node from the free list or from the newest chunk.
+ *
+ * @param pool Pointer to the PersistentPool.
+ *
+ * @return Pointer to the node, or NULL on allocation failure.
+ */
+static PersistentStack *alloc_node(PersistentPool *pool) {
+  PersistentStack *node = pool->free;
+  if (node) {
+    pool->free = node->next;
+    return node;
+  }
+  if (pool->unused == 0) {
+    PoolChunk *chunk = malloc(sizeof(PoolChunk));
+    if (!chunk) {
+      return NULL;
+    }
+    chunk->next = pool->chunks;
+    pool->chunks = chunk;
+    pool->unused = PERSISTENT_POOL_CHUNK;
+  }
+  return &pool->chunks->nodes[--pool->unused];
+}
+
+/**
+ * @brief Initializes a new node pool structure.
+ *
+ * @param copy_func Function to copy elements (may be NULL).
+ * @param free_func Function to free elements (may be NULL).
+ *
+ * @return Pointer to the new PersistentPool, or NULL on allocation failure.
+ */
+PersistentPool *new_persistent_pool(StackCopyFunc copy_func, StackFreeFunc free_func) {
+  PersistentPool *pool = malloc(sizeof(PersistentPool));
+  if (!pool) {
+    return NULL;
+  }
+  pool->chunks = NULL;
+  pool->free = NULL;
+  pool->unused = 0;
+  pool->copy = copy_func;
+  pool->free_func = free_func;
+  return pool;
+}
+
+/**
+ * @brief Frees the pool and all of its chunks.
+ *
+ * @param pool Pointer to the PersistentPool.
+ */
+void free_persistent_pool(PersistentPool *pool) {
+  if (!pool) {
+    return;
+  }
+  while (pool->chunks) {
+    PoolChunk *next = pool->chunks->next;
+    free(pool->chunks);
+    pool->chunks = next;
+  }
+  free(pool);
+}
+
+/**
+ * @brief Returns a new version with a copy of element on top of base.
+ *
+ * The element is copied using the user-supplied copy function.
+ *
+ * @param pool Pointer to the PersistentPool.
+ * @param base Version to push onto.
+ * @param element Pointer to the element to copy.
+ *
+ * @return The new version, or NULL on failure.
+ */
+PersistentStack *persistent_push(PersistentPool *pool, PersistentStack *base,
+                                 const void *element) {
+  if (!pool || !pool->copy) {
+    return NULL;
+  }
+  void *copy = pool->copy(element);
+  if (!copy) {
+    return NULL;
+  }
+  PersistentStack *stack = persistent_push_owned(pool, base, copy);
+  if (!stack && pool->free_func) {
+    pool->free_func(copy);
+  }
+  return stack;
+}
+
+/**
+ * @brief Returns a new version with element on top of base, taking ownership
+ * of element.
+ *
+ * The new node holds a reference to base.
+ *
+ * @param pool Pointer to the PersistentPool.
+ * @param base Version to push onto.
+ * @param element Pointer to the element to push.
+ *
+ * @return The new version, or NULL on allocation failure.
+ */
+PersistentStack *persistent_push_owned(PersistentPool *pool, PersistentStack *base,
+                                       void *element) {
+  if (!pool) {
+    return NULL;
+  }
+  PersistentStack *node = alloc_node(pool);
+  if (!node) {
+    return NULL;
+  }
+  node->next = persistent_retain(base);
+  node->element = element;
+  node->refs = 1;
+  node->size = base ? base->size + 1 : 1;
+  return node;
+}
+
+/**
+ * @brief Returns the version below the top element of stack.
+ *
+ * @param stack Version to pop from.
+ *
+ * @return A new reference to the tail, or NULL if it is empty.
+ */
+PersistentStack *persistent_pop(PersistentStack *stack) {
+  if (!stack) {
+    return NULL;
+  }
+  return persistent_retain(stack->next);
+}
+
+/**
+ * @brief Returns the top element of a version.
+ *
+ * @param stack Version to inspect.
+ *
+ * @return Pointer to the top element, or NULL if the version is empty.
+ */
+void *persistent_peek(const PersistentStack *stack) {
+  if (!stack) {
+    return NULL;
+  }
+  return stack->element;
+}
+
+/**
+ * @brief Adds a reference to a version.
+ *
+ * @param stack Version to retain.
+ *
+ * @return stack.
+ */
+PersistentStack *persistent_retain(PersistentStack *stack) {
+  if (stack) {
+    ++stack->refs;
+  }
+  return stack;
+}
+
+/**
+ * @brief Releases a reference to a version.
+ *
+ * Iterates instead of recursing, so releasing a deep version cannot overflow
+ * the call stack.
+ *
+ * @param pool Pointer to the PersistentPool.
+ * @param stack Version to release.
+ */
+void persistent_release(PersistentPool *pool, PersistentStack *stack) {
+  if (!pool) {
+    return;
+  }
+  while (stack && --stack->refs == 0) {
+    PersistentStack *next = stack->next;
+    if (pool->free_func) {
+      pool->free_func(stack->element);
+    }
+    stack->next = pool->free;
+    pool->free = stack;
+    stack = next;
+  }
+}
+
+/**
+ * @brief Checks if a version has no elements.
+ *
+ * @param stack Version to inspect.
+ *
+ * @return true if empty, false otherwise.
+ */
+bool persistent_is_empty(const PersistentStack *stack) {
+  return stack == NULL;
+}
+
+/**
+ * @brief Returns the number of elements in a version.
+ *
+ * @param stack Version to inspect.
+ *
+ * @return Number of elements.
+ */
+size_t persistent_size(const PersistentStack *stack) {
+  if (!stack) {
+    return 0;
+  }
+  return stack->size;
+}
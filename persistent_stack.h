@@ -0,0 +1,153 @@
+/**
+ * @file persistent_stack.h
+ *
+ * @brief Persistent (immutable, structurally shared) stack in C.
+ *
+ * A PersistentStack is one version of a stack. Versions never change: pushing
+ * or popping returns a new version that shares every element below the top
+ * with the old one, in O(1) and without copying. Memory grows with the number
+ * of distinct pushes, not with versions times depth, which suits backtracking
+ * searches that keep many sibling versions alive.
+ *
+ * Versions are reference-counted nodes taken from a PersistentPool, which also
+ * holds the element copy and free functions. NULL is the empty version. Every
+ * version returned by this API is a reference the caller releases with
+ * persistent_release(). A pool and its versions must only be used by one
+ * thread at a time.
+ *
+ * @author trigologiaa
+ */
+
+#ifndef PERSISTENT_STACK_H
+
+#define PERSISTENT_STACK_H
+
+#include "stack.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @typedef PersistentStack
+ *
+ * @brief Opaque struct representing one version of a persistent stack.
+ */
+typedef struct PersistentStack PersistentStack;
+
+/**
+ * @typedef PersistentPool
+ *
+ * @brief Opaque struct representing the node pool shared by versions.
+ */
+typedef struct PersistentPool PersistentPool;
+
+/**
+ * @brief Creates a new node pool.
+ *
+ * @param copy_func Function to copy elements (may be NULL for a move-only
+ * pool used with persistent_push_owned()).
+ * @param free_func Function to free elements once no version holds them (may
+ * be NULL).
+ *
+ * @return Pointer to the new PersistentPool, or NULL on allocation failure.
+ */
+PersistentPool *new_persistent_pool(StackCopyFunc copy_func, StackFreeFunc free_func);
+
+/**
+ * @brief Frees the pool and all of its nodes.
+ *
+ * Every version should have been released first; elements of versions still
+ * alive are not freed.
+ *
+ * @param pool Pointer to the PersistentPool.
+ */
+void free_persistent_pool(PersistentPool *pool);
+
+/**
+ * @brief Returns a new version with a copy of element on top of base.
+ *
+ * base is not consumed and stays valid.
+ *
+ * @param pool Pointer to the PersistentPool.
+ * @param base Version to push onto (NULL for the empty stack).
+ * @param element Pointer to the element to copy.
+ *
+ * @return The new version, or NULL on allocation failure or for move-only
+ * pools.
+ */
+PersistentStack *persistent_push(PersistentPool *pool, PersistentStack *base,
+                                 const void *element);
+
+/**
+ * @brief Returns a new version with element on top of base, taking ownership
+ * of element.
+ *
+ * @param pool Pointer to the PersistentPool.
+ * @param base Version to push onto (NULL for the empty stack).
+ * @param element Pointer to the element to push.
+ *
+ * @return The new version, or NULL on allocation failure (the caller then
+ * still owns element).
+ */
+PersistentStack *persistent_push_owned(PersistentPool *pool, PersistentStack *base,
+                                       void *element);
+
+/**
+ * @brief Returns the version below the top element of stack.
+ *
+ * stack is not consumed and stays valid.
+ *
+ * @param stack Version to pop from.
+ *
+ * @return A new reference to the shared tail, or NULL if it is empty.
+ */
+PersistentStack *persistent_pop(PersistentStack *stack);
+
+/**
+ * @brief Returns the top element of a version.
+ *
+ * @param stack Version to inspect.
+ *
+ * @return Pointer to the top element (do not modify or free), or NULL if the
+ * version is empty.
+ */
+void *persistent_peek(const PersistentStack *stack);
+
+/**
+ * @brief Adds a reference to a version.
+ *
+ * @param stack Version to retain (may be NULL).
+ *
+ * @return stack.
+ */
+PersistentStack *persistent_retain(PersistentStack *stack);
+
+/**
+ * @brief Releases a reference to a version.
+ *
+ * Nodes no longer referenced by any version return to the pool and their
+ * elements are freed with free_func.
+ *
+ * @param pool Pointer to the PersistentPool.
+ * @param stack Version to release (may be NULL).
+ */
+void persistent_release(PersistentPool *pool, PersistentStack *stack);
+
+/**
+ * @brief Checks if a version is empty.
+ *
+ * @param stack Version to inspect.
+ *
+ * @return true if empty, false otherwise.
+ */
+bool persistent_is_empty(const PersistentStack *stack);
+
+/**
+ * @brief Returns the number of elements in a version.
+ *
+ * @param stack Version to inspect.
+ *
+ * @return Number of elements.
+ */
+size_t persistent_size(const PersistentStack *stack);
+
+#endif
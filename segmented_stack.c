@@ -0,0 +1,227 @@
+/**
+ * @file segmented_stack.c
+ *
+ * @brief Implementation of a segmented stack.
+ *
+ * This file contains the internal implementation of the SegmentedStack
+ * defined in segmented_stack.h. Segments are linked from the top down; only
+ * the top segment is partially filled, and a single emptied segment is cached
+ * for the next push that needs one.
+ */
+
+#include "segmented_stack.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @struct Segment
+ *
+ * @brief One fixed-size block of packed elements.
+ */
+typedef struct Segment {
+  struct Segment *prev; // Segment below this one.
+  max_align_t data[];   // Packed elements.
+} Segment;
+
+/**
+ * @struct SegmentedStack
+ *
+ * @brief Internal representation of the segmented stack.
+ */
+struct SegmentedStack {
+  Segment *top;         // Segment holding the top element, or NULL.
+  Segment *spare;       // Cached empty segment, or NULL.
+  size_t top_used;      // Number of elements in the top segment.
+  size_t size;          // Current number of elements.
+  size_t element_size;  // Size of each element.
+  size_t segment_slots; // Number of elements per segment.
+};
+
+/**
+ * @brief Returns the address of a slot in the top segment.
+ *
+ * @param stack Pointer to the SegmentedStack.
+ * @param index Slot index within the top segment.
+ *
+ * @return Pointer to the slot.
+ */
+static inline void *top_slot(const SegmentedStack *stack, size_t index) {
+  return (unsigned char *)stack->top->data + index * stack->element_size;
+}
+
+/**
+ * @brief Caches an emptied segment as the spare, or frees it if there is one.
+ *
+ * @param stack Pointer to the SegmentedStack.
+ * @param segment Segment no longer holding elements.
+ */
+static void retire(SegmentedStack *stack, Segment *segment) {
+  if (stack->spare) {
+    free(segment);
+  } else {
+    stack->spare = segment;
+  }
+}
+
+/**
+ * @brief Initializes a new segmented stack structure.
+ *
+ * @param elem_size Size in bytes of each element (must not be 0).
+ * @param segment_slots Number of elements per segment, or 0 for the default.
+ *
+ * @return Pointer to the new SegmentedStack, or NULL on invalid arguments or
+ * allocation failure.
+ */
+SegmentedStack *new_segmented_stack(size_t elem_size, size_t segment_slots) {
+  if (segment_slots == 0) {
+    segment_slots = SEGMENTED_STACK_DEFAULT_SLOTS;
+  }
+  if (elem_size == 0 || segment_slots > (SIZE_MAX - sizeof(Segment)) / elem_size) {
+    return NULL;
+  }
+  SegmentedStack *stack = malloc(sizeof(SegmentedStack));
+  if (!stack) {
+    return NULL;
+  }
+  stack->top = NULL;
+  stack->spare = NULL;
+  stack->top_used = 0;
+  stack->size = 0;
+  stack->element_size = elem_size;
+  stack->segment_slots = segment_slots;
+  return stack;
+}
+
+/**
+ * @brief Frees all memory associated with the segmented stack.
+ *
+ * @param stack Pointer to the SegmentedStack.
+ */
+void free_segmented_stack(SegmentedStack *stack) {
+  if (!stack) {
+    return;
+  }
+  segmented_clear(stack);
+  free(stack->spare);
+  free(stack);
+}
+
+/**
+ * @brief Pushes a copy of an element onto the segmented stack.
+ *
+ * Links the spare segment, or a newly allocated one, when the top segment is
+ * full. Existing elements are never moved.
+ *
+ * @param stack Pointer to the SegmentedStack.
+ * @param element Pointer to the element to push.
+ *
+ * @return true if the element was pushed, false on allocation failure.
+ */
+bool segmented_push(SegmentedStack *stack, const void *element) {
+  if (!stack || !element) {
+    return false;
+  }
+  if (!stack->top || stack->top_used == stack->segment_slots) {
+    Segment *segment = stack->spare;
+    if (segment) {
+      stack->spare = NULL;
+    } else {
+      segment = malloc(sizeof(Segment) + stack->segment_slots * stack->element_size);
+      if (!segment) {
+        return false;
+      }
+    }
+    segment->prev = stack->top;
+    stack->top = segment;
+    stack->top_used = 0;
+  }
+  memcpy(top_slot(stack, stack->top_used++), element, stack->element_size);
+  ++stack->size;
+  return true;
+}
+
+/**
+ * @brief Removes the top element and copies it into a caller buffer.
+ *
+ * Unlinks the top segment once it is empty, keeping it as the spare.
+ *
+ * @param stack Pointer to the SegmentedStack.
+ * @param out Destination buffer for the removed element (may be NULL).
+ *
+ * @return true if an element was removed, false if the stack is empty.
+ */
+bool segmented_pop(SegmentedStack *stack, void *out) {
+  if (!stack || stack->size == 0) {
+    return false;
+  }
+  --stack->top_used;
+  --stack->size;
+  if (out) {
+    memcpy(out, top_slot(stack, stack->top_used), stack->element_size);
+  }
+  if (stack->top_used == 0) {
+    Segment *segment = stack->top;
+    stack->top = segment->prev;
+    stack->top_used = stack->top ? stack->segment_slots : 0;
+    retire(stack, segment);
+  }
+  return true;
+}
+
+/**
+ * @brief Returns the top element of the segmented stack without removing it.
+ *
+ * @param stack Pointer to the SegmentedStack.
+ *
+ * @return Pointer to the top element, or NULL if the stack is empty.
+ */
+void *segmented_peek(const SegmentedStack *stack) {
+  if (!stack || stack->size == 0) {
+    return NULL;
+  }
+  return top_slot(stack, stack->top_used - 1);
+}
+
+/**
+ * @brief Removes all elements from the segmented stack.
+ *
+ * @param stack Pointer to the SegmentedStack.
+ */
+void segmented_clear(SegmentedStack *stack) {
+  if (!stack) {
+    return;
+  }
+  while (stack->top) {
+    Segment *prev = stack->top->prev;
+    retire(stack, stack->top);
+    stack->top = prev;
+  }
+  stack->top_used = 0;
+  stack->size = 0;
+}
+
+/**
+ * @brief Checks if the segmented stack has no elements.
+ *
+ * @param stack Pointer to the SegmentedStack.
+ *
+ * @return true if empty, false otherwise.
+ */
+bool segmented_is_empty(const SegmentedStack *stack) {
+  return segmented_size(stack) == 0;
+}
+
+/**
+ * @brief Returns the number of elements in the segmented stack.
+ *
+ * @param stack Pointer to the SegmentedStack.
+ *
+ * @return Number of elements.
+ */
+size_t segmented_size(const SegmentedStack *stack) {
+  if (!stack) {
+    return 0;
+  }
+  return stack->size;
+}
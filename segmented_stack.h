@@ -0,0 +1,115 @@
+/**
+ * @file segmented_stack.h
+ *
+ * @brief Segmented stack of fixed-size elements in C.
+ *
+ * Provides a stack whose storage is a linked list of fixed-size segments
+ * instead of one contiguous buffer. Growing allocates one new segment and never
+ * moves existing elements, so push has bounded latency and pointers returned by
+ * segmented_peek() stay valid until that element is popped. One empty segment
+ * is kept as a spare, so pushing and popping across a segment boundary does not
+ * allocate and free on every step.
+ *
+ * @author trigologiaa
+ */
+
+#ifndef SEGMENTED_STACK_H
+
+#define SEGMENTED_STACK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Number of elements per segment used when 0 is requested.
+ */
+#define SEGMENTED_STACK_DEFAULT_SLOTS 4096
+
+/**
+ * @typedef SegmentedStack
+ *
+ * @brief Opaque struct representing a segmented stack.
+ */
+typedef struct SegmentedStack SegmentedStack;
+
+/**
+ * @brief Creates a new segmented stack.
+ *
+ * No segment is allocated until the first push.
+ *
+ * @param elem_size Size in bytes of each element (must not be 0).
+ * @param segment_slots Number of elements per segment, or 0 for
+ * SEGMENTED_STACK_DEFAULT_SLOTS.
+ *
+ * @return Pointer to the new SegmentedStack, or NULL on invalid arguments or
+ * allocation failure.
+ */
+SegmentedStack *new_segmented_stack(size_t elem_size, size_t segment_slots);
+
+/**
+ * @brief Frees all memory associated with the segmented stack.
+ *
+ * @param stack Pointer to the SegmentedStack.
+ */
+void free_segmented_stack(SegmentedStack *stack);
+
+/**
+ * @brief Pushes a copy of an element onto the segmented stack.
+ *
+ * Allocates at most one segment, and none if the spare segment is available.
+ *
+ * @param stack Pointer to the SegmentedStack.
+ * @param element Pointer to the element (elem_size bytes) to push.
+ *
+ * @return true if the element was pushed, false on allocation failure.
+ */
+bool segmented_push(SegmentedStack *stack, const void *element);
+
+/**
+ * @brief Removes the top element and copies it into a caller buffer.
+ *
+ * @param stack Pointer to the SegmentedStack.
+ * @param out Destination buffer of elem_size bytes (may be NULL to discard).
+ *
+ * @return true if an element was removed, false if the stack is empty.
+ */
+bool segmented_pop(SegmentedStack *stack, void *out);
+
+/**
+ * @brief Returns the top element of the segmented stack without removing it.
+ *
+ * @param stack Pointer to the SegmentedStack.
+ *
+ * @return Pointer to the top element, valid until it is popped. Returns NULL
+ * if the stack is empty.
+ */
+void *segmented_peek(const SegmentedStack *stack);
+
+/**
+ * @brief Removes all elements from the segmented stack.
+ *
+ * Releases every segment except one, which is kept as the spare.
+ *
+ * @param stack Pointer to the SegmentedStack.
+ */
+void segmented_clear(SegmentedStack *stack);
+
+/**
+ * @brief Checks if the segmented stack is empty.
+ *
+ * @param stack Pointer to the SegmentedStack.
+ *
+ * @return true if empty, false otherwise.
+ */
+bool segmented_is_empty(const SegmentedStack *stack);
+
+/**
+ * @brief Returns the number of elements in the segmented stack.
+ *
+ * @param stack Pointer to the SegmentedStack.
+ *
+ * @return Number of elements.
+ */
+size_t segmented_size(const SegmentedStack *stack);
+
+#endif
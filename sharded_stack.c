@@ -0,0 +1,217 @@
+/**
+ * @file sharded_stack.c
+ *
+ * @brief Implementation of a sharded stack with per-thread caches.
+ *
+ * This file contains the internal implementation of the ShardedStack defined
+ * in sharded_stack.h. Local caches and the central stack are inline Stacks;
+ * batches move between them with pop_n() and push_n() through a per-cache
+ * scratch buffer, and only the central stack is protected by a mutex.
+ */
+
+// <sched.h>, included by <pthread.h>, declares a GNU clone() that clashes with stack.h.
+#undef _GNU_SOURCE
+
+#include "sharded_stack.h"
+#include "stack.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * @struct ShardedStack
+ *
+ * @brief Internal representation of the shared part of a sharded stack.
+ */
+struct ShardedStack {
+  pthread_mutex_t lock; // Protects central.
+  Stack *central;       // Elements not cached by any thread.
+  size_t element_size;  // Size of each element.
+  size_t batch_size;    // Elements moved per exchange.
+};
+
+/**
+ * @struct ShardedStackLocal
+ *
+ * @brief Internal representation of one thread's cache.
+ */
+struct ShardedStackLocal {
+  ShardedStack *shared; // Sharded stack the cache belongs to.
+  Stack *cache;         // Cached elements, at most two batches.
+  void *scratch;        // Buffer holding one batch in transit.
+};
+
+/**
+ * @brief Initializes a new sharded stack structure.
+ *
+ * @param elem_size Size in bytes of each element (must not be 0).
+ * @param batch_size Number of elements moved per exchange (must not be 0).
+ *
+ * @return Pointer to the new ShardedStack, or NULL on invalid arguments or
+ * allocation failure.
+ */
+ShardedStack *new_sharded_stack(size_t elem_size, size_t batch_size) {
+  if (elem_size == 0 || batch_size == 0 || batch_size > SIZE_MAX / 2 / elem_size) {
+    return NULL;
+  }
+  ShardedStack *stack = malloc(sizeof(ShardedStack));
+  if (!stack) {
+    return NULL;
+  }
+  stack->central = new_inline_stack(elem_size, NULL);
+  if (!stack->central) {
+    free(stack);
+    return NULL;
+  }
+  if (pthread_mutex_init(&stack->lock, NULL) != 0) {
+    free_stack(stack->central);
+    free(stack);
+    return NULL;
+  }
+  stack->element_size = elem_size;
+  stack->batch_size = batch_size;
+  return stack;
+}
+
+/**
+ * @brief Frees all memory associated with the sharded stack.
+ *
+ * @param stack Pointer to the ShardedStack.
+ */
+void free_sharded_stack(ShardedStack *stack) {
+  if (!stack) {
+    return;
+  }
+  pthread_mutex_destroy(&stack->lock);
+  free_stack(stack->central);
+  free(stack);
+}
+
+/**
+ * @brief Creates a local cache with room for two batches.
+ *
+ * @param stack Pointer to the ShardedStack.
+ *
+ * @return Pointer to the new ShardedStackLocal, or NULL on allocation failure.
+ */
+ShardedStackLocal *sharded_attach(ShardedStack *stack) {
+  if (!stack) {
+    return NULL;
+  }
+  ShardedStackLocal *local = malloc(sizeof(ShardedStackLocal));
+  if (!local) {
+    return NULL;
+  }
+  local->shared = stack;
+  local->cache = new_inline_stack(stack->element_size, NULL);
+  local->scratch = malloc(stack->batch_size * stack->element_size);
+  if (!local->cache || !local->scratch || !reserve(local->cache, 2 * stack->batch_size)) {
+    free_stack(local->cache);
+    free(local->scratch);
+    free(local);
+    return NULL;
+  }
+  return local;
+}
+
+/**
+ * @brief Moves every cached element to the central stack and frees the cache.
+ *
+ * Elements the central stack cannot take are pushed back onto the cache,
+ * which has room for them since they were just popped from it.
+ *
+ * @param local Pointer to the ShardedStackLocal.
+ *
+ * @return true if the cache was freed, false if it still holds elements.
+ */
+bool sharded_detach(ShardedStackLocal *local) {
+  if (!local) {
+    return true;
+  }
+  ShardedStack *stack = local->shared;
+  size_t count;
+  while ((count = pop_n(local->cache, local->scratch, stack->batch_size)) > 0) {
+    pthread_mutex_lock(&stack->lock);
+    size_t moved = push_n(stack->central, local->scratch, count);
+    pthread_mutex_unlock(&stack->lock);
+    if (moved < count) {
+      push_n(local->cache, (unsigned char *)local->scratch + moved * stack->element_size,
+             count - moved);
+      return false;
+    }
+  }
+  free_stack(local->cache);
+  free(local->scratch);
+  free(local);
+  return true;
+}
+
+/**
+ * @brief Pushes an element through a local cache.
+ *
+ * When the cache holds two batches, one batch is spilled to the central
+ * stack under the lock first. Elements the central stack cannot take stay in
+ * the cache.
+ *
+ * @param local Pointer to the ShardedStackLocal.
+ * @param element Pointer to the element to push.
+ *
+ * @return true if the element was pushed, false on allocation failure.
+ */
+bool sharded_push(ShardedStackLocal *local, const void *element) {
+  if (!local) {
+    return false;
+  }
+  ShardedStack *stack = local->shared;
+  if (size(local->cache) >= 2 * stack->batch_size) {
+    size_t count = pop_n(local->cache, local->scratch, stack->batch_size);
+    pthread_mutex_lock(&stack->lock);
+    size_t spilled = push_n(stack->central, local->scratch, count);
+    pthread_mutex_unlock(&stack->lock);
+    push_n(local->cache, (unsigned char *)local->scratch + spilled * stack->element_size,
+           count - spilled);
+  }
+  return push(local->cache, element);
+}
+
+/**
+ * @brief Pops an element through a local cache.
+ *
+ * When the cache is empty, up to one batch is refilled from the central stack
+ * under the lock first.
+ *
+ * @param local Pointer to the ShardedStackLocal.
+ * @param out Destination buffer for the element.
+ *
+ * @return true if an element was popped, false if no element is available.
+ */
+bool sharded_pop(ShardedStackLocal *local, void *out) {
+  if (!local) {
+    return false;
+  }
+  ShardedStack *stack = local->shared;
+  if (is_empty(local->cache)) {
+    pthread_mutex_lock(&stack->lock);
+    size_t count = pop_n(stack->central, local->scratch, stack->batch_size);
+    pthread_mutex_unlock(&stack->lock);
+    push_n(local->cache, local->scratch, count);
+  }
+  return pop_into(local->cache, out);
+}
+
+/**
+ * @brief Returns the number of elements held by the central stack.
+ *
+ * @param stack Pointer to the ShardedStack.
+ *
+ * @return Number of elements in the central stack.
+ */
+size_t sharded_central_size(ShardedStack *stack) {
+  if (!stack) {
+    return 0;
+  }
+  pthread_mutex_lock(&stack->lock);
+  size_t count = size(stack->central);
+  pthread_mutex_unlock(&stack->lock);
+  return count;
+}
@@ -0,0 +1,119 @@
+/**
+ * @file sharded_stack.h
+ *
+ * @brief Sharded stack with per-thread caches in C.
+ *
+ * Provides a stack of fixed-size elements shared by many threads, built
+ * on inline Stacks from stack.h. Each thread attaches a local cache and pushes
+ * and pops there without synchronization. Whole batches move between the
+ * cache and a shared central stack only when the cache overflows or runs
+ * empty, so a lock is taken once per batch rather than once per element.
+ *
+ * Typical use is an object-recycling free list whose elements are pointers.
+ *
+ * @author trigologiaa
+ */
+
+#ifndef SHARDED_STACK_H
+
+#define SHARDED_STACK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @typedef ShardedStack
+ *
+ * @brief Opaque struct representing the shared part of a sharded stack.
+ */
+typedef struct ShardedStack ShardedStack;
+
+/**
+ * @typedef ShardedStackLocal
+ *
+ * @brief Opaque struct representing one thread's cache of a sharded stack.
+ */
+typedef struct ShardedStackLocal ShardedStackLocal;
+
+/**
+ * @brief Creates a new sharded stack.
+ *
+ * @param elem_size Size in bytes of each element (must not be 0).
+ * @param batch_size Number of elements moved per exchange with the central
+ * stack (must not be 0). Each local cache holds up to twice as many.
+ *
+ * @return Pointer to the new ShardedStack, or NULL on invalid arguments or
+ * allocation failure.
+ */
+ShardedStack *new_sharded_stack(size_t elem_size, size_t batch_size);
+
+/**
+ * @brief Frees all memory associated with the sharded stack.
+ *
+ * All local caches must have been detached.
+ *
+ * @param stack Pointer to the ShardedStack.
+ */
+void free_sharded_stack(ShardedStack *stack);
+
+/**
+ * @brief Creates a local cache for the calling thread.
+ *
+ * A cache must only be used by one thread at a time.
+ *
+ * @param stack Pointer to the ShardedStack.
+ *
+ * @return Pointer to the new ShardedStackLocal, or NULL on allocation failure.
+ */
+ShardedStackLocal *sharded_attach(ShardedStack *stack);
+
+/**
+ * @brief Flushes a local cache to the central stack and frees it.
+ *
+ * If the central stack cannot take every element, the cache keeps the rest
+ * and stays attached, so no element is lost; the call can be retried.
+ *
+ * @param local Pointer to the ShardedStackLocal.
+ *
+ * @return true if the cache was flushed and freed (or local is NULL), false
+ * if it is still attached after an allocation failure.
+ */
+bool sharded_detach(ShardedStackLocal *local);
+
+/**
+ * @brief Pushes an element through a local cache.
+ *
+ * Takes the central lock only when the cache is full, to spill one batch.
+ *
+ * @param local Pointer to the ShardedStackLocal.
+ * @param element Pointer to the element (elem_size bytes) to push.
+ *
+ * @return true if the element was pushed, false on allocation failure.
+ */
+bool sharded_push(ShardedStackLocal *local, const void *element);
+
+/**
+ * @brief Pops an element through a local cache.
+ *
+ * Takes the central lock only when the cache is empty, to refill one batch.
+ *
+ * @param local Pointer to the ShardedStackLocal.
+ * @param out Destination buffer of elem_size bytes.
+ *
+ * @return true if an element was popped, false if both the cache and the
+ * central stack are empty.
+ */
+bool sharded_pop(ShardedStackLocal *local, void *out);
+
+/**
+ * @brief Returns the number of elements held by the central stack.
+ *
+ * Elements cached by attached threads are not counted.
+ *
+ * @param stack Pointer to the ShardedStack.
+ *
+ * @return Number of elements in the central stack.
+ */
+size_t sharded_central_size(ShardedStack *stack);
+
+#endif
@@ -5,313 +5,3963 @@
  *
  * This file contains the internal implementation of the Stack defined in
  * stack.h. It uses a dynamically resized array and user-supplied functions for
- * element management.
+ * element management. Inline stacks reuse the same array as a packed buffer of
+ * fixed-size elements. The first slots live inside the Stack allocation itself
+ * and the heap buffer is only allocated once they overflow. File-backed stacks
+ * map their buffer from a file instead.
  */
 
+// <sched.h>, included by <pthread.h>, declares a GNU clone() that clashes with stack.h.
+#undef _GNU_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+
 #include "stack.h"
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define STACK_HAVE_AVX2 1
+#endif
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/**
+ * Initial capacity for the stack.
+ */
+#define STACK_INITIAL_CAPACITY 8
+
+/**
+ * Default multiplicative growth factor.
+ */
+#define STACK_DEFAULT_GROWTH_FACTOR 2.0
+
+/**
+ * Default size of the chunks carved up by element arenas.
+ */
+#define STACK_ARENA_CHUNK_SIZE 65536
+
+/**
+ * Bytes reserved at the start of a stack file for its header.
+ */
+#define STACK_FILE_HEADER_SIZE 64
+
+/**
+ * Magic bytes identifying a stack file.
+ */
+#define STACK_FILE_MAGIC "STACKv1"
+
+/**
+ * Magic bytes identifying serialized stack data.
+ */
+#define STACK_STREAM_MAGIC "STACKs1"
+
+/**
+ * Number of bytes serialize() and deserialize() transfer per call for inline
+ * stacks.
+ */
+#define STACK_STREAM_CHUNK_SIZE 65536
+
+/**
+ * Minimum number of elements each thread handles in the parallel_ operations.
+ */
+#define STACK_PARALLEL_MIN_RUN 4096
+
+/**
+ * Upper bound on the threads used by the parallel_ operations.
+ */
+#define STACK_PARALLEL_MAX_THREADS 64
+
+/**
+ * @struct ReclaimNode
+ *
+ * @brief Stack waiting to be freed by the background reclaimer.
+ */
+typedef struct ReclaimNode {
+  Stack *stack;             // Stack to free.
+  struct ReclaimNode *next; // Next queued stack.
+} ReclaimNode;
+
+/**
+ * @struct Reclaimer
+ *
+ * @brief Queue of stacks handed to free_stack_async() and its worker thread.
+ *
+ * The worker is started by the first free_stack_async() call and lives until
+ * the process exits.
+ */
+typedef struct Reclaimer {
+  pthread_mutex_t lock; // Protects the other fields.
+  pthread_cond_t work;  // Signaled when a stack is queued.
+  pthread_cond_t idle;  // Signaled when pending drops to 0.
+  ReclaimNode *head;    // Next stack to free.
+  ReclaimNode *tail;    // Last queued stack.
+  size_t pending;       // Queued stacks plus the one being freed.
+  bool started;         // Whether the worker thread is running.
+} Reclaimer;
+
+static Reclaimer reclaimer = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER,
+                              PTHREAD_COND_INITIALIZER, NULL, NULL, 0, false};
+
+/**
+ * @struct WorkRange
+ *
+ * @brief Range of elements processed by one thread of a parallel operation.
+ */
+typedef struct WorkRange {
+  const Stack *stack;   // Stack being processed.
+  void **dst;           // Destination of copies, indexed like the elements.
+  StackPredicate pred;  // Predicate evaluated over the range, or NULL.
+  StackMapFunc map_fn;  // Function applied over the range, or NULL.
+  void *ctx;            // Context passed to pred or map_fn.
+  unsigned char *marks; // Predicate results, indexed like the elements, or NULL.
+  size_t begin;         // First index of the range.
+  size_t end;           // One past the last index of the range.
+  size_t done;          // Elements copied or matched so far.
+} WorkRange;
+
+/**
+ * @struct FileHeader
+ *
+ * @brief Header at the start of a stack file, followed by the packed elements.
+ *
+ * Serialized stacks start with the same header under STACK_STREAM_MAGIC.
+ */
+typedef struct FileHeader {
+  char magic[8];         // STACK_FILE_MAGIC.
+  uint64_t element_size; // Size of each element.
+  uint64_t size;         // Number of elements, as of the last sync.
+} FileHeader;
+
+static_assert(sizeof(FileHeader) <= STACK_FILE_HEADER_SIZE, "STACK_FILE_HEADER_SIZE too small");
+
+/**
+ * @struct ArenaChunk
+ *
+ * @brief One block of bump-allocated element memory.
+ */
+typedef struct ArenaChunk {
+  struct ArenaChunk *next; // Previously filled chunk.
+  size_t capacity;         // Usable bytes in data.
+  size_t used;             // Bytes handed out so far.
+  max_align_t data[];      // Element memory.
+} ArenaChunk;
+
+/**
+ * @struct StackArena
+ *
+ * @brief Bump allocator for the element copies of an arena stack.
+ *
+ * Chunks come from the stack allocator and are released all at once.
+ */
+struct StackArena {
+  ArenaChunk *head;                // Chunk currently being filled.
+  const StackAllocator *allocator; // Allocator providing the chunks.
+};
+
+/**
+ * Marks an empty index entry and the end of a chain of equal elements.
+ */
+#define INDEX_NONE SIZE_MAX
+
+/**
+ * @struct IndexEntry
+ *
+ * @brief One slot of the open-addressing membership index.
+ */
+typedef struct IndexEntry {
+  size_t hash;  // Hash of the elements in the chain.
+  size_t index; // Topmost element of the chain, or INDEX_NONE if the slot is empty.
+} IndexEntry;
+
+/**
+ * @struct StackIndex
+ *
+ * @brief Hash index from element value to the topmost equal element.
+ *
+ * Each set of equal elements forms a chain: the table entry holds the index
+ * of the topmost one and below[i] the index of the next equal element under
+ * element i. Pushes and pops only ever touch the top of a chain.
+ */
+typedef struct StackIndex {
+  IndexEntry *entries;   // Linear-probing table, capacity a power of two.
+  size_t capacity;       // Number of table slots.
+  size_t *below;         // Next equal element below each element.
+  size_t below_capacity; // Number of slots in below.
+} StackIndex;
+
+/**
+ * @struct Stack
+ *
+ * @brief Internal representation of the stack.
+ *
+ * Contains a dynamically allocated array of void pointers, current size, and
+ * capacity. Element management is delegated to user-provided functions.
+ *
+ * Inline stacks store elements by value: data is then a packed byte buffer of
+ * element_size bytes per slot and the copy and free functions are unused.
+ *
+ * While the elements fit in small_capacity slots, data points to the small
+ * buffer at the end of the struct, allocated together with the header.
+ *
+ * Bounded stacks preallocate bound slots and never grow. drop_oldest stacks
+ * use them as a ring: element i lives in slot (head + i) % bound, and
+ * dropping the bottom element advances head so that the next push overwrites
+ * the oldest slot in place.
+ *
+ * File-backed stacks have an open fd and map the whole file: the header sits
+ * STACK_FILE_HEADER_SIZE bytes before data and capacity covers the rest.
+ */
+struct Stack {
+  void **data;                   // Array of element pointers, or packed elements.
+  size_t size;                   // Current number of elements.
+  size_t capacity;               // Allocated capacity.
+  size_t element_size;           // Size of inline elements, 0 for pointer stacks.
+  size_t stride;                 // Bytes per slot in data.
+  StackCopyFunc copy;            // Function to copy elements.
+  StackFreeFunc free_func;       // Function to free elements.
+  StackBatchFreeFunc batch_free; // Frees runs of elements, or NULL.
+  StackCompareFunc cmp;          // Function to compare elements (optional).
+  StackGrowthPolicy growth;      // How grow() computes the next capacity.
+  StackAllocator allocator;      // Allocator for the header and buffer.
+  StackArenaCopyFunc arena_copy; // Copies elements into the arena, or NULL.
+  StackArena arena;              // Arena holding element copies.
+  size_t small_capacity;         // Number of slots in the small buffer.
+  size_t bound;                  // Fixed capacity of bounded stacks, or 0.
+  size_t head;                   // Slot of the bottom element of drop_oldest stacks.
+  int fd;                        // Backing file of file-backed stacks, or -1.
+  StackHashFunc hash;            // Hashes elements for the index, or NULL.
+  StackIndex *index;             // Membership index, allocated on first use.
+  size_t mark_count;             // Number of marks taken, used as mark serials.
+  size_t open_mark;              // Serial of the innermost open mark, or 0.
+  size_t mark_floor;             // Depth of the innermost open mark.
+#ifdef STACK_STATS
+  StackStats stats;              // Instrumentation counters.
+  StackGrowthHook growth_hook;   // Called after each growth, or NULL.
+  void *growth_hook_ctx;         // Context passed to growth_hook.
+#endif
+  bool drop_oldest;              // Whether a full bounded stack drops its bottom.
+  bool heap_header;              // Whether the struct itself was allocated.
+  max_align_t small[];           // Small buffer for the first slots.
+};
+
+static_assert(sizeof(Stack) <= STACK_STORAGE_SIZE, "STACK_STORAGE_SIZE is too small");
+static_assert(_Alignof(Stack) <= STACK_STORAGE_ALIGN, "STACK_STORAGE_ALIGN is too small");
+
+/**
+ * @brief Default allocation hook, backed by malloc().
+ */
+static void *default_alloc(void *ctx, size_t size) {
+  (void)ctx;
+  return malloc(size);
+}
+
+/**
+ * @brief Default reallocation hook, backed by realloc().
+ */
+static void *default_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+  (void)ctx;
+  (void)old_size;
+  return realloc(ptr, new_size);
+}
+
+/**
+ * @brief Default release hook, backed by free().
+ */
+static void default_free(void *ctx, void *ptr, size_t size) {
+  (void)ctx;
+  (void)size;
+  free(ptr);
+}
+
+/**
+ * Allocator used when the options do not provide one.
+ */
+static const StackAllocator default_allocator = {default_alloc, default_realloc, default_free,
+                                                 NULL};
+
+/**
+ * Linux memory policy modes, as defined in <numaif.h>.
+ */
+#define STACK_MPOL_BIND 2
+#define STACK_MPOL_INTERLEAVE 3
+
+/**
+ * @brief Rounds a block size up to the size of its mapping.
+ *
+ * @param size Block size in bytes.
+ *
+ * @return Mapping length, a multiple of STACK_HUGE_PAGE_SIZE.
+ */
+static inline size_t mapping_length(size_t size) {
+  return (size + STACK_HUGE_PAGE_SIZE - 1) / STACK_HUGE_PAGE_SIZE * STACK_HUGE_PAGE_SIZE;
+}
+
+/**
+ * @brief Maps a block for the page allocator.
+ *
+ * ctx packs the StackHugePages value in bits 0-1, the StackNumaPolicy in
+ * bits 2-3 and the node mask above them. Explicit huge pages fall back to a
+ * regular mapping advised for transparent huge pages, and a failed mbind()
+ * leaves the default placement.
+ *
+ * @param ctx Packed page policy.
+ * @param size Block size in bytes (at least STACK_HUGE_PAGE_SIZE).
+ *
+ * @return Pointer to the mapping, or NULL on failure.
+ */
+static void *page_map(void *ctx, size_t size) {
+  uintptr_t policy = (uintptr_t)ctx;
+  StackHugePages huge = (StackHugePages)(policy & 3);
+  StackNumaPolicy numa = (StackNumaPolicy)((policy >> 2) & 3);
+  if (size > SIZE_MAX - STACK_HUGE_PAGE_SIZE) {
+    return NULL;
+  }
+  size_t length = mapping_length(size);
+  void *memory = MAP_FAILED;
+#if defined(MAP_HUGETLB)
+  if (huge == STACK_HUGE_PAGES_EXPLICIT) {
+    memory = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+                  -1, 0);
+  }
+#endif
+  if (memory == MAP_FAILED) {
+    memory = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+      return NULL;
+    }
+#if defined(MADV_HUGEPAGE)
+    if (huge != STACK_HUGE_PAGES_NONE) {
+      madvise(memory, length, MADV_HUGEPAGE);
+    }
+#endif
+  }
+#if defined(__linux__) && defined(SYS_mbind)
+  if (numa != STACK_NUMA_DEFAULT) {
+    unsigned long nodes = (unsigned long)(policy >> 4);
+    nodes = nodes ? nodes : ~0UL;
+    int mode = numa == STACK_NUMA_BIND ? STACK_MPOL_BIND : STACK_MPOL_INTERLEAVE;
+    syscall(SYS_mbind, memory, length, mode, &nodes, sizeof(nodes) * 8 + 1, 0);
+  }
+#else
+  (void)numa;
+#endif
+  return memory;
+}
+
+/**
+ * @brief Page allocator allocation hook.
+ *
+ * Small blocks come from malloc(); the others are mapped by page_map().
+ */
+static void *page_alloc(void *ctx, size_t size) {
+  return size < STACK_HUGE_PAGE_SIZE ? malloc(size) : page_map(ctx, size);
+}
+
+/**
+ * @brief Page allocator release hook.
+ */
+static void page_free(void *ctx, void *ptr, size_t size) {
+  (void)ctx;
+  if (size < STACK_HUGE_PAGE_SIZE) {
+    free(ptr);
+  } else if (ptr) {
+    munmap(ptr, mapping_length(size));
+  }
+}
+
+/**
+ * @brief Page allocator reallocation hook.
+ *
+ * Blocks that stay within the same mapping length are returned unchanged;
+ * moving between or across mappings allocates, copies and releases.
+ */
+static void *page_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+  if (old_size < STACK_HUGE_PAGE_SIZE && new_size < STACK_HUGE_PAGE_SIZE) {
+    return realloc(ptr, new_size);
+  }
+  if (old_size >= STACK_HUGE_PAGE_SIZE && new_size >= STACK_HUGE_PAGE_SIZE &&
+      mapping_length(old_size) == mapping_length(new_size)) {
+    return ptr;
+  }
+  void *memory = page_alloc(ctx, new_size);
+  if (!memory) {
+    return NULL;
+  }
+  if (ptr) {
+    memcpy(memory, ptr, old_size < new_size ? old_size : new_size);
+  }
+  page_free(ctx, ptr, old_size);
+  return memory;
+}
+
+/**
+ * @brief Returns the allocator described by a set of options.
+ *
+ * @param options Pointer to validated StackOptions.
+ *
+ * @return The custom allocator, the page allocator for huge page or NUMA
+ * options, or default_allocator.
+ */
+static StackAllocator allocator_of(const StackOptions *options) {
+  if (options->allocator) {
+    return *options->allocator;
+  }
+  if (options->huge_pages == STACK_HUGE_PAGES_NONE && options->numa_policy == STACK_NUMA_DEFAULT) {
+    return default_allocator;
+  }
+  uintptr_t policy = (uintptr_t)options->numa_nodes << 4 | (uintptr_t)options->numa_policy << 2 |
+                     (uintptr_t)options->huge_pages;
+  return (StackAllocator){page_alloc, page_realloc, page_free, (void *)policy};
+}
+
+/**
+ * @brief Maps an element index to its position in the stack buffer.
+ *
+ * The identity, except on drop_oldest stacks whose elements wrap around
+ * their ring.
+ *
+ * @param stack Pointer to the Stack.
+ * @param index Slot index, 0 being the bottom (at most the capacity).
+ *
+ * @return Position of the slot in data.
+ */
+static inline size_t slot_index(const Stack *stack, size_t index) {
+  if (stack->drop_oldest) {
+    index += stack->head;
+    if (index >= stack->bound) {
+      index -= stack->bound;
+    }
+  }
+  return index;
+}
+
+/**
+ * @brief Returns the address of the slot at the given index.
+ *
+ * @param stack Pointer to the Stack.
+ * @param index Slot index, 0 being the bottom.
+ *
+ * @return Pointer to the slot inside the stack buffer.
+ */
+static inline void *slot(const Stack *stack, size_t index) {
+  return (unsigned char *)stack->data + slot_index(stack, index) * stack->stride;
+}
+
+/**
+ * @brief Returns the slot holding an element pointer of a pointer stack.
+ *
+ * @param stack Pointer to a pointer Stack.
+ * @param index Slot index, 0 being the bottom.
+ *
+ * @return Pointer to the element pointer.
+ */
+static inline void **pointer_slot(const Stack *stack, size_t index) {
+  return slot(stack, index);
+}
+
+/**
+ * @brief Returns how many slots of a range are contiguous in the buffer.
+ *
+ * Only the ring of a drop_oldest stack wraps: a range reaching past the end
+ * of its buffer continues at the start, so it is handled in two runs.
+ *
+ * @param stack Pointer to the Stack.
+ * @param index Index of the first slot of the range.
+ * @param count Number of slots in the range.
+ *
+ * @return Length of the contiguous run starting at index, at most count.
+ */
+static inline size_t run_length(const Stack *stack, size_t index, size_t count) {
+  if (!stack->drop_oldest) {
+    return count;
+  }
+  size_t room = stack->bound - slot_index(stack, index);
+  return count < room ? count : room;
+}
+
+/**
+ * @brief Copies a range of slots out of the stack buffer.
+ *
+ * @param stack Pointer to the Stack.
+ * @param from Index of the first slot.
+ * @param count Number of slots.
+ * @param out Destination with room for count slots.
+ */
+static void copy_out(const Stack *stack, size_t from, size_t count, void *out) {
+  unsigned char *bytes = out;
+  while (count > 0) {
+    size_t run = run_length(stack, from, count);
+    memcpy(bytes, slot(stack, from), run * stack->stride);
+    bytes += run * stack->stride;
+    from += run;
+    count -= run;
+  }
+}
+
+/**
+ * @brief Copies packed slots into a range of the stack buffer.
+ *
+ * @param stack Pointer to the Stack.
+ * @param from Index of the first slot (within the capacity).
+ * @param count Number of slots.
+ * @param in Source of count slots.
+ */
+static void copy_in(Stack *stack, size_t from, size_t count, const void *in) {
+  const unsigned char *bytes = in;
+  while (count > 0) {
+    size_t run = run_length(stack, from, count);
+    memcpy(slot(stack, from), bytes, run * stack->stride);
+    bytes += run * stack->stride;
+    from += run;
+    count -= run;
+  }
+}
+
+/**
+ * @brief Returns the element at the given index.
+ *
+ * @param stack Pointer to the Stack.
+ * @param index Element index, 0 being the bottom.
+ *
+ * @return The element pointer for pointer stacks, the slot for inline stacks.
+ */
+static inline void *element_at(const Stack *stack, size_t index) {
+  return stack->element_size ? slot(stack, index) : *pointer_slot(stack, index);
+}
+
+/**
+ * @brief Checks whether the stack currently uses its small buffer.
+ *
+ * @param stack Pointer to the Stack.
+ *
+ * @return true if data points into the Stack allocation itself.
+ */
+static inline bool uses_small(const Stack *stack) {
+  return stack->data == (void **)stack->small;
+}
+
+/**
+ * @brief Counts pushed elements and updates the high-water mark.
+ *
+ * Compiles to nothing without STACK_STATS, as do the other stat_ helpers.
+ *
+ * @param stack Pointer to the Stack, after the push.
+ * @param count Number of elements pushed.
+ */
+static inline void stat_push(Stack *stack, size_t count) {
+#ifdef STACK_STATS
+  stack->stats.pushes += count;
+  if (stack->size > stack->stats.high_water) {
+    stack->stats.high_water = stack->size;
+  }
+#else
+  (void)stack;
+  (void)count;
+#endif
+}
+
+/**
+ * @brief Counts popped elements.
+ *
+ * @param stack Pointer to the Stack.
+ * @param count Number of elements popped.
+ */
+static inline void stat_pop(Stack *stack, size_t count) {
+#ifdef STACK_STATS
+  stack->stats.pops += count;
+#else
+  (void)stack;
+  (void)count;
+#endif
+}
+
+/**
+ * @brief Counts element copy and free callbacks.
+ *
+ * @param stack Pointer to the Stack.
+ * @param copies Number of copy callbacks made.
+ * @param frees Number of free callbacks made.
+ */
+static inline void stat_callbacks(Stack *stack, size_t copies, size_t frees) {
+#ifdef STACK_STATS
+  stack->stats.copy_calls += copies;
+  stack->stats.free_calls += frees;
+#else
+  (void)stack;
+  (void)copies;
+  (void)frees;
+#endif
+}
+
+/**
+ * @brief Counts a buffer reallocation and fires the growth hook if it grew.
+ *
+ * @param stack Pointer to the Stack, after the reallocation.
+ * @param old_capacity Capacity before the reallocation.
+ * @param bytes Number of bytes requested.
+ */
+static inline void stat_resize(Stack *stack, size_t old_capacity, size_t bytes) {
+#ifdef STACK_STATS
+  ++stack->stats.reallocs;
+  stack->stats.realloc_bytes += bytes;
+  if (stack->growth_hook && stack->capacity > old_capacity) {
+    stack->growth_hook(stack, old_capacity, stack->capacity, stack->growth_hook_ctx);
+  }
+#else
+  (void)stack;
+  (void)old_capacity;
+  (void)bytes;
+#endif
+}
+
+/**
+ * @brief Releases every arena chunk except the most recent one.
+ *
+ * The remaining chunk is emptied and kept for reuse, or released as well when
+ * keep is false.
+ *
+ * @param arena Pointer to the StackArena.
+ * @param keep Whether to keep the most recent chunk.
+ */
+static void arena_reset(StackArena *arena, bool keep) {
+  ArenaChunk *chunk = arena->head;
+  if (!chunk) {
+    return;
+  }
+  ArenaChunk *rest = keep ? chunk->next : chunk;
+  while (rest) {
+    ArenaChunk *next = rest->next;
+    arena->allocator->free_func(arena->allocator->ctx, rest, sizeof(ArenaChunk) + rest->capacity);
+    rest = next;
+  }
+  if (keep) {
+    chunk->next = NULL;
+    chunk->used = 0;
+  } else {
+    arena->head = NULL;
+  }
+}
+
+/**
+ * @brief Releases the arena memory allocated after a recorded position.
+ *
+ * The chunks allocated after chunk are released and chunk is rewound to used
+ * bytes. A NULL chunk releases every chunk; a chunk no longer in the arena
+ * leaves it unchanged.
+ *
+ * @param arena Pointer to the StackArena.
+ * @param chunk Chunk in use at the recorded position, or NULL.
+ * @param used Bytes used in that chunk at the recorded position.
+ */
+static void arena_rewind(StackArena *arena, const void *chunk, size_t used) {
+  ArenaChunk *found = arena->head;
+  while (found && found != chunk) {
+    found = found->next;
+  }
+  if (!found && chunk) {
+    return;
+  }
+  while (arena->head != found) {
+    ArenaChunk *next = arena->head->next;
+    arena->allocator->free_func(arena->allocator->ctx, arena->head,
+                                sizeof(ArenaChunk) + arena->head->capacity);
+    arena->head = next;
+  }
+  if (found) {
+    found->used = used;
+  }
+}
+
+/**
+ * @brief Copies an element for storage in a pointer stack.
+ *
+ * @param stack Pointer to the Stack.
+ * @param element Pointer to the element to copy.
+ *
+ * @return Pointer to the copy, or NULL on failure.
+ */
+static inline void *copy_element(Stack *stack, const void *element) {
+  stat_callbacks(stack, 1, 0);
+  if (stack->arena_copy) {
+    return stack->arena_copy(element, &stack->arena);
+  }
+  return stack->copy(element);
+}
+
+/**
+ * @brief Checks whether elements can be copied into the stack.
+ *
+ * @param stack Pointer to the Stack.
+ *
+ * @return true for inline stacks and pointer stacks with a copy function.
+ */
+static inline bool can_copy(const Stack *stack) {
+  return stack->element_size || stack->copy || stack->arena_copy;
+}
+
+/**
+ * @brief Swaps the contents of two non-overlapping memory regions.
+ *
+ * @param a Pointer to the first region.
+ * @param b Pointer to the second region.
+ * @param n Number of bytes to swap.
+ */
+static void swap_bytes(void *a, void *b, size_t n) {
+  unsigned char tmp[64];
+  unsigned char *pa = a;
+  unsigned char *pb = b;
+  while (n > 0) {
+    size_t chunk = n < sizeof(tmp) ? n : sizeof(tmp);
+    memcpy(tmp, pa, chunk);
+    memcpy(pa, pb, chunk);
+    memcpy(pb, tmp, chunk);
+    pa += chunk;
+    pb += chunk;
+    n -= chunk;
+  }
+}
+
+/**
+ * @brief Finds the index slot holding the chain of elements equal to element.
+ *
+ * @param stack Pointer to a Stack with an allocated index.
+ * @param element Pointer to the element to look up.
+ * @param hash Hash of element.
+ *
+ * @return Position of the matching slot, or of the empty slot where the chain
+ * would be inserted.
+ */
+static size_t index_slot(const Stack *stack, const void *element, size_t hash) {
+  const StackIndex *index = stack->index;
+  size_t mask = index->capacity - 1;
+  size_t pos = hash & mask;
+  while (index->entries[pos].index != INDEX_NONE) {
+    const IndexEntry *entry = &index->entries[pos];
+    if (entry->hash == hash && stack->cmp(element_at(stack, entry->index), element) == 0) {
+      break;
+    }
+    pos = (pos + 1) & mask;
+  }
+  return pos;
+}
+
+/**
+ * @brief Ensures the index can track n elements without allocating.
+ *
+ * Allocates the index on first use and keeps the table at most half full.
+ * Does nothing for stacks without a hash function.
+ *
+ * @param stack Pointer to the Stack.
+ * @param n Number of elements to make room for.
+ *
+ * @return STACK_OK on success, STACK_ERROR_NO_MEMORY on allocation failure.
+ */
+static StackStatus index_reserve(Stack *stack, size_t n) {
+  if (!stack->hash) {
+    return STACK_OK;
+  }
+  const StackAllocator *allocator = &stack->allocator;
+  if (n > SIZE_MAX / 2 / sizeof(IndexEntry)) {
+    return STACK_ERROR_NO_MEMORY;
+  }
+  if (!stack->index) {
+    stack->index = allocator->alloc_func(allocator->ctx, sizeof(StackIndex));
+    if (!stack->index) {
+      return STACK_ERROR_NO_MEMORY;
+    }
+    *stack->index = (StackIndex){NULL, 0, NULL, 0};
+  }
+  StackIndex *index = stack->index;
+  if (index->below_capacity < n) {
+    size_t new_capacity = index->below_capacity * 2 > n ? index->below_capacity * 2 : n;
+    size_t *below = allocator->realloc_func(allocator->ctx, index->below,
+                                            index->below_capacity * sizeof(size_t),
+                                            new_capacity * sizeof(size_t));
+    if (!below) {
+      return STACK_ERROR_NO_MEMORY;
+    }
+    index->below = below;
+    index->below_capacity = new_capacity;
+  }
+  size_t table_capacity = index->capacity ? index->capacity : STACK_INITIAL_CAPACITY;
+  while (table_capacity < 2 * n) {
+    table_capacity *= 2;
+  }
+  if (table_capacity == index->capacity) {
+    return STACK_OK;
+  }
+  IndexEntry *entries = allocator->alloc_func(allocator->ctx, table_capacity * sizeof(IndexEntry));
+  if (!entries) {
+    return STACK_ERROR_NO_MEMORY;
+  }
+  for (size_t i = 0; i < table_capacity; ++i) {
+    entries[i].index = INDEX_NONE;
+  }
+  for (size_t i = 0; i < index->capacity; ++i) {
+    if (index->entries[i].index == INDEX_NONE) {
+      continue;
+    }
+    size_t pos = index->entries[i].hash & (table_capacity - 1);
+    while (entries[pos].index != INDEX_NONE) {
+      pos = (pos + 1) & (table_capacity - 1);
+    }
+    entries[pos] = index->entries[i];
+  }
+  if (index->entries) {
+    allocator->free_func(allocator->ctx, index->entries, index->capacity * sizeof(IndexEntry));
+  }
+  index->entries = entries;
+  index->capacity = table_capacity;
+  return STACK_OK;
+}
+
+/**
+ * @brief Adds the element at position i to the index.
+ *
+ * i must be above every indexed element and index_reserve() must have made
+ * room for it.
+ *
+ * @param stack Pointer to the Stack.
+ * @param i Position of the element.
+ */
+static void index_insert(Stack *stack, size_t i) {
+  if (!stack->hash) {
+    return;
+  }
+  const void *element = element_at(stack, i);
+  size_t hash = stack->hash(element);
+  size_t pos = index_slot(stack, element, hash);
+  IndexEntry *entry = &stack->index->entries[pos];
+  stack->index->below[i] = entry->index;
+  entry->hash = hash;
+  entry->index = i;
+}
+
+/**
+ * @brief Removes the element at position i, the topmost indexed one, from the
+ * index.
+ *
+ * Empty table slots are refilled by shifting later entries of the probe
+ * sequence back, so lookups never need tombstones.
+ *
+ * @param stack Pointer to the Stack.
+ * @param i Position of the element.
+ */
+static void index_remove(Stack *stack, size_t i) {
+  if (!stack->hash) {
+    return;
+  }
+  StackIndex *index = stack->index;
+  const void *element = element_at(stack, i);
+  size_t pos = index_slot(stack, element, stack->hash(element));
+  index->entries[pos].index = index->below[i];
+  if (index->below[i] != INDEX_NONE) {
+    return;
+  }
+  size_t mask = index->capacity - 1;
+  size_t next = pos;
+  for (;;) {
+    next = (next + 1) & mask;
+    if (index->entries[next].index == INDEX_NONE) {
+      break;
+    }
+    size_t home = index->entries[next].hash & mask;
+    bool movable = pos <= next ? (home <= pos || home > next) : (home <= pos && home > next);
+    if (movable) {
+      index->entries[pos] = index->entries[next];
+      index->entries[next].index = INDEX_NONE;
+      pos = next;
+    }
+  }
+}
+
+/**
+ * @brief Re-creates the index for the current elements.
+ *
+ * index_reserve() must have made room for all elements.
+ *
+ * @param stack Pointer to the Stack.
+ */
+static void index_rebuild(Stack *stack) {
+  if (!stack->index) {
+    return;
+  }
+  for (size_t i = 0; i < stack->index->capacity; ++i) {
+    stack->index->entries[i].index = INDEX_NONE;
+  }
+  for (size_t i = 0; i < stack->size; ++i) {
+    index_insert(stack, i);
+  }
+}
+
+/**
+ * @brief Looks up the topmost element equal to element.
+ *
+ * @param stack Pointer to a Stack with a hash function.
+ * @param element Pointer to the element to search for.
+ *
+ * @return Position of the match, or INDEX_NONE.
+ */
+static size_t index_find(const Stack *stack, const void *element) {
+  if (!stack->index || stack->size == 0) {
+    return INDEX_NONE;
+  }
+  return stack->index->entries[index_slot(stack, element, stack->hash(element))].index;
+}
+
+/**
+ * @brief Releases the index.
+ *
+ * @param stack Pointer to the Stack.
+ */
+static void index_free(Stack *stack) {
+  StackIndex *index = stack->index;
+  if (!index) {
+    return;
+  }
+  const StackAllocator *allocator = &stack->allocator;
+  if (index->entries) {
+    allocator->free_func(allocator->ctx, index->entries, index->capacity * sizeof(IndexEntry));
+  }
+  if (index->below) {
+    allocator->free_func(allocator->ctx, index->below, index->below_capacity * sizeof(size_t));
+  }
+  allocator->free_func(allocator->ctx, index, sizeof(StackIndex));
+  stack->index = NULL;
+}
+
+/**
+ * @brief Frees the elements in a range of slots.
+ *
+ * Hands the whole range to batch_free in one call when the stack has one (two
+ * when it wraps around a ring), and calls free_func per element otherwise.
+ * Stacks that own no element memory (inline, arena or without free function)
+ * skip the range entirely.
+ *
+ * @param stack Pointer to the Stack.
+ * @param from Index of the first element to free.
+ * @param to Index one past the last element to free.
+ */
+static void free_range(Stack *stack, size_t from, size_t to) {
+  if (stack->element_size || stack->arena_copy || from == to) {
+    return;
+  }
+  if (stack->batch_free) {
+    while (from < to) {
+      size_t run = run_length(stack, from, to - from);
+      stack->batch_free(pointer_slot(stack, from), run);
+      stat_callbacks(stack, 0, 1);
+      from += run;
+    }
+  } else if (stack->free_func) {
+    for (size_t i = from; i < to; ++i) {
+      stack->free_func(*pointer_slot(stack, i));
+    }
+    stat_callbacks(stack, 0, to - from);
+  }
+}
+
+/**
+ * @brief Closes every open mark, so that rollback() and commit() reject them.
+ *
+ * @param stack Pointer to the Stack.
+ */
+static void close_marks(Stack *stack) {
+  stack->open_mark = 0;
+  stack->mark_floor = 0;
+}
+
+/**
+ * @brief Records that the elements from a position up were removed or moved.
+ *
+ * Reaching below the innermost open mark closes all marks: the elements a
+ * mark keeps are no longer the ones it was taken over.
+ *
+ * @param stack Pointer to the Stack.
+ * @param from Lowest position that changed.
+ */
+static void changed_from(Stack *stack, size_t from) {
+  if (from < stack->mark_floor) {
+    close_marks(stack);
+  }
+}
+
+/**
+ * @brief Removes the elements above a given size.
+ *
+ * Frees them like clear() would.
+ *
+ * @param stack Pointer to the Stack.
+ * @param new_size Number of elements to keep (must not exceed the size).
+ */
+static void truncate_to(Stack *stack, size_t new_size) {
+  changed_from(stack, new_size);
+  for (size_t i = stack->size; stack->hash && i > new_size; --i) {
+    index_remove(stack, i - 1);
+  }
+  free_range(stack, new_size, stack->size);
+  stack->size = new_size;
+}
+
+/**
+ * @brief Computes the capacity that follows current under the growth policy.
+ *
+ * The result is clamped to the policy's max_capacity, if any.
+ *
+ * @param stack Pointer to the Stack.
+ * @param current Current capacity.
+ *
+ * @return Next capacity, equal to current if the maximum has been reached.
+ */
+static size_t next_capacity(const Stack *stack, size_t current) {
+  const StackGrowthPolicy *policy = &stack->growth;
+  size_t next;
+  if (current == 0) {
+    next = STACK_INITIAL_CAPACITY;
+  } else if (policy->chunk) {
+    next = current > SIZE_MAX - policy->chunk ? SIZE_MAX : current + policy->chunk;
+  } else {
+    double grown = (double)current * policy->factor;
+    next = grown >= (double)SIZE_MAX ? SIZE_MAX : (size_t)grown;
+    if (next <= current) {
+      next = current + 1;
+    }
+  }
+  if (policy->max_capacity && next > policy->max_capacity) {
+    next = policy->max_capacity;
+  }
+  return next;
+}
+
+/**
+ * @brief Returns the header of a file-backed stack.
+ *
+ * @param stack Pointer to a file-backed Stack.
+ *
+ * @return Pointer to the mapped FileHeader.
+ */
+static inline FileHeader *file_header(const Stack *stack) {
+  return (FileHeader *)((unsigned char *)stack->data - STACK_FILE_HEADER_SIZE);
+}
+
+/**
+ * @brief Returns the length of the file mapping for a given capacity.
+ *
+ * @param stack Pointer to a file-backed Stack.
+ * @param capacity Number of slots.
+ *
+ * @return Length in bytes, or 0 if it overflows.
+ */
+static size_t file_length(const Stack *stack, size_t capacity) {
+  if (capacity > (SIZE_MAX - STACK_FILE_HEADER_SIZE) / stack->stride) {
+    return 0;
+  }
+  return STACK_FILE_HEADER_SIZE + capacity * stack->stride;
+}
+
+/**
+ * @brief Maps the first length bytes of a stack file.
+ *
+ * @param fd Open stack file.
+ * @param length Length of the mapping.
+ *
+ * @return Pointer to the mapping, or NULL on failure.
+ */
+static void *map_file(int fd, size_t length) {
+  void *map = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  return map == MAP_FAILED ? NULL : map;
+}
+
+/**
+ * @brief Resizes the backing file and its mapping to new_capacity slots.
+ *
+ * A growing file is extended before the new mapping is made, and a shrinking
+ * one truncated after the old mapping is gone, so the mapping never extends
+ * past the end of the file. The stack is left untouched on failure.
+ *
+ * @param stack Pointer to a file-backed Stack.
+ * @param new_capacity New capacity (must not be below the size).
+ *
+ * @return STACK_OK on success, STACK_ERROR_NO_MEMORY on failure.
+ */
+static StackStatus file_resize(Stack *stack, size_t new_capacity) {
+  size_t old_length = file_length(stack, stack->capacity);
+  size_t new_length = file_length(stack, new_capacity);
+  if (new_length == 0 || (off_t)new_length < 0) {
+    return STACK_ERROR_NO_MEMORY;
+  }
+  if (new_length > old_length && ftruncate(stack->fd, (off_t)new_length) != 0) {
+    return STACK_ERROR_NO_MEMORY;
+  }
+  unsigned char *map = map_file(stack->fd, new_length);
+  if (!map) {
+    return STACK_ERROR_NO_MEMORY;
+  }
+  munmap(file_header(stack), old_length);
+  if (new_length < old_length) {
+    int truncated = ftruncate(stack->fd, (off_t)new_length);
+    (void)truncated; // A failed truncation only leaves unused space at the end of the file.
+  }
+  size_t old_capacity = stack->capacity;
+  stack->data = (void **)(map + STACK_FILE_HEADER_SIZE);
+  stack->capacity = new_capacity;
+  stat_resize(stack, old_capacity, new_length);
+  return STACK_OK;
+}
+
+/**
+ * @brief Reallocates the stack buffer to exactly new_capacity slots.
+ *
+ * Capacities that fit in the small buffer move the elements back into it and
+ * release the heap buffer; larger ones move them out on the first overflow.
+ *
+ * The stack is left untouched on failure.
+ *
+ * @param stack Pointer to the Stack.
+ * @param new_capacity New capacity (must not be below the size).
+ *
+ * @return STACK_OK on success, STACK_ERROR_NO_MEMORY if the allocation fails
+ * or its byte size overflows.
+ */
+static StackStatus resize(Stack *stack, size_t new_capacity) {
+  if (stack->fd >= 0) {
+    return file_resize(stack, new_capacity);
+  }
+  if (new_capacity <= stack->small_capacity) {
+    if (!uses_small(stack)) {
+      if (stack->size) {
+        memcpy(stack->small, stack->data, stack->size * stack->stride);
+      }
+      stack->allocator.free_func(stack->allocator.ctx, stack->data,
+                                 stack->capacity * stack->stride);
+      stack->data = (void **)stack->small;
+    }
+    stack->capacity = stack->small_capacity;
+    return STACK_OK;
+  }
+  if (new_capacity > SIZE_MAX / stack->stride) {
+    return STACK_ERROR_NO_MEMORY;
+  }
+  const StackAllocator *allocator = &stack->allocator;
+  void **new_data;
+  if (uses_small(stack)) {
+    new_data = allocator->alloc_func(allocator->ctx, new_capacity * stack->stride);
+    if (new_data && stack->size) {
+      memcpy(new_data, stack->data, stack->size * stack->stride);
+    }
+  } else {
+    new_data = allocator->realloc_func(allocator->ctx, stack->data,
+                                       stack->capacity * stack->stride,
+                                       new_capacity * stack->stride);
+  }
+  if (!new_data) {
+    return STACK_ERROR_NO_MEMORY;
+  }
+  size_t old_capacity = stack->capacity;
+  stack->data = new_data;
+  stack->capacity = new_capacity;
+  stat_resize(stack, old_capacity, new_capacity * stack->stride);
+  return STACK_OK;
+}
+
+/**
+ * @brief Grows the stack until it can hold at least min_capacity elements.
+ *
+ * Called automatically when the stack runs out of space. Steps through the
+ * capacities of the growth policy and performs a single reallocation.
+ *
+ * @param stack Pointer to the Stack.
+ * @param min_capacity Required capacity.
+ *
+ * @return STACK_OK on success, STACK_ERROR_FULL if min_capacity exceeds the
+ * maximum capacity, or STACK_ERROR_NO_MEMORY on allocation failure.
+ */
+static StackStatus grow(Stack *stack, size_t min_capacity) {
+  if (min_capacity <= stack->capacity) {
+    return STACK_OK;
+  }
+  if (stack->growth.max_capacity && min_capacity > stack->growth.max_capacity) {
+    return STACK_ERROR_FULL;
+  }
+  size_t new_capacity = stack->capacity;
+  while (new_capacity < min_capacity) {
+    new_capacity = next_capacity(stack, new_capacity);
+  }
+  return resize(stack, new_capacity);
+}
+
+/**
+ * @brief Removes the bottom element of a drop_oldest stack.
+ *
+ * Frees the element and advances head in O(1): the freed slot is the one the
+ * next push writes to.
+ *
+ * @param stack Pointer to a non-empty drop_oldest Stack.
+ */
+static void drop_bottom(Stack *stack) {
+  free_range(stack, 0, 1);
+  --stack->size;
+  stack->head = slot_index(stack, 1);
+}
+
+/**
+ * @brief Checks whether the stack holds as many elements as its growth
+ * policy allows.
+ *
+ * drop_oldest stacks never count as full, since they drop their bottom
+ * element instead.
+ *
+ * @param stack Pointer to the Stack.
+ *
+ * @return true if one more push would exceed max_capacity.
+ */
+static bool at_max_capacity(const Stack *stack) {
+  return !stack->drop_oldest && stack->growth.max_capacity &&
+         stack->size >= stack->growth.max_capacity;
+}
+
+/**
+ * @brief Makes room for one more element.
+ *
+ * The buffer may already have room past max_capacity, e.g. when the policy
+ * was lowered after growth or the small buffer is larger than the limit, so
+ * the limit is checked before the capacity.
+ *
+ * @param stack Pointer to the Stack.
+ *
+ * @return STACK_OK on success, STACK_ERROR_FULL at max_capacity, or the
+ * reason grow() failed.
+ */
+static StackStatus make_room(Stack *stack) {
+  if (at_max_capacity(stack)) {
+    return STACK_ERROR_FULL;
+  }
+  if (stack->size < stack->capacity) {
+    return STACK_OK;
+  }
+  if (stack->drop_oldest) {
+    drop_bottom(stack);
+    return STACK_OK;
+  }
+  return grow(stack, stack->size + 1);
+}
+
+/**
+ * @brief Preallocates the buffer of a bounded stack.
+ *
+ * @param stack Pointer to a freshly set up Stack.
+ *
+ * @return STACK_OK on success, STACK_ERROR_NO_MEMORY on allocation failure.
+ */
+static StackStatus setup_bound(Stack *stack) {
+  if (!stack->bound) {
+    return STACK_OK;
+  }
+  stack->growth = (StackGrowthPolicy){STACK_DEFAULT_GROWTH_FACTOR, 0, stack->bound};
+  StackStatus status = resize(stack, stack->bound);
+  if (status != STACK_OK) {
+    return status;
+  }
+  stack->capacity = stack->bound;
+  return STACK_OK;
+}
+
+/**
+ * @brief Checks that a set of options describes a valid stack.
+ *
+ * @param options Pointer to the StackOptions.
+ *
+ * @return true if a stack can be built from the options.
+ */
+static bool valid_options(const StackOptions *options) {
+  if (!options) {
+    return false;
+  }
+  if (options->element_size && options->arena_copy_func) {
+    return false;
+  }
+  if (options->drop_oldest && (!options->bound || options->arena_copy_func)) {
+    return false;
+  }
+  if (options->hash_func && (!options->cmp_func || options->drop_oldest)) {
+    return false;
+  }
+  const StackAllocator *allocator = options->allocator;
+  if (allocator && (!allocator->alloc_func || !allocator->realloc_func || !allocator->free_func)) {
+    return false;
+  }
+  if (options->huge_pages > STACK_HUGE_PAGES_EXPLICIT ||
+      options->numa_policy > STACK_NUMA_INTERLEAVE || options->numa_nodes > UINTPTR_MAX >> 4) {
+    return false;
+  }
+  if (allocator && (options->huge_pages || options->numa_policy)) {
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Sets the initial values for the fields of a stack header.
+ *
+ * @param stack Pointer to uninitialized memory for the Stack.
+ * @param options Pointer to validated StackOptions.
+ * @param inline_slots Number of slots available in the small buffer.
+ */
+static void setup(Stack *stack, const StackOptions *options, size_t inline_slots) {
+  stack->element_size = options->element_size;
+  stack->stride = options->element_size ? options->element_size : sizeof(void *);
+  stack->small_capacity = inline_slots;
+  stack->capacity = inline_slots;
+  stack->data = (void **)stack->small;
+  stack->size = 0;
+  stack->copy = options->element_size ? NULL : options->copy_func;
+  stack->free_func = options->element_size ? NULL : options->free_func;
+  stack->batch_free = options->element_size ? NULL : options->batch_free_func;
+  stack->cmp = options->cmp_func;
+  stack->bound = 0;
+  stack->head = 0;
+  stack->fd = -1;
+  stack->hash = options->hash_func;
+  stack->index = NULL;
+  stack->mark_count = 0;
+  stack->open_mark = 0;
+  stack->mark_floor = 0;
+#ifdef STACK_STATS
+  stack->stats = (StackStats){0};
+  stack->growth_hook = NULL;
+  stack->growth_hook_ctx = NULL;
+#endif
+  stack->drop_oldest = options->drop_oldest;
+  stack->growth = (StackGrowthPolicy){STACK_DEFAULT_GROWTH_FACTOR, 0, 0};
+  set_growth_policy(stack, &options->growth);
+  stack->bound = options->bound;
+  stack->allocator = allocator_of(options);
+  stack->arena_copy = options->arena_copy_func;
+  stack->arena.head = NULL;
+  stack->arena.allocator = &stack->allocator;
+  stack->heap_header = false;
+}
+
+/**
+ * @brief Allocates a stack header together with its small buffer.
+ *
+ * @param options Pointer to validated StackOptions.
+ *
+ * @return Pointer to the new Stack, or NULL on allocation failure.
+ */
+static Stack *create(const StackOptions *options) {
+  size_t stride = options->element_size ? options->element_size : sizeof(void *);
+  if (options->inline_slots > (SIZE_MAX - sizeof(Stack)) / stride) {
+    return NULL;
+  }
+  StackAllocator allocator = allocator_of(options);
+  Stack *stack = allocator.alloc_func(allocator.ctx, sizeof(Stack) + options->inline_slots * stride);
+  if (!stack) {
+    return NULL;
+  }
+  setup(stack, options, options->inline_slots);
+  stack->heap_header = true;
+  if (setup_bound(stack) != STACK_OK) {
+    allocator.free_func(allocator.ctx, stack, sizeof(Stack) + options->inline_slots * stride);
+    return NULL;
+  }
+  return stack;
+}
+
+/**
+ * @brief Rebuilds the options a stack was created with.
+ *
+ * @param stack Pointer to the Stack.
+ *
+ * @return Options producing an empty stack with the same configuration.
+ */
+static StackOptions options_of(const Stack *stack) {
+  StackOptions options = {0};
+  options.element_size = stack->element_size;
+  options.inline_slots = stack->small_capacity;
+  options.copy_func = stack->copy;
+  options.free_func = stack->free_func;
+  options.batch_free_func = stack->batch_free;
+  options.cmp_func = stack->cmp;
+  options.growth = stack->growth;
+  options.allocator = &stack->allocator;
+  options.arena_copy_func = stack->arena_copy;
+  options.bound = stack->bound;
+  options.drop_oldest = stack->drop_oldest;
+  options.hash_func = stack->hash;
+  return options;
+}
+
+/**
+ * @brief Initializes a new stack structure.
+ * 
+ * Allocates memory and sets initial values for fields.
+ * 
+ * No elements are present upon creation.
+ * 
+ * A NULL copy_func makes the stack move-only: elements can only be added with
+ * push_owned(). A NULL free_func leaves element memory to the caller.
+ *
+ * @param copy_func Function to copy elements (may be NULL).
+ * @param free_func Function to free elements (may be NULL).
+ * @param cmp_func Function to compare elements (optional, may be NULL).
+ *
+ * @return Pointer to the new Stack, or NULL on allocation failure.
+ */
+Stack *new_stack(StackCopyFunc copy_func, StackFreeFunc free_func, StackCompareFunc cmp_func) {
+  return new_small_stack(STACK_INITIAL_CAPACITY, copy_func, free_func, cmp_func);
+}
+
+/**
+ * @brief Initializes a new stack structure with a small buffer of the given
+ * size.
+ *
+ * The first inline_slots elements are stored inside the Stack allocation, so
+ * stacks that stay small need a single malloc in total. With 0 slots no buffer
+ * is allocated until the first push.
+ *
+ * @param inline_slots Number of slots stored inside the Stack allocation.
+ * @param copy_func Function to copy elements (may be NULL).
+ * @param free_func Function to free elements (may be NULL).
+ * @param cmp_func Function to compare elements (optional, may be NULL).
+ *
+ * @return Pointer to the new Stack, or NULL on allocation failure.
+ */
+Stack *new_small_stack(size_t inline_slots, StackCopyFunc copy_func, StackFreeFunc free_func,
+                       StackCompareFunc cmp_func) {
+  StackOptions options = {0};
+  options.inline_slots = inline_slots;
+  options.copy_func = copy_func;
+  options.free_func = free_func;
+  options.cmp_func = cmp_func;
+  return create(&options);
+}
+
+/**
+ * @brief Initializes a new inline stack structure.
+ *
+ * Elements are stored by value in a packed buffer, so no per-element
+ * allocation takes place and no copy or free function is needed.
+ *
+ * @param elem_size Size in bytes of each element (must not be 0).
+ * @param cmp_func Function to compare elements (optional, may be NULL).
+ *
+ * @return Pointer to the new Stack, or NULL if elem_size is 0 or on
+ * allocation failure.
+ */
+Stack *new_inline_stack(size_t elem_size, StackCompareFunc cmp_func) {
+  if (elem_size == 0) {
+    return NULL;
+  }
+  StackOptions options = {0};
+  options.element_size = elem_size;
+  options.inline_slots = STACK_INITIAL_CAPACITY;
+  options.cmp_func = cmp_func;
+  return create(&options);
+}
+
+/**
+ * @brief Initializes a new integer stack structure.
+ *
+ * An inline stack whose elements are width_bits / 8 bytes wide. Its small
+ * buffer takes as many bytes as that of a pointer stack, so it holds more
+ * of the narrower slots.
+ *
+ * @param width_bits Width of each value in bits: 8, 16 or 32.
+ *
+ * @return Pointer to the new Stack, or NULL for an unsupported width or on
+ * allocation failure.
+ */
+Stack *new_int_stack(size_t width_bits) {
+  if (width_bits != 8 && width_bits != 16 && width_bits != 32) {
+    return NULL;
+  }
+  StackOptions options = {0};
+  options.element_size = width_bits / 8;
+  options.inline_slots = STACK_INITIAL_CAPACITY * sizeof(void *) / options.element_size;
+  return create(&options);
+}
+
+/**
+ * @brief Initializes a new bounded stack structure.
+ *
+ * The buffer of bound slots is allocated here and never resized. drop_oldest
+ * stacks use it as a ring, so dropping the bottom element is O(1).
+ *
+ * @param bound Fixed capacity (must not be 0).
+ * @param drop_oldest Whether a full stack drops its bottom element.
+ * @param copy_func Function to copy elements (may be NULL).
+ * @param free_func Function to free elements (may be NULL).
+ * @param cmp_func Function to compare elements (optional, may be NULL).
+ *
+ * @return Pointer to the new Stack, or NULL if bound is 0 or on allocation
+ * failure.
+ */
+Stack *new_bounded_stack(size_t bound, bool drop_oldest, StackCopyFunc copy_func,
+                         StackFreeFunc free_func, StackCompareFunc cmp_func) {
+  if (bound == 0) {
+    return NULL;
+  }
+  StackOptions options = {0};
+  options.copy_func = copy_func;
+  options.free_func = free_func;
+  options.cmp_func = cmp_func;
+  options.bound = bound;
+  options.drop_oldest = drop_oldest;
+  return create(&options);
+}
+
+/**
+ * @brief Maps an open stack file as the buffer of an empty inline stack.
+ *
+ * @param stack Pointer to an empty inline Stack without a heap buffer.
+ * @param fd Open stack file.
+ *
+ * @return true on success, false if the file cannot be mapped or is not a
+ * stack file for the element size of the stack.
+ */
+static bool attach_file(Stack *stack, int fd) {
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    return false;
+  }
+  size_t length = (size_t)st.st_size;
+  bool fresh = length == 0;
+  if (fresh) {
+    length = file_length(stack, STACK_INITIAL_CAPACITY);
+    if (ftruncate(fd, (off_t)length) != 0) {
+      return false;
+    }
+  } else if (length < STACK_FILE_HEADER_SIZE) {
+    return false;
+  }
+  unsigned char *map = map_file(fd, length);
+  if (!map) {
+    return false;
+  }
+  FileHeader *header = (FileHeader *)map;
+  size_t file_capacity = (length - STACK_FILE_HEADER_SIZE) / stack->stride;
+  if (fresh) {
+    memcpy(header->magic, STACK_FILE_MAGIC, sizeof(header->magic));
+    header->element_size = stack->element_size;
+    header->size = 0;
+  } else if (memcmp(header->magic, STACK_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+             header->element_size != stack->element_size || header->size > file_capacity) {
+    munmap(map, length);
+    return false;
+  }
+  stack->fd = fd;
+  stack->data = (void **)(map + STACK_FILE_HEADER_SIZE);
+  stack->capacity = file_capacity;
+  stack->size = (size_t)header->size;
+  return true;
+}
+
+/**
+ * @brief Opens a file-backed inline stack.
+ *
+ * A new or empty file gets a header and room for the initial capacity. An
+ * existing file must carry the stack file magic and the same element size;
+ * its recorded size is restored and the rest of the file counts as capacity.
+ *
+ * @param path Path of the backing file.
+ * @param elem_size Size in bytes of each element (must not be 0).
+ * @param cmp_func Function to compare elements (optional, may be NULL).
+ *
+ * @return Pointer to the new Stack, or NULL if elem_size is 0, the file
+ * cannot be opened or mapped, or it is not a stack file for elem_size.
+ */
+Stack *open_file_stack(const char *path, size_t elem_size, StackCompareFunc cmp_func) {
+  if (!path || elem_size == 0) {
+    return NULL;
+  }
+  StackOptions options = {0};
+  options.element_size = elem_size;
+  options.cmp_func = cmp_func;
+  Stack *stack = create(&options);
+  if (!stack) {
+    return NULL;
+  }
+  int fd = open(path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0 || !attach_file(stack, fd)) {
+    if (fd >= 0) {
+      close(fd);
+    }
+    free_stack(stack);
+    return NULL;
+  }
+  return stack;
+}
+
+/**
+ * @brief Initializes a new stack structure from a set of options.
+ *
+ * Zeroed fields select the defaults: a pointer stack, no small buffer, the
+ * doubling growth policy and malloc().
+ *
+ * @param options Pointer to the StackOptions.
+ *
+ * @return Pointer to the new Stack, or NULL if the options are invalid or on
+ * allocation failure.
+ */
+Stack *new_stack_with_options(const StackOptions *options) {
+  if (!valid_options(options)) {
+    return NULL;
+  }
+  return create(options);
+}
+
+/**
+ * @brief Constructs a stack inside caller-owned storage.
+ *
+ * The header occupies the start of the storage and any bytes beyond it are
+ * used as the small buffer, so a generously sized buffer avoids heap
+ * allocations altogether.
+ *
+ * @param storage Memory for the stack, aligned to STACK_STORAGE_ALIGN.
+ * @param storage_size Size of storage in bytes (at least STACK_STORAGE_SIZE).
+ * @param copy_func Function to copy elements (may be NULL).
+ * @param free_func Function to free elements (may be NULL).
+ * @param cmp_func Function to compare elements (optional, may be NULL).
+ *
+ * @return Pointer to the Stack inside storage, or NULL if the storage is too
+ * small or misaligned.
+ */
+Stack *init_stack(void *storage, size_t storage_size, StackCopyFunc copy_func,
+                  StackFreeFunc free_func, StackCompareFunc cmp_func) {
+  StackOptions options = {0};
+  options.copy_func = copy_func;
+  options.free_func = free_func;
+  options.cmp_func = cmp_func;
+  return init_stack_with_options(storage, storage_size, &options);
+}
+
+/**
+ * @brief Constructs a stack described by a set of options inside
+ * caller-owned storage.
+ *
+ * options->inline_slots is ignored: the bytes beyond the header determine
+ * the size of the small buffer.
+ *
+ * @param storage Memory for the stack, aligned to STACK_STORAGE_ALIGN.
+ * @param storage_size Size of storage in bytes (at least STACK_STORAGE_SIZE).
+ * @param options Pointer to the StackOptions.
+ *
+ * @return Pointer to the Stack inside storage, or NULL if the storage is too
+ * small or misaligned or the options are invalid.
+ */
+Stack *init_stack_with_options(void *storage, size_t storage_size, const StackOptions *options) {
+  if (!storage || storage_size < STACK_STORAGE_SIZE || !valid_options(options)) {
+    return NULL;
+  }
+  if ((uintptr_t)storage % STACK_STORAGE_ALIGN != 0) {
+    return NULL;
+  }
+  size_t stride = options->element_size ? options->element_size : sizeof(void *);
+  Stack *stack = storage;
+  setup(stack, options, (storage_size - sizeof(Stack)) / stride);
+  if (setup_bound(stack) != STACK_OK) {
+    return NULL;
+  }
+  return stack;
+}
+
+/**
+ * @brief Releases the elements and buffer of a stack without freeing the
+ * header.
+ *
+ * Calls clear() to free each element and then releases the heap buffer, if
+ * any. The storage of an init_stack() stack may be reused afterwards.
+ *
+ * File-backed stacks record their size in the file header, unmap it and close
+ * the file instead; the elements stay in the file.
+ *
+ * @param stack Pointer to the Stack.
+ */
+void deinit_stack(Stack *stack) {
+  if (!stack) {
+    return;
+  }
+  if (stack->fd >= 0) {
+    file_header(stack)->size = stack->size;
+    munmap(file_header(stack), file_length(stack, stack->capacity));
+    close(stack->fd);
+    stack->fd = -1;
+    stack->size = 0;
+    stack->data = (void **)stack->small;
+    stack->capacity = stack->small_capacity;
+    return;
+  }
+  clear(stack);
+  index_free(stack);
+  arena_reset(&stack->arena, false);
+  if (!uses_small(stack)) {
+    stack->allocator.free_func(stack->allocator.ctx, stack->data,
+                               stack->capacity * stack->stride);
+  }
+  stack->data = (void **)stack->small;
+  stack->capacity = stack->small_capacity;
+}
+
+/**
+ * @brief Frees all memory associated with the stack.
+ * 
+ * All the elements and the stack itself are free.
+ *
+ * Calls deinit_stack() to free each element and the buffer, then releases the
+ * header unless it lives in caller-provided storage.
+ *
+ * @param stack Pointer to the Stack.
+ */
+void free_stack(Stack *stack) {
+  if (!stack) {
+    return;
+  }
+  deinit_stack(stack);
+  if (stack->heap_header) {
+    StackAllocator allocator = stack->allocator;
+    allocator.free_func(allocator.ctx, stack, sizeof(Stack) + stack->small_capacity * stack->stride);
+  }
+}
+
+/**
+ * @brief Frees the stacks queued by free_stack_async(), oldest first.
+ *
+ * @param arg Unused.
+ *
+ * @return Never returns.
+ */
+static void *reclaim_loop(void *arg) {
+  (void)arg;
+  pthread_mutex_lock(&reclaimer.lock);
+  for (;;) {
+    while (!reclaimer.head) {
+      pthread_cond_wait(&reclaimer.work, &reclaimer.lock);
+    }
+    ReclaimNode *node = reclaimer.head;
+    reclaimer.head = node->next;
+    if (!reclaimer.head) {
+      reclaimer.tail = NULL;
+    }
+    pthread_mutex_unlock(&reclaimer.lock);
+    free_stack(node->stack);
+    free(node);
+    pthread_mutex_lock(&reclaimer.lock);
+    if (--reclaimer.pending == 0) {
+      pthread_cond_broadcast(&reclaimer.idle);
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief Frees the stack on a background reclaimer thread.
+ *
+ * The calling thread only queues the stack, so tearing down a large stack
+ * does not stall it. The stack must not be used afterwards. free_func,
+ * batch_free_func and the allocator hooks run on the reclaimer thread and
+ * must be safe to call from it.
+ *
+ * Stacks constructed in caller-provided storage, and any stack when the
+ * reclaimer cannot be started or the queue entry cannot be allocated, are
+ * freed synchronously instead.
+ *
+ * @param stack Pointer to the Stack.
+ *
+ * @return true if the stack was queued, false if it was freed synchronously.
+ */
+bool free_stack_async(Stack *stack) {
+  if (!stack) {
+    return false;
+  }
+  ReclaimNode *node = stack->heap_header ? malloc(sizeof(ReclaimNode)) : NULL;
+  if (!node) {
+    free_stack(stack);
+    return false;
+  }
+  node->stack = stack;
+  node->next = NULL;
+  pthread_mutex_lock(&reclaimer.lock);
+  if (!reclaimer.started) {
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    reclaimer.started = pthread_create(&thread, &attr, reclaim_loop, NULL) == 0;
+    pthread_attr_destroy(&attr);
+    if (!reclaimer.started) {
+      pthread_mutex_unlock(&reclaimer.lock);
+      free(node);
+      free_stack(stack);
+      return false;
+    }
+  }
+  if (reclaimer.tail) {
+    reclaimer.tail->next = node;
+  } else {
+    reclaimer.head = node;
+  }
+  reclaimer.tail = node;
+  ++reclaimer.pending;
+  pthread_cond_signal(&reclaimer.work);
+  pthread_mutex_unlock(&reclaimer.lock);
+  return true;
+}
+
+/**
+ * @brief Waits until every stack queued by free_stack_async() has been freed.
+ */
+void wait_stack_reclaimer(void) {
+  pthread_mutex_lock(&reclaimer.lock);
+  while (reclaimer.pending > 0) {
+    pthread_cond_wait(&reclaimer.idle, &reclaimer.lock);
+  }
+  pthread_mutex_unlock(&reclaimer.lock);
+}
+
+/**
+ * @brief Pushes a new element onto the stack.
+ * 
+ * Adds a new element to the stack, resizing if necessary.
+ * 
+ * The element is copied using the user-supplied copy function.
+ *
+ * @param stack Pointer to the Stack.
+ * @param element Pointer to the element to push.
+ *
+ * @return true if the element was pushed, false otherwise.
+ */
+bool push(Stack *stack, const void *element) {
+  return try_push(stack, element) == STACK_OK;
+}
+
+/**
+ * @brief Pushes a new element onto the stack and reports why it failed.
+ *
+ * Nothing is pushed on failure. A copy_func returning NULL is reported as an
+ * allocation failure.
+ *
+ * @param stack Pointer to the Stack.
+ * @param element Pointer to the element to push.
+ *
+ * @return STACK_OK on success, or the reason the element was not pushed.
+ */
+StackStatus try_push(Stack *stack, const void *element) {
+  if (!stack) {
+    return STACK_ERROR_NULL;
+  }
+  if (!can_copy(stack)) {
+    return STACK_ERROR_UNSUPPORTED;
+  }
+  if (stack->element_size) {
+    StackStatus status = make_room(stack);
+    if (status == STACK_OK) {
+      status = index_reserve(stack, stack->size + 1);
+    }
+    if (status != STACK_OK) {
+      return status;
+    }
+    memcpy(slot(stack, stack->size), element, stack->element_size);
+    index_insert(stack, stack->size++);
+    stat_push(stack, 1);
+    return STACK_OK;
+  }
+  if (at_max_capacity(stack)) {
+    return STACK_ERROR_FULL;
+  }
+  if (stack->size == stack->capacity && !stack->drop_oldest) {
+    StackStatus status = grow(stack, stack->size + 1);
+    if (status != STACK_OK) {
+      return status;
+    }
+  }
+  if (index_reserve(stack, stack->size + 1) != STACK_OK) {
+    return STACK_ERROR_NO_MEMORY;
+  }
+  void *copy = copy_element(stack, element);
+  if (!copy) {
+    return STACK_ERROR_NO_MEMORY;
+  }
+  make_room(stack); // Cannot fail: the buffer has room or the bottom is dropped.
+  *pointer_slot(stack, stack->size) = copy;
+  index_insert(stack, stack->size++);
+  stat_push(stack, 1);
+  return STACK_OK;
+}
+
+/**
+ * @brief Pushes an element onto the stack, taking ownership of it.
+ *
+ * The pointer is stored as-is without calling copy_func; the stack frees it
+ * with free_func like any other element.
+ *
+ * @param stack Pointer to the Stack.
+ * @param element Pointer to the element to push.
+ *
+ * @return true if the element was pushed, false otherwise.
+ */
+bool push_owned(Stack *stack, void *element) {
+  return try_push_owned(stack, element) == STACK_OK;
+}
+
+/**
+ * @brief Pushes an element onto the stack, taking ownership of it, and reports
+ * why it failed.
+ *
+ * On failure ownership stays with the caller.
+ *
+ * @param stack Pointer to the Stack.
+ * @param element Pointer to the element to push.
+ *
+ * @return STACK_OK on success, or the reason the element was not pushed.
+ */
+StackStatus try_push_owned(Stack *stack, void *element) {
+  if (!stack) {
+    return STACK_ERROR_NULL;
+  }
+  if (stack->element_size) {
+    return STACK_ERROR_UNSUPPORTED;
+  }
+  StackStatus status = make_room(stack);
+  if (status == STACK_OK) {
+    status = index_reserve(stack, stack->size + 1);
+  }
+  if (status != STACK_OK) {
+    return status;
+  }
+  *pointer_slot(stack, stack->size) = element;
+  index_insert(stack, stack->size++);
+  stat_push(stack, 1);
+  return STACK_OK;
+}
+
+/**
+ * @brief Pushes count elements onto the stack.
+ *
+ * Reserves room for the whole batch once, then memcpys the batch for inline
+ * stacks or copies each element with copy_func for pointer stacks. With a
+ * maximum capacity only the elements that fit are pushed, and pointer stacks
+ * stop at the first element copy_func fails to copy. drop_oldest stacks push
+ * every element, dropping bottom elements as needed.
+ *
+ * @param stack Pointer to the Stack.
+ * @param elements Packed elements for inline stacks, or an array of element
+ * pointers for pointer stacks. The last element ends up on top.
+ * @param count Number of elements to push.
+ *
+ * @return Number of elements pushed.
+ */
+size_t push_n(Stack *stack, const void *elements, size_t count) {
+  if (!stack || !elements || count == 0) {
+    return 0;
+  }
+  if (!can_copy(stack)) {
+    return 0;
+  }
+  if (stack->drop_oldest) {
+    const unsigned char *bytes = elements;
+    const void *const *pointers = elements;
+    size_t pushed = 0;
+    while (pushed < count) {
+      const void *element = stack->element_size ? bytes + pushed * stack->stride : pointers[pushed];
+      if (try_push(stack, element) != STACK_OK) {
+        break;
+      }
+      ++pushed;
+    }
+    return pushed;
+  }
+  if (count > SIZE_MAX - stack->size) {
+    count = SIZE_MAX - stack->size;
+  }
+  size_t max = stack->growth.max_capacity;
+  if (max && count > max - stack->size) {
+    count = stack->size < max ? max - stack->size : 0;
+  }
+  if (count == 0 || grow(stack, stack->size + count) != STACK_OK) {
+    return 0;
+  }
+  if (index_reserve(stack, stack->size + count) != STACK_OK) {
+    return 0;
+  }
+  if (stack->element_size) {
+    memcpy(slot(stack, stack->size), elements, count * stack->stride);
+    for (size_t i = 0; i < count; ++i) {
+      index_insert(stack, stack->size++);
+    }
+    stat_push(stack, count);
+    return count;
+  }
+  const void *const *pointers = elements;
+  size_t pushed = 0;
+  while (pushed < count) {
+    void *copy = copy_element(stack, pointers[pushed]);
+    if (!copy) {
+      break;
+    }
+    *pointer_slot(stack, stack->size) = copy;
+    index_insert(stack, stack->size++);
+    ++pushed;
+  }
+  stat_push(stack, pushed);
+  return pushed;
+}
+
+/**
+ * @brief Removes and returns the top element from the stack.
+ * 
+ * Caller must free the returned element using free_func().
+ *
+ * For inline stacks the vacated slot is returned instead; it stays valid until
+ * the next push.
+ *
+ * @param stack Pointer to the Stack.
+ *
+ * @return Pointer to the removed element. Caller must be free it. Returns NULL
+ * if the stack is empty.
+ */
+void *pop(Stack *stack) {
+  if (!stack) {
+    return NULL;
+  }
+  if (stack->size == 0) {
+    return NULL;
+  }
+  index_remove(stack, --stack->size);
+  changed_from(stack, stack->size);
+  stat_pop(stack, 1);
+  if (stack->element_size) {
+    return slot(stack, stack->size);
+  }
+  void **top = pointer_slot(stack, stack->size);
+  void *element = *top;
+  *top = NULL;
+  return element;
+}
+
+/**
+ * @brief Removes the top element and copies it into a caller buffer.
+ *
+ * Copies one slot: the element bytes for inline stacks, the element pointer for
+ * pointer stacks.
+ *
+ * @param stack Pointer to the Stack.
+ * @param out Destination buffer for the removed element.
+ *
+ * @return true if an element was removed, false if the stack is empty.
+ */
+bool pop_into(Stack *stack, void *out) {
+  if (!stack || !out) {
+    return false;
+  }
+  if (stack->size == 0) {
+    return false;
+  }
+  index_remove(stack, --stack->size);
+  changed_from(stack, stack->size);
+  stat_pop(stack, 1);
+  memcpy(out, slot(stack, stack->size), stack->stride);
+  if (!stack->element_size) {
+    *pointer_slot(stack, stack->size) = NULL;
+  }
+  return true;
+}
+
+/**
+ * @brief Removes up to count elements from the top of the stack.
+ *
+ * The removed slots are copied into out with a single memcpy (two when they
+ * wrap around the ring of a drop_oldest stack), keeping their stack order:
+ * the former top element is written last, so push_n() on the same buffer
+ * restores the stack.
+ *
+ * @param stack Pointer to the Stack.
+ * @param out Destination buffer with room for count slots.
+ * @param count Maximum number of elements to remove.
+ *
+ * @return Number of elements removed.
+ */
+size_t pop_n(Stack *stack, void *out, size_t count) {
+  if (!stack || !out) {
+    return 0;
+  }
+  if (count > stack->size) {
+    count = stack->size;
+  }
+  if (count == 0) {
+    return 0;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    index_remove(stack, --stack->size);
+  }
+  changed_from(stack, stack->size);
+  stat_pop(stack, count);
+  copy_out(stack, stack->size, count, out);
+  return count;
+}
+
+/**
+ * @brief Returns the top element of the stack without removing it.
+ *
+ * @param stack Pointer to the Stack.
+ *
+ * @return Pointer to the top element (do not modify or free). Returns NULL if
+ * the stack is empty.
+ */
+void *peek(const Stack *stack) {
+  if (!stack) {
+    return NULL;
+  }
+  if (stack->size == 0) {
+    return NULL;
+  }
+  if (stack->element_size) {
+    return slot(stack, stack->size - 1);
+  }
+  return *pointer_slot(stack, stack->size - 1);
+}
+
+/**
+ * @brief Checks whether a stack stores integers of 8, 16 or 32 bits.
+ *
+ * @param stack Pointer to the Stack.
+ *
+ * @return true for inline stacks with 1, 2 or 4 byte elements.
+ */
+static inline bool is_int_stack(const Stack *stack) {
+  return stack->element_size == 1 || stack->element_size == 2 || stack->element_size == 4;
+}
+
+/**
+ * @brief Reads the integer stored in a slot of an integer stack.
+ *
+ * @param stack Pointer to an integer Stack.
+ * @param index Element index, 0 being the bottom.
+ *
+ * @return The value, zero-extended.
+ */
+static inline uint32_t int_at(const Stack *stack, size_t index) {
+  const void *element = slot(stack, index);
+  switch (stack->element_size) {
+  case 1:
+    return *(const uint8_t *)element;
+  case 2: {
+    uint16_t value;
+    memcpy(&value, element, sizeof(value));
+    return value;
+  }
+  default: {
+    uint32_t value;
+    memcpy(&value, element, sizeof(value));
+    return value;
+  }
+  }
+}
+
+/**
+ * @brief Pushes an integer onto an integer stack.
+ *
+ * The value is stored in element_size bytes, without any allocation unless
+ * the buffer must grow.
+ *
+ * @param stack Pointer to the Stack.
+ * @param value Value to push (must fit in the stack's width).
+ *
+ * @return true if the value was pushed, false if the stack is not an integer
+ * stack, the value does not fit or on allocation failure.
+ */
+bool push_int(Stack *stack, uint32_t value) {
+  if (!stack || !is_int_stack(stack)) {
+    return false;
+  }
+  if (stack->element_size == 1) {
+    uint8_t narrow = (uint8_t)value;
+    return narrow == value && try_push(stack, &narrow) == STACK_OK;
+  }
+  if (stack->element_size == 2) {
+    uint16_t narrow = (uint16_t)value;
+    return narrow == value && try_push(stack, &narrow) == STACK_OK;
+  }
+  return try_push(stack, &value) == STACK_OK;
+}
+
+/**
+ * @brief Removes the top integer of an integer stack.
+ *
+ * @param stack Pointer to the Stack.
+ * @param out Receives the value (may be NULL).
+ *
+ * @return true if a value was popped, false if the stack is empty or not an
+ * integer stack.
+ */
+bool pop_int(Stack *stack, uint32_t *out) {
+  if (!stack || !is_int_stack(stack) || stack->size == 0) {
+    return false;
+  }
+  if (out) {
+    *out = int_at(stack, stack->size - 1);
+  }
+  index_remove(stack, stack->size - 1);
+  --stack->size;
+  changed_from(stack, stack->size);
+  stat_pop(stack, 1);
+  return true;
+}
+
+/**
+ * @brief Reads the top integer of an integer stack without removing it.
+ *
+ * @param stack Pointer to the Stack.
+ * @param out Receives the value.
+ *
+ * @return true if the stack holds a value, false if it is empty or not an
+ * integer stack.
+ */
+bool peek_int(const Stack *stack, uint32_t *out) {
+  if (!stack || !out || !is_int_stack(stack) || stack->size == 0) {
+    return false;
+  }
+  *out = int_at(stack, stack->size - 1);
+  return true;
+}
+
+/**
+ * @brief Clears all elements from the stack.
+ *
+ * Hands all elements to batch_free_func in a single call, or calls the
+ * user-supplied free_func for each element. Inline stacks and stacks without
+ * a free function own no element memory and are simply emptied. Arena stacks
+ * release all element copies at once by resetting their arena.
+ *
+ * @param stack Pointer to the Stack.
+ */
+void clear(Stack *stack) {
+  if (!stack) {
+    return;
+  }
+  if (stack->arena_copy) {
+    arena_reset(&stack->arena, true);
+  } else {
+    free_range(stack, 0, stack->size);
+  }
+  stack->size = 0;
+  close_marks(stack);
+  index_rebuild(stack);
+  stack->head = 0;
+}
+
+/**
+ * @brief Checks that a mark is the innermost open mark of the stack.
+ *
+ * @param stack Pointer to the Stack.
+ * @param mark Mark returned by mark().
+ *
+ * @return true if the mark can be rolled back or committed.
+ */
+static bool is_open_mark(const Stack *stack, StackMark mark) {
+  return stack && mark.serial && mark.serial == stack->open_mark && mark.depth <= stack->size;
+}
+
+/**
+ * @brief Records a checkpoint of the current depth.
+ *
+ * The mark becomes the innermost open mark and remembers the enclosing one,
+ * so that resolving it reopens the enclosing mark. Arena stacks also record
+ * the arena position, so that rollback() can release the element copies made
+ * after the mark.
+ *
+ * @param stack Pointer to the Stack.
+ *
+ * @return The mark, with serial 0 for NULL and drop_oldest stacks.
+ */
+StackMark mark(Stack *stack) {
+  StackMark mark = {0, 0, 0, 0, NULL, 0};
+  if (!stack || stack->drop_oldest) {
+    return mark;
+  }
+  mark.depth = stack->size;
+  mark.serial = ++stack->mark_count;
+  mark.outer = stack->open_mark;
+  mark.outer_depth = stack->mark_floor;
+  if (stack->arena_copy && stack->arena.head) {
+    mark.chunk = stack->arena.head;
+    mark.used = stack->arena.head->used;
+  }
+  stack->open_mark = mark.serial;
+  stack->mark_floor = mark.depth;
+  return mark;
+}
+
+/**
+ * @brief Discards every element pushed since a mark.
+ *
+ * Frees the elements above the mark with a single free_range() pass. For
+ * arena stacks the chunks allocated after the mark are released and the
+ * chunk in use at the mark is rewound. Removing or moving an element below
+ * the innermost open mark closes all marks, so no live element can reference
+ * the arena memory released here.
+ *
+ * @param stack Pointer to the Stack.
+ * @param mark Mark returned by mark().
+ *
+ * @return true on success, false if the mark is not the innermost open mark.
+ */
+bool rollback(Stack *stack, StackMark mark) {
+  if (!is_open_mark(stack, mark)) {
+    return false;
+  }
+  truncate_to(stack, mark.depth);
+  stack->open_mark = mark.outer;
+  stack->mark_floor = mark.outer_depth;
+  if (stack->arena_copy) {
+    arena_rewind(&stack->arena, mark.chunk, mark.used);
+  }
+  return true;
+}
+
+/**
+ * @brief Keeps the elements pushed since a mark.
+ *
+ * Nothing is freed or copied; the enclosing mark becomes the innermost open
+ * mark again.
+ *
+ * @param stack Pointer to the Stack.
+ * @param mark Mark returned by mark().
+ *
+ * @return true on success, false if the mark is not the innermost open mark.
+ */
+bool commit(Stack *stack, StackMark mark) {
+  if (!is_open_mark(stack, mark)) {
+    return false;
+  }
+  stack->open_mark = mark.outer;
+  stack->mark_floor = mark.outer_depth;
+  return true;
+}
+
+/**
+ * @brief Checks if the stack has no elements.
+ *
+ * @param stack Pointer to the Stack.
+ *
+ * @return true if empty, false otherwise.
+ */
+bool is_empty(const Stack *stack) {
+  if (!stack) {
+    return true;
+  }
+  return stack->size == 0;
+}
+
+/**
+ * @brief Returns the number of elements in the stack.
+ *
+ * @param stack Pointer to the Stack.
+ *
+ * @return Number of elements.
+ */
+size_t size(const Stack *stack) {
+  if (!stack) {
+    return 0;
+  }
+  return stack->size;
+}
+
+/**
+ * @brief Returns the allocated capacity of the stack.
+ *
+ * @param stack Pointer to the Stack.
+ *
+ * @return Current allocated capacity.
+ */
+size_t capacity(const Stack *stack) {
+  if (!stack) {
+    return 0;
+  }
+  return stack->capacity;
+}
+
+/**
+ * @brief Allocates element memory from an arena.
+ *
+ * Allocations are bump-allocated from chunks of STACK_ARENA_CHUNK_SIZE bytes
+ * (larger requests get a chunk of their own) and aligned for any type.
+ *
+ * @param arena Pointer to the StackArena.
+ * @param size Number of bytes to allocate.
+ *
+ * @return Pointer to the memory, or NULL on allocation failure.
+ */
+void *arena_alloc(StackArena *arena, size_t size) {
+  if (!arena) {
+    return NULL;
+  }
+  size_t align = _Alignof(max_align_t);
+  if (size > SIZE_MAX - sizeof(ArenaChunk) - align) {
+    return NULL;
+  }
+  size = size ? (size + align - 1) / align * align : align;
+  ArenaChunk *chunk = arena->head;
+  if (!chunk || chunk->capacity - chunk->used < size) {
+    size_t chunk_capacity = size > STACK_ARENA_CHUNK_SIZE ? size : STACK_ARENA_CHUNK_SIZE;
+    chunk = arena->allocator->alloc_func(arena->allocator->ctx,
+                                         sizeof(ArenaChunk) + chunk_capacity);
+    if (!chunk) {
+      return NULL;
+    }
+    chunk->capacity = chunk_capacity;
+    chunk->used = 0;
+    chunk->next = arena->head;
+    arena->head = chunk;
+  }
+  void *memory = (unsigned char *)chunk->data + chunk->used;
+  chunk->used += size;
+  return memory;
+}
+
+/**
+ * @brief Returns the element arena of an arena stack.
+ *
+ * @param stack Pointer to the Stack.
+ *
+ * @return Pointer to the arena, or NULL if the stack has no arena_copy_func.
+ */
+StackArena *get_arena(Stack *stack) {
+  if (!stack || !stack->arena_copy) {
+    return NULL;
+  }
+  return &stack->arena;
+}
+
+/**
+ * @brief Returns the size of the elements stored by an inline stack.
+ *
+ * @param stack Pointer to the Stack.
+ *
+ * @return Element size in bytes, or 0 for pointer stacks.
+ */
+size_t element_size(const Stack *stack) {
+  if (!stack) {
+    return 0;
+  }
+  return stack->element_size;
+}
+
+/**
+ * @brief Ensures the stack can hold at least n elements without growing.
+ *
+ * Reallocates the buffer to exactly n slots when it is smaller.
+ *
+ * @param stack Pointer to the Stack.
+ * @param n Required capacity.
+ *
+ * @return true on success, false if n exceeds the maximum capacity.
+ */
+bool reserve(Stack *stack, size_t n) {
+  return try_reserve(stack, n) == STACK_OK;
+}
+
+/**
+ * @brief Ensures the stack can hold at least n elements and reports why it
+ * failed.
+ *
+ * @param stack Pointer to the Stack.
+ * @param n Required capacity.
+ *
+ * @return STACK_OK on success, or the reason the buffer could not be grown.
+ */
+StackStatus try_reserve(Stack *stack, size_t n) {
+  if (!stack) {
+    return STACK_ERROR_NULL;
+  }
+  if (stack->growth.max_capacity && n > stack->growth.max_capacity) {
+    return STACK_ERROR_FULL;
+  }
+  if (n <= stack->capacity) {
+    return STACK_OK;
+  }
+  return resize(stack, n);
+}
+
+/**
+ * @brief Shrinks the buffer so that the capacity equals the size.
+ *
+ * Elements that fit in the small buffer are moved back into it and the heap
+ * buffer is released. If the reallocation fails the larger buffer is kept.
+ * Bounded stacks keep their preallocated buffer.
+ *
+ * @param stack Pointer to the Stack.
+ */
+void shrink_to_fit(Stack *stack) {
+  if (!stack || stack->bound || stack->size == stack->capacity) {
+    return;
+  }
+  resize(stack, stack->size);
+}
+
+/**
+ * @brief Writes a file-backed stack to its file.
+ *
+ * Records the current size in the file header and flushes the mapping with
+ * msync().
+ *
+ * @param stack Pointer to the Stack.
+ *
+ * @return true on success, false if the stack is not file-backed or the flush
+ * fails.
+ */
+bool sync_stack(Stack *stack) {
+  if (!stack || stack->fd < 0) {
+    return false;
+  }
+  file_header(stack)->size = stack->size;
+  return msync(file_header(stack), file_length(stack, stack->capacity), MS_SYNC) == 0;
+}
+
+/**
+ * @brief Replaces the growth policy of the stack.
+ *
+ * max_capacity limits the number of elements, not just growth: pushes fail
+ * once the stack holds that many, even if the buffer has room left.
+ *
+ * @param stack Pointer to the Stack.
+ * @param policy New policy, or NULL to restore the default doubling policy.
+ *
+ * @return true on success, false if the policy is invalid or the stack is
+ * bounded.
+ */
+bool set_growth_policy(Stack *stack, const StackGrowthPolicy *policy) {
+  if (!stack || stack->bound) {
+    return false;
+  }
+  if (!policy) {
+    stack->growth = (StackGrowthPolicy){STACK_DEFAULT_GROWTH_FACTOR, 0, 0};
+    return true;
+  }
+  if (!policy->chunk && !(policy->factor > 1.0)) {
+    return false;
+  }
+  if (policy->max_capacity && policy->max_capacity < stack->size) {
+    return false;
+  }
+  stack->growth = *policy;
+  return true;
+}
+
+/**
+ * @brief Copies the instrumentation counters of the stack.
+ *
+ * @param stack Pointer to the Stack.
+ * @param out Receives the counters.
+ *
+ * @return true on success, false without STACK_STATS.
+ */
+bool get_stack_stats(const Stack *stack, StackStats *out) {
+#ifdef STACK_STATS
+  if (!stack || !out) {
+    return false;
+  }
+  *out = stack->stats;
+  return true;
+#else
+  (void)stack;
+  (void)out;
+  return false;
+#endif
+}
+
+/**
+ * @brief Resets the instrumentation counters of the stack.
+ *
+ * @param stack Pointer to the Stack.
+ */
+void reset_stack_stats(Stack *stack) {
+#ifdef STACK_STATS
+  if (!stack) {
+    return;
+  }
+  stack->stats = (StackStats){0};
+  stack->stats.high_water = stack->size;
+#else
+  (void)stack;
+#endif
+}
+
+/**
+ * @brief Installs a callback fired each time the stack buffer grows.
+ *
+ * @param stack Pointer to the Stack.
+ * @param hook Callback, or NULL to remove it.
+ * @param ctx User context passed to hook.
+ *
+ * @return true on success, false without STACK_STATS.
+ */
+bool set_growth_hook(Stack *stack, StackGrowthHook hook, void *ctx) {
+#ifdef STACK_STATS
+  if (!stack) {
+    return false;
+  }
+  stack->growth_hook = hook;
+  stack->growth_hook_ctx = ctx;
+  return true;
+#else
+  (void)stack;
+  (void)hook;
+  (void)ctx;
+  return false;
+#endif
+}
+
+/**
+ * @brief Scans packed elements from the top down for an exact byte match.
+ *
+ * @param data Packed elements.
+ * @param count Number of elements.
+ * @param width Element size in bytes.
+ * @param key Element to search for.
+ *
+ * @return Position of the topmost match, or INDEX_NONE.
+ */
+static size_t find_scalar(const unsigned char *data, size_t count, size_t width,
+                          const void *key) {
+  for (size_t i = count; i > 0; --i) {
+    if (memcmp(data + (i - 1) * width, key, width) == 0) {
+      return i - 1;
+    }
+  }
+  return INDEX_NONE;
+}
+
+/**
+ * @brief Reduces a byte-equality mask to the lanes whose bytes all matched.
+ *
+ * Bit j of mask tells whether byte j matched. Lanes are width bytes wide, with
+ * width a power of two.
+ *
+ * @param mask Byte-equality mask.
+ * @param width Lane width in bytes.
+ * @param starts Mask with the first bit of every lane set.
+ *
+ * @return Mask with the first bit of every fully matching lane set.
+ */
+static inline uint64_t full_lanes(uint64_t mask, size_t width, uint64_t starts) {
+  for (size_t shift = 1; shift < width; shift <<= 1) {
+    mask &= mask >> shift;
+  }
+  return mask & starts;
+}
+
+/**
+ * @brief Fills a vector-sized buffer with repeated copies of key.
+ *
+ * @param pattern Destination of vector_size bytes.
+ * @param vector_size Size of the vector in bytes.
+ * @param width Element size in bytes (a power of two up to vector_size).
+ * @param key Element to repeat.
+ *
+ * @return Mask with the first bit of every lane set.
+ */
+static uint64_t fill_pattern(unsigned char *pattern, size_t vector_size, size_t width,
+                             const void *key) {
+  uint64_t starts = 0;
+  for (size_t j = 0; j < vector_size; j += width) {
+    memcpy(pattern + j, key, width);
+    starts |= UINT64_C(1) << j;
+  }
+  return starts;
+}
+
+#if defined(__SSE2__)
+/**
+ * @brief SSE2 version of find_scalar() for power-of-two widths up to 16.
+ */
+static size_t find_sse2(const unsigned char *data, size_t count, size_t width, const void *key) {
+  unsigned char pattern[16];
+  uint64_t starts = fill_pattern(pattern, sizeof(pattern), width, key);
+  __m128i needle = _mm_loadu_si128((const __m128i *)pattern);
+  size_t lanes = sizeof(pattern) / width;
+  size_t i = count;
+  while (i >= lanes) {
+    i -= lanes;
+    __m128i block = _mm_loadu_si128((const __m128i *)(data + i * width));
+    uint64_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+    if (mask && (mask = full_lanes(mask, width, starts))) {
+      return i + (size_t)(63 - __builtin_clzll(mask)) / width;
+    }
+  }
+  return find_scalar(data, i, width, key);
+}
+#endif
+
+#if defined(STACK_HAVE_AVX2)
+/**
+ * @brief AVX2 version of find_scalar() for power-of-two widths up to 32.
+ *
+ * Only called after checking that the CPU supports AVX2.
+ */
+__attribute__((target("avx2"))) static size_t find_avx2(const unsigned char *data, size_t count,
+                                                        size_t width, const void *key) {
+  unsigned char pattern[32];
+  uint64_t starts = fill_pattern(pattern, sizeof(pattern), width, key);
+  __m256i needle = _mm256_loadu_si256((const __m256i *)pattern);
+  size_t lanes = sizeof(pattern) / width;
+  size_t i = count;
+  while (i >= lanes) {
+    i -= lanes;
+    __m256i block = _mm256_loadu_si256((const __m256i *)(data + i * width));
+    uint64_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle));
+    if (mask && (mask = full_lanes(mask, width, starts))) {
+      return i + (size_t)(63 - __builtin_clzll(mask)) / width;
+    }
+  }
+  return find_scalar(data, i, width, key);
+}
+#endif
+
+#if defined(__ARM_NEON)
+/**
+ * @brief NEON version of find_scalar() for power-of-two widths up to 16.
+ *
+ * NEON has no byte movemask, so the comparison result is narrowed to a 64-bit
+ * mask holding four bits per byte.
+ */
+static size_t find_neon(const unsigned char *data, size_t count, size_t width, const void *key) {
+  unsigned char pattern[16];
+  fill_pattern(pattern, sizeof(pattern), width, key);
+  uint64_t starts = 0;
+  for (size_t j = 0; j < sizeof(pattern); j += width) {
+    starts |= UINT64_C(1) << (4 * j);
+  }
+  uint8x16_t needle = vld1q_u8(pattern);
+  size_t lanes = sizeof(pattern) / width;
+  size_t i = count;
+  while (i >= lanes) {
+    i -= lanes;
+    uint8x16_t equal = vceqq_u8(vld1q_u8(data + i * width), needle);
+    uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(equal), 4);
+    uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+    if (mask && (mask = full_lanes(mask, 4 * width, starts))) {
+      return i + (size_t)(63 - __builtin_clzll(mask)) / (4 * width);
+    }
+  }
+  return find_scalar(data, i, width, key);
+}
+#endif
+
+/**
+ * @brief Finds the topmost of count packed elements whose bytes equal key.
+ *
+ * Dispatches to the widest vector search the build and, for AVX2, the running
+ * CPU support when the element size is a power of two that fits a vector.
+ *
+ * @param data Packed elements.
+ * @param count Number of elements.
+ * @param width Element size in bytes.
+ * @param key Element to search for.
+ *
+ * @return Position of the topmost match, or INDEX_NONE.
+ */
+static size_t find_run(const unsigned char *data, size_t count, size_t width, const void *key) {
+  bool power_of_two = (width & (width - 1)) == 0;
+#if defined(STACK_HAVE_AVX2)
+  if (power_of_two && width <= 32 && __builtin_cpu_supports("avx2")) {
+    return find_avx2(data, count, width, key);
+  }
+#endif
+#if defined(__SSE2__)
+  if (power_of_two && width <= 16) {
+    return find_sse2(data, count, width, key);
+  }
+#endif
+#if defined(__ARM_NEON)
+  if (power_of_two && width <= 16) {
+    return find_neon(data, count, width, key);
+  }
+#endif
+  (void)power_of_two;
+  return find_scalar(data, count, width, key);
+}
+
+/**
+ * @brief Finds the topmost element of an inline stack whose bytes equal key.
+ *
+ * A drop_oldest ring that wraps is searched as two runs, the upper one first.
+ *
+ * @param stack Pointer to an inline Stack.
+ * @param key Element to search for.
+ *
+ * @return Position of the topmost match, or INDEX_NONE.
+ */
+static size_t find_bytes(const Stack *stack, const void *key) {
+  size_t width = stack->element_size;
+  size_t lower = run_length(stack, 0, stack->size);
+  if (lower < stack->size) {
+    size_t i = find_run(slot(stack, lower), stack->size - lower, width, key);
+    if (i != INDEX_NONE) {
+      return lower + i;
+    }
+  }
+  return find_run(slot(stack, 0), lower, width, key);
+}
+
+/**
+ * @brief Checks if the stack contains a given element.
+ *
+ * Requires cmp_func to be non-NULL, except on inline stacks where a NULL
+ * cmp_func means bytewise equality.
+ *
+ * @param stack Pointer to the Stack.
+ * @param element Pointer to the element to search for.
+ *
+ * @return true if found, false otherwise.
+ */
+bool contains(const Stack *stack, const void *element) {
+  if (!stack) {
+    return false;
+  }
+  if (stack->hash) {
+    return index_find(stack, element) != INDEX_NONE;
+  }
+  return index_of(stack, element) != SIZE_MAX;
+}
+
+/**
+ * @brief Finds the topmost element equal to a given element.
+ *
+ * Uses the hash index when the stack has one, a vectorized byte search for
+ * inline stacks without cmp_func, and otherwise compares elements from the
+ * top down.
+ *
+ * @param stack Pointer to the Stack.
+ * @param element Pointer to the element to search for.
+ *
+ * @return Depth of the match, or SIZE_MAX if not found.
+ */
+size_t index_of(const Stack *stack, const void *element) {
+  if (!stack || !element) {
+    return SIZE_MAX;
+  }
+  if (stack->hash || (stack->element_size && !stack->cmp)) {
+    size_t i = stack->hash ? index_find(stack, element) : find_bytes(stack, element);
+    return i == INDEX_NONE ? SIZE_MAX : stack->size - 1 - i;
+  }
+  if (!stack->cmp) {
+    return SIZE_MAX;
+  }
+  for (size_t i = stack->size; i > 0; --i) {
+    if (stack->cmp(element_at(stack, i - 1), element) == 0) {
+      return stack->size - i;
+    }
+  }
+  return SIZE_MAX;
+}
+
+/**
+ * @brief Creates a deep copy of the stack.
+ * 
+ * Elements are copied using the user-supplied copy function. Inline stacks
+ * copy their whole buffer at once.
+ *
+ * @param stack Pointer to the Stack.
+ *
+ * @return Pointer to a new Stack with copied elements, or NULL on allocation
+ * failure or for move-only stacks.
+ */
+Stack *clone(const Stack *stack) {
+  if (!stack || !can_copy(stack)) {
+    return NULL;
+  }
+  StackOptions options = options_of(stack);
+  Stack *clone = create(&options);
+  if (!clone) {
+    return NULL;
+  }
+  if (try_reserve(clone, stack->size) != STACK_OK) {
+    free_stack(clone);
+    return NULL;
+  }
+  if (stack->element_size) {
+    if (index_reserve(clone, stack->size) != STACK_OK) {
+      free_stack(clone);
+      return NULL;
+    }
+    copy_out(stack, 0, stack->size, clone->data);
+    clone->size = stack->size;
+    index_rebuild(clone);
+    return clone;
+  }
+  for (size_t i = 0; i < stack->size; ++i) {
+    if (try_push(clone, *pointer_slot(stack, i)) != STACK_OK) {
+      free_stack(clone);
+      return NULL;
+    }
+  }
+  return clone;
+}
+
+/**
+ * @brief Reverses the stack in-place by swapping elements.
+ *
+ * @param stack Pointer to the Stack.
+ */
+void reverse(Stack *stack) {
+  if (stack->size == 0) {
+    return;
+  }
+  changed_from(stack, 0);
+  size_t left = 0;
+  size_t right = stack->size - 1;
+  if (stack->element_size) {
+    while (left < right) {
+      swap_bytes(slot(stack, left), slot(stack, right), stack->stride);
+      ++left;
+      --right;
+    }
+    index_rebuild(stack);
+    return;
+  }
+  while (left < right) {
+    void **bottom = pointer_slot(stack, left);
+    void **top = pointer_slot(stack, right);
+    void *tmp = *bottom;
+    *bottom = *top;
+    *top = tmp;
+    ++left;
+    --right;
+  }
+  index_rebuild(stack);
+}
+
+/**
+ * @brief Converts the stack to a newly heap-allocated array.
+ * 
+ * Caller must free both the array and its elements.
+ *
+ * Inline stacks return one packed copy of their buffer; only the array itself
+ * must be freed.
+ *
+ * @param stack Pointer to the Stack.
+ * @param out_size Optional pointer to receive the array size.
+ *
+ * @return Pointer to a new array containing all stack elements, or NULL if the
+ * stack is empty, move-only, or on allocation failure (out_size is then set
+ * to 0).
+ */
+void **to_array(const Stack *stack, size_t *out_size) {
+  if (out_size) {
+    *out_size = 0;
+  }
+  if (stack->size == 0 || (!stack->element_size && !stack->copy)) {
+    return NULL;
+  }
+  void **array = malloc(stack->size * stack->stride);
+  if (!array) {
+    return NULL;
+  }
+  if (stack->element_size) {
+    copy_out(stack, 0, stack->size, array);
+    if (out_size) {
+      *out_size = stack->size;
+    }
+    return array;
+  }
+  for (size_t i = 0; i < stack->size; ++i) {
+    array[i] = stack->copy(*pointer_slot(stack, i));
+    if (!array[i]) {
+      if (stack->batch_free) {
+        stack->batch_free(array, i);
+      }
+      while (!stack->batch_free && stack->free_func && i > 0) {
+        stack->free_func(array[--i]);
+      }
+      free(array);
+      return NULL;
+    }
+  }
+  if (out_size) {
+    *out_size = stack->size;
+  }
+  return array;
+}
+
+/**
+ * @brief Returns the number of threads a parallel operation will use.
+ *
+ * @param stack Pointer to the Stack.
+ * @param threads Requested number of threads, or 0 for one per online CPU.
+ *
+ * @return Number of threads, at least 1, at most STACK_PARALLEL_MAX_THREADS
+ * and at most one per STACK_PARALLEL_MIN_RUN elements.
+ */
+static size_t thread_count(const Stack *stack, size_t threads) {
+  if (threads == 0) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = cpus > 0 ? (size_t)cpus : 1;
+  }
+  size_t max_threads = stack->size / STACK_PARALLEL_MIN_RUN;
+  if (threads > max_threads) {
+    threads = max_threads ? max_threads : 1;
+  }
+  return threads < STACK_PARALLEL_MAX_THREADS ? threads : STACK_PARALLEL_MAX_THREADS;
+}
+
+/**
+ * @brief Runs work over the elements of a stack split into contiguous runs.
+ *
+ * Each range is a copy of proto restricted to one run. The calling thread
+ * processes the last run itself, and any run whose thread cannot be started.
+ *
+ * @param proto Range holding the stack and parameters shared by all runs.
+ * @param threads Number of runs, as returned by thread_count().
+ * @param work Function processing one WorkRange.
+ * @param ranges Receives the processed ranges (threads entries).
+ */
+static void run_ranges(const WorkRange *proto, size_t threads, void *(*work)(void *),
+                       WorkRange *ranges) {
+  size_t count = proto->stack->size;
+  pthread_t workers[STACK_PARALLEL_MAX_THREADS];
+  bool started[STACK_PARALLEL_MAX_THREADS];
+  for (size_t t = 0; t < threads; ++t) {
+    ranges[t] = *proto;
+    ranges[t].begin = count * t / threads;
+    ranges[t].end = count * (t + 1) / threads;
+    ranges[t].done = 0;
+    started[t] = t + 1 < threads && pthread_create(&workers[t], NULL, work, &ranges[t]) == 0;
+  }
+  for (size_t t = 0; t < threads; ++t) {
+    if (started[t]) {
+      pthread_join(workers[t], NULL);
+    } else {
+      work(&ranges[t]);
+    }
+  }
+}
+
+/**
+ * @brief Copies the elements of one WorkRange with copy_func.
+ *
+ * Stops at the first failed copy, leaving done short of the range length.
+ *
+ * @param arg Pointer to the WorkRange.
+ *
+ * @return NULL.
+ */
+static void *copy_range(void *arg) {
+  WorkRange *range = arg;
+  const Stack *stack = range->stack;
+  for (size_t i = range->begin; i < range->end; ++i) {
+    void *copy = stack->copy(*pointer_slot(stack, i));
+    if (!copy) {
+      break;
+    }
+    range->dst[i] = copy;
+    ++range->done;
+  }
+  return NULL;
+}
+
+/**
+ * @brief Evaluates pred over one WorkRange, counting the matches and storing
+ * the results in marks when set.
+ *
+ * @param arg Pointer to the WorkRange.
+ *
+ * @return NULL.
+ */
+static void *match_range(void *arg) {
+  WorkRange *range = arg;
+  for (size_t i = range->begin; i < range->end; ++i) {
+    bool match = range->pred(element_at(range->stack, i), range->ctx);
+    if (range->marks) {
+      range->marks[i] = match;
+    }
+    range->done += match;
+  }
+  return NULL;
+}
+
+/**
+ * @brief Applies map_fn to every element of one WorkRange.
+ *
+ * @param arg Pointer to the WorkRange.
+ *
+ * @return NULL.
+ */
+static void *map_range(void *arg) {
+  WorkRange *range = arg;
+  for (size_t i = range->begin; i < range->end; ++i) {
+    range->map_fn(element_at(range->stack, i), range->ctx);
+  }
+  return NULL;
+}
+
+/**
+ * @brief Copies every element of a pointer stack into dst using several
+ * threads.
+ *
+ * On failure every copy that was made is freed again.
+ *
+ * @param stack Pointer to a pointer Stack with a copy function.
+ * @param dst Destination array of at least stack->size pointers.
+ * @param threads Number of threads, or 0 for one per online CPU.
+ *
+ * @return true if every element was copied.
+ */
+static bool copy_parallel(const Stack *stack, void **dst, size_t threads) {
+  threads = thread_count(stack, threads);
+  WorkRange ranges[STACK_PARALLEL_MAX_THREADS];
+  WorkRange proto = {0};
+  proto.stack = stack;
+  proto.dst = dst;
+  run_ranges(&proto, threads, copy_range, ranges);
+  bool ok = true;
+  for (size_t t = 0; t < threads; ++t) {
+    ok = ok && ranges[t].done == ranges[t].end - ranges[t].begin;
+  }
+  for (size_t t = 0; !ok && t < threads; ++t) {
+    void **copies = dst + ranges[t].begin;
+    if (stack->batch_free && ranges[t].done) {
+      stack->batch_free(copies, ranges[t].done);
+    }
+    for (size_t i = 0; !stack->batch_free && stack->free_func && i < ranges[t].done; ++i) {
+      stack->free_func(copies[i]);
+    }
+  }
+  return ok;
+}
+
+/**
+ * @brief Creates a deep copy of the stack, running copy_func on several
+ * threads.
+ *
+ * The destination buffer is reserved once and each thread copies a
+ * contiguous run of indices, so the result equals that of clone(). copy_func
+ * must be safe to call concurrently. Inline and arena stacks, and stacks too
+ * small to be worth splitting, are copied by clone().
+ *
+ * @param stack Pointer to the Stack.
+ * @param threads Number of threads, or 0 for one per online CPU.
+ *
+ * @return Pointer to a new Stack with copied elements, or NULL on allocation
+ * failure or for move-only stacks.
+ */
+Stack *parallel_clone(const Stack *stack, size_t threads) {
+  if (!stack || stack->element_size || stack->arena_copy || !stack->copy ||
+      stack->size < 2 * STACK_PARALLEL_MIN_RUN || threads == 1) {
+    return clone(stack);
+  }
+  StackOptions options = options_of(stack);
+  Stack *clone = create(&options);
+  if (!clone) {
+    return NULL;
+  }
+  if (try_reserve(clone, stack->size) != STACK_OK ||
+      index_reserve(clone, stack->size) != STACK_OK ||
+      !copy_parallel(stack, clone->data, threads)) {
+    free_stack(clone);
+    return NULL;
+  }
+  clone->size = stack->size;
+  index_rebuild(clone);
+  stat_callbacks(clone, stack->size, 0);
+  stat_push(clone, stack->size);
+  return clone;
+}
+
+/**
+ * @brief Converts the stack to a newly heap-allocated array, running
+ * copy_func on several threads.
+ *
+ * Same result as to_array(), with the array allocated once and filled by
+ * contiguous runs. copy_func must be safe to call concurrently. Inline stacks
+ * and stacks too small to be worth splitting are handled by to_array().
+ *
+ * @param stack Pointer to the Stack.
+ * @param out_size Optional pointer to receive the array size.
+ * @param threads Number of threads, or 0 for one per online CPU.
+ *
+ * @return Pointer to a new array containing all stack elements, or NULL if the
+ * stack is empty, move-only, or on allocation failure (out_size is then set
+ * to 0).
+ */
+void **parallel_to_array(const Stack *stack, size_t *out_size, size_t threads) {
+  if (out_size) {
+    *out_size = 0;
+  }
+  if (!stack) {
+    return NULL;
+  }
+  if (stack->element_size || !stack->copy || stack->size < 2 * STACK_PARALLEL_MIN_RUN ||
+      threads == 1) {
+    return to_array(stack, out_size);
+  }
+  void **array = malloc(stack->size * stack->stride);
+  if (!array) {
+    return NULL;
+  }
+  if (!copy_parallel(stack, array, threads)) {
+    free(array);
+    return NULL;
+  }
+  if (out_size) {
+    *out_size = stack->size;
+  }
+  return array;
+}
+
+/**
+ * @brief Moves the elements to keep to the front of the buffer, preserving
+ * their order, and frees the others.
+ *
+ * Pointer stacks swap each kept element with the first free slot, so the
+ * removed elements gather above the kept ones and are freed as one range.
+ *
+ * @param stack Pointer to the Stack.
+ * @param pred Predicate deciding which elements match, used when marks is
+ * NULL.
+ * @param ctx User context passed to pred.
+ * @param keep Whether matching elements are kept (true) or removed (false).
+ * @param marks Precomputed predicate results, or NULL.
+ *
+ * @return Number of elements removed.
+ */
+static size_t compact(Stack *stack, StackPredicate pred, void *ctx, bool keep,
+                      const unsigned char *marks) {
+  size_t kept = 0;
+  size_t first = stack->size;
+  for (size_t i = 0; i < stack->size; ++i) {
+    bool match = marks ? marks[i] : pred(element_at(stack, i), ctx);
+    if (match != keep) {
+      if (first == stack->size) {
+        first = i;
+      }
+      continue;
+    }
+    if (kept != i && stack->element_size) {
+      memcpy(slot(stack, kept), slot(stack, i), stack->element_size);
+    } else if (kept != i) {
+      void **from = pointer_slot(stack, i);
+      void **to = pointer_slot(stack, kept);
+      void *element = *from;
+      *from = *to;
+      *to = element;
+    }
+    ++kept;
+  }
+  size_t removed = stack->size - kept;
+  changed_from(stack, first);
+  free_range(stack, kept, stack->size);
+  stack->size = kept;
+  if (removed) {
+    index_rebuild(stack);
+  }
+  return removed;
+}
 
 /**
- * Initial capacity for the stack.
+ * @brief Removes every element for which pred returns true.
+ *
+ * Compacts the buffer in a single pass, keeping the order of the remaining
+ * elements, and frees the removed ones like clear() would.
+ *
+ * @param stack Pointer to the Stack.
+ * @param pred Predicate selecting the elements to remove.
+ * @param ctx User context passed to pred.
+ *
+ * @return Number of elements removed.
  */
-#define STACK_INITIAL_CAPACITY 8
+size_t remove_if(Stack *stack, StackPredicate pred, void *ctx) {
+  if (!stack || !pred) {
+    return 0;
+  }
+  return compact(stack, pred, ctx, false, NULL);
+}
 
 /**
- * @struct Stack
+ * @brief Keeps only the elements for which pred returns true.
  *
- * @brief Internal representation of the stack.
+ * Same single pass as remove_if() with the predicate inverted.
  *
- * Contains a dynamically allocated array of void pointers, current size, and
- * capacity. Element management is delegated to user-provided functions.
+ * @param stack Pointer to the Stack.
+ * @param pred Predicate selecting the elements to keep.
+ * @param ctx User context passed to pred.
+ *
+ * @return Number of elements removed.
  */
-struct Stack {
-  void **data;             // Array of element pointers.
-  size_t size;             // Current number of elements.
-  size_t capacity;         // Allocated capacity.
-  StackCopyFunc copy;      // Function to copy elements.
-  StackFreeFunc free_func; // Function to free elements.
-  StackCompareFunc cmp;    // Function to compare elements (optional).
-};
+size_t retain(Stack *stack, StackPredicate pred, void *ctx) {
+  if (!stack || !pred) {
+    return 0;
+  }
+  return compact(stack, pred, ctx, true, NULL);
+}
 
 /**
- * @brief Doubles the capacity of the stack.
+ * @brief Counts the elements for which pred returns true.
  *
- * Called automatically when the stack runs out of space.
+ * @param stack Pointer to the Stack.
+ * @param pred Predicate to evaluate.
+ * @param ctx User context passed to pred.
+ *
+ * @return Number of matching elements.
+ */
+size_t count_if(const Stack *stack, StackPredicate pred, void *ctx) {
+  if (!stack || !pred) {
+    return 0;
+  }
+  size_t count = 0;
+  for (size_t i = 0; i < stack->size; ++i) {
+    count += pred(element_at(stack, i), ctx);
+  }
+  return count;
+}
+
+/**
+ * @brief Applies fn to every element in place, from the bottom up.
  *
- * Exits the program on allocation failure.
+ * Inline stacks pass a pointer to the slot, pointer stacks the element
+ * pointer. The hash index, if any, is rebuilt afterwards.
  *
  * @param stack Pointer to the Stack.
+ * @param fn Function updating one element.
+ * @param ctx User context passed to fn.
  */
-static void grow(Stack *stack) {
-  size_t new_capacity = stack->capacity ? stack->capacity * 2 : STACK_INITIAL_CAPACITY;
-  void **new_data = realloc(stack->data, new_capacity * sizeof(void *));
-  if (!new_data) {
-    exit(EXIT_FAILURE);
+void map(Stack *stack, StackMapFunc fn, void *ctx) {
+  if (!stack || !fn) {
+    return;
   }
-  stack->data = new_data;
-  stack->capacity = new_capacity;
+  for (size_t i = 0; i < stack->size; ++i) {
+    fn(element_at(stack, i), ctx);
+  }
+  index_rebuild(stack);
 }
 
 /**
- * @brief Initializes a new stack structure.
- * 
- * Allocates memory and sets initial values for fields.
- * 
- * No elements are present upon creation.
- * 
- * Exits the program on allocation failure.
- * 
- * @param copy_func Function to copy elements (must not be NULL).
- * @param free_func Function to free elements (must not be NULL).
- * @param cmp_func Function to compare elements (optional, may be NULL).
+ * @brief Removes every element for which pred returns true, evaluating pred
+ * on several threads.
  *
- * @return Pointer to the new Stack.
+ * The predicate results are collected into a mask in parallel, then the
+ * buffer is compacted in one serial pass, so the result equals that of
+ * remove_if(). pred must be safe to call concurrently. Small stacks, and any
+ * stack when the mask cannot be allocated, use remove_if().
+ *
+ * @param stack Pointer to the Stack.
+ * @param pred Predicate selecting the elements to remove.
+ * @param ctx User context passed to pred.
+ * @param threads Number of threads, or 0 for one per online CPU.
+ *
+ * @return Number of elements removed.
  */
-Stack *new_stack(StackCopyFunc copy_func, StackFreeFunc free_func, StackCompareFunc cmp_func) {
-  Stack *stack = malloc(sizeof(Stack));
-  if (!stack) {
-    exit(EXIT_FAILURE);
+size_t parallel_remove_if(Stack *stack, StackPredicate pred, void *ctx, size_t threads) {
+  if (!stack || !pred) {
+    return 0;
   }
-  stack->capacity = STACK_INITIAL_CAPACITY;
-  stack->data = malloc(stack->capacity * sizeof(void *));
-  if (!stack->data) {
-    free(stack);
-    exit(EXIT_FAILURE);
+  threads = thread_count(stack, threads);
+  unsigned char *marks = threads > 1 ? malloc(stack->size) : NULL;
+  if (!marks) {
+    return compact(stack, pred, ctx, false, NULL);
   }
-  stack->size = 0;
-  stack->copy = copy_func;
-  stack->free_func = free_func;
-  stack->cmp = cmp_func;
-  return stack;
+  WorkRange ranges[STACK_PARALLEL_MAX_THREADS];
+  WorkRange proto = {0};
+  proto.stack = stack;
+  proto.pred = pred;
+  proto.ctx = ctx;
+  proto.marks = marks;
+  run_ranges(&proto, threads, match_range, ranges);
+  size_t removed = compact(stack, NULL, NULL, false, marks);
+  free(marks);
+  return removed;
 }
 
 /**
- * @brief Frees all memory associated with the stack.
- * 
- * All the elements and the stack itself are free.
+ * @brief Counts the elements for which pred returns true, evaluating pred on
+ * several threads.
  *
- * Calls clear() to free each element and then releases internal memory.
+ * pred must be safe to call concurrently.
  *
  * @param stack Pointer to the Stack.
+ * @param pred Predicate to evaluate.
+ * @param ctx User context passed to pred.
+ * @param threads Number of threads, or 0 for one per online CPU.
+ *
+ * @return Number of matching elements.
  */
-void free_stack(Stack *stack) {
-  if (!stack) {
-    return;
+size_t parallel_count_if(const Stack *stack, StackPredicate pred, void *ctx, size_t threads) {
+  if (!stack || !pred) {
+    return 0;
   }
-  clear(stack);
-  free(stack->data);
-  free(stack);
+  threads = thread_count(stack, threads);
+  WorkRange ranges[STACK_PARALLEL_MAX_THREADS];
+  WorkRange proto = {0};
+  proto.stack = stack;
+  proto.pred = pred;
+  proto.ctx = ctx;
+  run_ranges(&proto, threads, match_range, ranges);
+  size_t count = 0;
+  for (size_t t = 0; t < threads; ++t) {
+    count += ranges[t].done;
+  }
+  return count;
 }
 
 /**
- * @brief Pushes a new element onto the stack.
- * 
- * Adds a new element to the stack, resizing if necessary.
- * 
- * The element is copied using the user-supplied copy function.
+ * @brief Applies fn to every element in place, on several threads.
+ *
+ * Each thread updates a contiguous run of elements. fn must be safe to call
+ * concurrently on different elements.
  *
  * @param stack Pointer to the Stack.
- * @param element Pointer to the element to push.
+ * @param fn Function updating one element.
+ * @param ctx User context passed to fn.
+ * @param threads Number of threads, or 0 for one per online CPU.
  */
-void push(Stack *stack, const void *element) {
-  if (!stack) {
+void parallel_map(Stack *stack, StackMapFunc fn, void *ctx, size_t threads) {
+  if (!stack || !fn) {
     return;
   }
-  if (stack->size == stack->capacity) {
-    grow(stack);
-  }
-  stack->data[stack->size++] = stack->copy(element);
+  threads = thread_count(stack, threads);
+  WorkRange ranges[STACK_PARALLEL_MAX_THREADS];
+  WorkRange proto = {0};
+  proto.stack = stack;
+  proto.map_fn = fn;
+  proto.ctx = ctx;
+  run_ranges(&proto, threads, map_range, ranges);
+  index_rebuild(stack);
 }
 
 /**
- * @brief Removes and returns the top element from the stack.
- * 
- * Caller must free the returned element using free_func().
+ * @brief Moves the top k elements of src onto dst.
  *
- * @param stack Pointer to the Stack.
+ * The elements keep their order and are moved with memcpy, in one call unless
+ * they wrap around the ring of a drop_oldest stack: no copy or free function
+ * is called and dst takes over ownership of pointer elements. Arena stacks
+ * are not supported, since their elements live in the source arena.
  *
- * @return Pointer to the removed element. Caller must be free it. Returns NULL
- * if the stack is empty.
+ * @param dst Pointer to the destination Stack.
+ * @param src Pointer to the source Stack (same element size as dst).
+ * @param k Number of elements to move, clamped to the size of src.
+ *
+ * @return STACK_OK on success, STACK_ERROR_UNSUPPORTED for mismatched element
+ * sizes or arena stacks, or the reason dst could not make room (both stacks
+ * are then unchanged).
  */
-void *pop(Stack *stack) {
-  if (!stack) {
-    return NULL;
+StackStatus stack_splice(Stack *dst, Stack *src, size_t k) {
+  if (!dst || !src) {
+    return STACK_ERROR_NULL;
   }
-  if (stack->size == 0) {
-    return NULL;
+  if (dst->element_size != src->element_size || dst->arena_copy || src->arena_copy) {
+    return STACK_ERROR_UNSUPPORTED;
   }
-  void *element = stack->data[--stack->size];
-  stack->data[stack->size] = NULL;
-  return element;
+  if (k > src->size) {
+    k = src->size;
+  }
+  if (dst == src || k == 0) {
+    return STACK_OK;
+  }
+  if (k > SIZE_MAX - dst->size) {
+    return STACK_ERROR_NO_MEMORY;
+  }
+  StackStatus status = try_reserve(dst, dst->size + k);
+  if (status == STACK_OK) {
+    status = index_reserve(dst, dst->size + k);
+  }
+  if (status != STACK_OK) {
+    return status;
+  }
+  size_t from = src->size - k;
+  for (size_t moved = 0; moved < k;) {
+    size_t run = run_length(src, from + moved, k - moved);
+    copy_in(dst, dst->size + moved, run, slot(src, from + moved));
+    moved += run;
+  }
+  for (size_t i = src->size; src->hash && i > from; --i) {
+    index_remove(src, i - 1);
+  }
+  src->size = from;
+  changed_from(src, from);
+  stat_pop(src, k);
+  for (size_t i = 0; i < k; ++i) {
+    index_insert(dst, dst->size++);
+  }
+  stat_push(dst, k);
+  return STACK_OK;
 }
 
 /**
- * @brief Returns the top element of the stack without removing it.
+ * @brief Moves every element of src onto dst, leaving src empty.
+ *
+ * Same as stack_splice() with k equal to the size of src.
+ *
+ * @param dst Pointer to the destination Stack.
+ * @param src Pointer to the source Stack.
+ *
+ * @return STACK_OK on success, or the reason the elements were not moved.
+ */
+StackStatus stack_concat(Stack *dst, Stack *src) {
+  if (!dst || !src) {
+    return STACK_ERROR_NULL;
+  }
+  return stack_splice(dst, src, src->size);
+}
+
+/**
+ * @brief Splits a stack in two at a given index.
+ *
+ * The bottom k elements stay in stack; the others are moved, without
+ * copying, into a new stack created with the same options.
  *
  * @param stack Pointer to the Stack.
+ * @param k Number of elements to keep (must not exceed the size).
  *
- * @return Pointer to the top element (do not modify or free). Returns NULL if
- * the stack is empty.
+ * @return Pointer to a new Stack holding the elements above index k, or NULL
+ * for an invalid k, arena stacks or on allocation failure.
  */
-void *peek(const Stack *stack) {
-  if (!stack) {
+Stack *stack_split_at(Stack *stack, size_t k) {
+  if (!stack || k > stack->size || stack->arena_copy) {
     return NULL;
   }
-  if (stack->size == 0) {
+  StackOptions options = options_of(stack);
+  Stack *top = create(&options);
+  if (!top) {
+    return NULL;
+  }
+  if (stack_splice(top, stack, stack->size - k) != STACK_OK) {
+    free_stack(top);
     return NULL;
   }
-  return stack->data[stack->size - 1];
+  return top;
 }
 
 /**
- * @brief Clears all elements from the stack.
+ * @brief Exchanges the contents of two stacks in O(1).
  *
- * Calls the user-supplied free_func for each element.
+ * Buffers, callbacks and options are exchanged; only elements in the small
+ * buffers are copied. Instrumentation counters stay with their stack object.
+ * Each header is released by the allocator of the stack it ends up in, so
+ * both stacks must share the same allocator. Open marks of both stacks are
+ * closed.
  *
- * @param stack Pointer to the Stack.
+ * @param a Pointer to the first Stack.
+ * @param b Pointer to the second Stack.
+ *
+ * @return true on success, false if the stacks differ in element size,
+ * number of inline slots or allocator (hooks and context).
  */
-void clear(Stack *stack) {
-  if (!stack) {
-    return;
+bool swap_stacks(Stack *a, Stack *b) {
+  if (!a || !b || a->element_size != b->element_size || a->small_capacity != b->small_capacity) {
+    return false;
   }
-  for (size_t i = 0; i < stack->size; ++i) {
-    stack->free_func(stack->data[i]);
+  if (a->allocator.alloc_func != b->allocator.alloc_func ||
+      a->allocator.realloc_func != b->allocator.realloc_func ||
+      a->allocator.free_func != b->allocator.free_func || a->allocator.ctx != b->allocator.ctx) {
+    return false;
   }
-  stack->size = 0;
+  if (a == b) {
+    return true;
+  }
+  bool a_small = uses_small(a);
+  bool b_small = uses_small(b);
+  if (a_small || b_small) {
+    swap_bytes(a->small, b->small, a->small_capacity * a->stride);
+  }
+  Stack tmp = *a;
+  *a = *b;
+  *b = tmp;
+  b->heap_header = a->heap_header;
+  a->heap_header = tmp.heap_header;
+  b->mark_count = a->mark_count;
+  a->mark_count = tmp.mark_count;
+  close_marks(a);
+  close_marks(b);
+#ifdef STACK_STATS
+  b->stats = a->stats;
+  b->growth_hook = a->growth_hook;
+  b->growth_hook_ctx = a->growth_hook_ctx;
+  a->stats = tmp.stats;
+  a->growth_hook = tmp.growth_hook;
+  a->growth_hook_ctx = tmp.growth_hook_ctx;
+#endif
+  if (b_small) {
+    a->data = (void **)a->small;
+  }
+  if (a_small) {
+    b->data = (void **)b->small;
+  }
+  a->arena.allocator = &a->allocator;
+  b->arena.allocator = &b->allocator;
+  return true;
 }
 
 /**
- * @brief Checks if the stack has no elements.
+ * @brief Returns a borrowed view of the stack elements.
+ *
+ * The elements of drop_oldest stacks wrap around their ring, so they have no
+ * contiguous view.
  *
  * @param stack Pointer to the Stack.
  *
- * @return true if empty, false otherwise.
+ * @return View of the live buffer, or an empty view for drop_oldest stacks.
  */
-bool is_empty(const Stack *stack) {
-  if (!stack) {
-    return true;
+StackView view(const Stack *stack) {
+  StackView result = {NULL, 0, 0};
+  if (!stack || stack->drop_oldest) {
+    return result;
   }
-  return stack->size == 0;
+  result.data = stack->size ? stack->data : NULL;
+  result.size = stack->size;
+  result.element_size = stack->element_size;
+  return result;
 }
 
 /**
- * @brief Returns the number of elements in the stack.
+ * @brief Returns an iterator from the top element down to the bottom.
  *
  * @param stack Pointer to the Stack.
  *
- * @return Number of elements.
+ * @return Iterator positioned before the top element.
  */
-size_t size(const Stack *stack) {
-  if (!stack) {
-    return 0;
+StackIterator iter_top(const Stack *stack) {
+  StackIterator it = {stack, 0, true};
+  return it;
+}
+
+/**
+ * @brief Returns an iterator from the bottom element up to the top.
+ *
+ * @param stack Pointer to the Stack.
+ *
+ * @return Iterator positioned before the bottom element.
+ */
+StackIterator iter_bottom(const Stack *stack) {
+  StackIterator it = {stack, 0, false};
+  return it;
+}
+
+/**
+ * @brief Advances an iterator.
+ *
+ * @param it Pointer to the StackIterator.
+ * @param element Receives the next element.
+ *
+ * @return true if an element was produced, false once all were visited.
+ */
+bool iter_next(StackIterator *it, void **element) {
+  if (!it || !it->stack || it->next >= it->stack->size) {
+    return false;
   }
-  return stack->size;
+  const Stack *stack = it->stack;
+  size_t index = it->from_top ? stack->size - 1 - it->next : it->next;
+  ++it->next;
+  if (element) {
+    *element = element_at(stack, index);
+  }
+  return true;
 }
 
 /**
- * @brief Returns the allocated capacity of the stack.
+ * @brief Calls visit for each element from the top down.
  *
  * @param stack Pointer to the Stack.
+ * @param visit Function called with each element.
+ * @param ctx User context passed to visit.
  *
- * @return Current allocated capacity.
+ * @return true if every element was visited, false if visit stopped early.
  */
-size_t capacity(const Stack *stack) {
-  if (!stack) {
-    return 0;
+bool for_each(const Stack *stack, StackVisitFunc visit, void *ctx) {
+  if (!stack || !visit) {
+    return false;
   }
-  return stack->capacity;
+  for (size_t i = stack->size; i > 0; --i) {
+    if (!visit(element_at(stack, i - 1), ctx)) {
+      return false;
+    }
+  }
+  return true;
 }
 
 /**
- * @brief Checks if the stack contains a given element.
+ * @brief Serializes the stack through a writer.
  *
- * Requires cmp_func to be non-NULL.
+ * Inline stacks are written in chunks of STACK_STREAM_CHUNK_SIZE bytes
+ * directly from the buffer.
  *
  * @param stack Pointer to the Stack.
- * @param element Pointer to the element to search for.
+ * @param encode Element encoder for pointer stacks.
+ * @param write Writer receiving the serialized bytes.
+ * @param ctx Writer context.
  *
- * @return true if found, false otherwise.
+ * @return STACK_OK on success, or the reason serialization failed.
  */
-bool contains(const Stack *stack, const void *element) {
-  if (!stack) {
-    return false;
+StackStatus serialize(const Stack *stack, StackEncodeFunc encode, StackWriteFunc write,
+                      void *ctx) {
+  if (!stack || !write) {
+    return STACK_ERROR_NULL;
+  }
+  if (!stack->element_size && !encode) {
+    return STACK_ERROR_UNSUPPORTED;
+  }
+  FileHeader header = {STACK_STREAM_MAGIC, stack->element_size, stack->size};
+  if (!write(ctx, &header, sizeof(header))) {
+    return STACK_ERROR_IO;
+  }
+  if (stack->element_size) {
+    for (size_t i = 0; i < stack->size;) {
+      size_t run = run_length(stack, i, stack->size - i);
+      size_t remaining = run * stack->stride;
+      const unsigned char *bytes = slot(stack, i);
+      while (remaining > 0) {
+        size_t chunk = remaining < STACK_STREAM_CHUNK_SIZE ? remaining : STACK_STREAM_CHUNK_SIZE;
+        if (!write(ctx, bytes, chunk)) {
+          return STACK_ERROR_IO;
+        }
+        bytes += chunk;
+        remaining -= chunk;
+      }
+      i += run;
+    }
+    return STACK_OK;
   }
   for (size_t i = 0; i < stack->size; ++i) {
-    if (stack->cmp(stack->data[i], element) == 0) {
-      return true;
+    if (!encode(*pointer_slot(stack, i), write, ctx)) {
+      return STACK_ERROR_IO;
     }
   }
-  return false;
+  return STACK_OK;
 }
 
 /**
- * @brief Creates a deep copy of the stack.
- * 
- * Elements are copied using the user-supplied copy function.
+ * @brief Reads a batch of serialized elements onto the top of the stack.
+ *
+ * Room for the batch must have been reserved.
  *
  * @param stack Pointer to the Stack.
+ * @param count Number of elements in the batch.
+ * @param decode Element decoder for pointer stacks.
+ * @param read Reader supplying the serialized bytes.
+ * @param ctx Reader context.
  *
- * @return Pointer to a new Stack with copied elements.
+ * @return true on success, false if read or decode fail. The elements read
+ * before the failure stay on the stack.
  */
-Stack *clone(const Stack *stack) {
-  if (!stack) {
-    return NULL;
+static bool read_batch(Stack *stack, size_t count, StackDecodeFunc decode, StackReadFunc read,
+                       void *ctx) {
+  if (stack->element_size) {
+    while (count > 0) {
+      size_t run = run_length(stack, stack->size, count);
+      if (!read(ctx, slot(stack, stack->size), run * stack->stride)) {
+        return false;
+      }
+      for (size_t i = 0; i < run; ++i) {
+        index_insert(stack, stack->size++);
+      }
+      count -= run;
+    }
+    return true;
   }
-  Stack *clone = new_stack(stack->copy, stack->free_func, stack->cmp);
-  for (size_t i = 0; i < stack->size; ++i) {
-    push(clone, stack->data[i]);
+  for (size_t i = 0; i < count; ++i) {
+    void *element = decode(read, ctx);
+    if (!element) {
+      return false;
+    }
+    *pointer_slot(stack, stack->size) = element;
+    index_insert(stack, stack->size++);
   }
-  return clone;
+  return true;
 }
 
 /**
- * @brief Reverses the stack in-place by swapping elements.
+ * @brief Deserializes elements from a reader and pushes them onto the stack.
+ *
+ * The count in the header is not trusted: room is reserved for at most
+ * STACK_STREAM_CHUNK_SIZE bytes of elements at a time, growing only as data
+ * arrives, so a corrupt count cannot force a huge allocation. On failure the
+ * pushed elements are removed and the previous capacity is restored; arena
+ * stacks also release the arena memory decode allocated, as rollback() does.
  *
  * @param stack Pointer to the Stack.
+ * @param decode Element decoder for pointer stacks.
+ * @param read Reader supplying the serialized bytes.
+ * @param ctx Reader context.
+ *
+ * @return STACK_OK on success, or the reason deserialization failed.
  */
-void reverse(Stack *stack) {
-  if (stack->size == 0) {
-    return;
+StackStatus deserialize(Stack *stack, StackDecodeFunc decode, StackReadFunc read, void *ctx) {
+  if (!stack || !read) {
+    return STACK_ERROR_NULL;
   }
-  size_t left = 0;
-  size_t right = stack->size - 1;
-  while (left < right) {
-    void *tmp = stack->data[left];
-    stack->data[left] = stack->data[right];
-    stack->data[right] = tmp;
-    ++left;
-    --right;
+  if (!stack->element_size && !decode) {
+    return STACK_ERROR_UNSUPPORTED;
+  }
+  FileHeader header;
+  if (!read(ctx, &header, sizeof(header))) {
+    return STACK_ERROR_IO;
+  }
+  if (memcmp(header.magic, STACK_STREAM_MAGIC, sizeof(header.magic)) != 0 ||
+      header.element_size != stack->element_size) {
+    return STACK_ERROR_FORMAT;
+  }
+  if (header.size > SIZE_MAX - stack->size) {
+    return STACK_ERROR_NO_MEMORY;
+  }
+  size_t old_size = stack->size;
+  size_t old_capacity = stack->capacity;
+  ArenaChunk *old_chunk = stack->arena.head;
+  size_t old_used = old_chunk ? old_chunk->used : 0;
+  size_t count = (size_t)header.size;
+  if (stack->growth.max_capacity && old_size + count > stack->growth.max_capacity) {
+    return STACK_ERROR_FULL;
+  }
+  size_t batch = STACK_STREAM_CHUNK_SIZE / stack->stride;
+  if (batch == 0) {
+    batch = 1;
+  }
+  StackStatus status = STACK_OK;
+  while (status == STACK_OK && stack->size - old_size < count) {
+    size_t left = count - (stack->size - old_size);
+    size_t n = left < batch ? left : batch;
+    status = grow(stack, stack->size + n);
+    if (status == STACK_OK) {
+      status = index_reserve(stack, stack->size + n);
+    }
+    if (status == STACK_OK && !read_batch(stack, n, decode, read, ctx)) {
+      status = STACK_ERROR_IO;
+    }
+  }
+  if (status != STACK_OK) {
+    truncate_to(stack, old_size);
+    if (stack->capacity > old_capacity) {
+      resize(stack, old_capacity);
+    }
+    if (stack->arena_copy) {
+      arena_rewind(&stack->arena, old_chunk, old_used);
+    }
+    return status;
   }
+  stat_push(stack, count);
+  return STACK_OK;
 }
 
 /**
- * @brief Converts the stack to a newly heap-allocated array.
- * 
- * Caller must free both the array and its elements.
+ * @brief Returns the number of bytes serialize() writes for an inline stack.
  *
  * @param stack Pointer to the Stack.
- * @param out_size Optional pointer to receive the array size.
  *
- * @return Pointer to a new array containing all stack elements.
+ * @return Serialized size in bytes, or 0 for pointer stacks.
  */
-void **to_array(const Stack *stack, size_t *out_size) {
-  if (stack->size == 0) {
-    if (out_size) {
-      *out_size = 0;
+size_t serialized_size(const Stack *stack) {
+  if (!stack || !stack->element_size) {
+    return 0;
+  }
+  return sizeof(FileHeader) + stack->size * stack->stride;
+}
+
+/**
+ * @brief Writes bytes to the file descriptor pointed to by ctx.
+ *
+ * @param ctx Pointer to an int holding the file descriptor.
+ * @param data Bytes to write.
+ * @param size Number of bytes to write.
+ *
+ * @return true if all bytes were written, false on failure.
+ */
+bool write_fd(void *ctx, const void *data, size_t size) {
+  int fd = *(const int *)ctx;
+  const unsigned char *bytes = data;
+  while (size > 0) {
+    ssize_t written = write(fd, bytes, size);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
     }
-    return NULL;
+    bytes += written;
+    size -= (size_t)written;
   }
-  void **array = malloc(stack->size * sizeof(void *));
-  if (!array) {
-    exit(EXIT_FAILURE);
+  return true;
+}
+
+/**
+ * @brief Reads bytes from the file descriptor pointed to by ctx.
+ *
+ * @param ctx Pointer to an int holding the file descriptor.
+ * @param data Destination buffer.
+ * @param size Number of bytes to read.
+ *
+ * @return true if exactly size bytes were read, false otherwise.
+ */
+bool read_fd(void *ctx, void *data, size_t size) {
+  int fd = *(const int *)ctx;
+  unsigned char *bytes = data;
+  while (size > 0) {
+    ssize_t got = read(fd, bytes, size);
+    if (got < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    if (got == 0) {
+      return false;
+    }
+    bytes += got;
+    size -= (size_t)got;
   }
-  for (size_t i = 0; i < stack->size; ++i) {
-    array[i] = stack->copy(stack->data[i]);
+  return true;
+}
+
+/**
+ * @brief Appends bytes to a StackBuffer.
+ *
+ * @param ctx Pointer to the StackBuffer.
+ * @param data Bytes to write.
+ * @param size Number of bytes to write.
+ *
+ * @return true if the bytes were written, false if the buffer is too small.
+ */
+bool write_buffer(void *ctx, const void *data, size_t size) {
+  StackBuffer *buffer = ctx;
+  if (size > buffer->size - buffer->pos) {
+    return false;
   }
-  if (out_size) {
-    *out_size = stack->size;
+  memcpy(buffer->data + buffer->pos, data, size);
+  buffer->pos += size;
+  return true;
+}
+
+/**
+ * @brief Consumes bytes from a StackBuffer.
+ *
+ * @param ctx Pointer to the StackBuffer.
+ * @param data Destination buffer.
+ * @param size Number of bytes to read.
+ *
+ * @return true if the bytes were read, false if fewer remain.
+ */
+bool read_buffer(void *ctx, void *data, size_t size) {
+  StackBuffer *buffer = ctx;
+  if (size > buffer->size - buffer->pos) {
+    return false;
   }
-  return array;
+  memcpy(data, buffer->data + buffer->pos, size);
+  buffer->pos += size;
+  return true;
 }
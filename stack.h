@@ -7,6 +7,8 @@
  * pop, peek, and utility functions like clone, reverse, and to_array.
  *
  * The stack is implemented as a dynamically resized array of void pointers.
+ * Alternatively, an inline stack stores fixed-size elements by value in a
+ * contiguous buffer, avoiding per-element allocations.
  *
  * Users must provide functions to copy, free, and optionally compare elements.
  *
@@ -20,6 +22,7 @@
 #include <bits/types/siginfo_t.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 /**
  * @typedef Stack
@@ -28,6 +31,34 @@
  */
 typedef struct Stack Stack;
 
+/**
+ * Minimum size in bytes of caller-provided storage for init_stack().
+ *
+ * Builds with STACK_STATS defined carry per-stack counters and need more.
+ */
+#ifdef STACK_STATS
+#define STACK_STORAGE_SIZE 320
+#else
+#define STACK_STORAGE_SIZE 256
+#endif
+
+/**
+ * Required alignment of caller-provided storage for init_stack().
+ */
+#define STACK_STORAGE_ALIGN _Alignof(max_align_t)
+
+/**
+ * @typedef StackStorage
+ *
+ * @brief Suitably sized and aligned storage for embedding a Stack.
+ *
+ * Declare it as a struct member or local variable and pass it to init_stack().
+ */
+typedef union StackStorage {
+  unsigned char bytes[STACK_STORAGE_SIZE];
+  max_align_t align;
+} StackStorage;
+
 /**
  * @typedef StackCopyFunc
  *
@@ -48,6 +79,16 @@ typedef void *(*StackCopyFunc)(const void *element);
  */
 typedef void (*StackFreeFunc)(void *element);
 
+/**
+ * @typedef StackBatchFreeFunc
+ *
+ * @brief Function pointer type for freeing a run of stack elements at once.
+ *
+ * @param elements Array of element pointers to free.
+ * @param count Number of element pointers in the array.
+ */
+typedef void (*StackBatchFreeFunc)(void **elements, size_t count);
+
 /**
  * @typedef StackCompareFunc
  *
@@ -60,126 +101,1275 @@ typedef void (*StackFreeFunc)(void *element);
  */
 typedef int (*StackCompareFunc)(const void *a, const void *b);
 
+/**
+ * @typedef StackHashFunc
+ *
+ * @brief Function pointer type for hashing stack elements.
+ *
+ * Elements that compare equal must hash equally.
+ *
+ * @param element Pointer to the element to hash.
+ *
+ * @return Hash of the element.
+ */
+typedef size_t (*StackHashFunc)(const void *element);
+
+/**
+ * @typedef StackArena
+ *
+ * @brief Opaque bump allocator holding the element copies of an arena stack.
+ */
+typedef struct StackArena StackArena;
+
+/**
+ * @typedef StackArenaCopyFunc
+ *
+ * @brief Function pointer type for copying stack elements into an arena.
+ *
+ * The copy must be allocated with arena_alloc(); it is released together with
+ * the rest of the arena by clear() or free_stack().
+ *
+ * @param element Pointer to the element to copy.
+ * @param arena Arena to allocate the copy from.
+ *
+ * @return Pointer to the copy inside the arena, or NULL on failure.
+ */
+typedef void *(*StackArenaCopyFunc)(const void *element, StackArena *arena);
+
+/**
+ * @struct StackAllocator
+ *
+ * @brief Pluggable allocator for the stack header, buffer and arena chunks.
+ *
+ * Every hook receives ctx. The size of the block being resized or released is
+ * passed back, so size-aware allocators do not need to track it.
+ */
+typedef struct StackAllocator {
+  void *(*alloc_func)(void *ctx, size_t size);
+  void *(*realloc_func)(void *ctx, void *ptr, size_t old_size, size_t new_size);
+  void (*free_func)(void *ctx, void *ptr, size_t size);
+  void *ctx;
+} StackAllocator;
+
+/**
+ * @enum StackStatus
+ *
+ * @brief Result codes reported by the status-returning stack operations.
+ */
+typedef enum StackStatus {
+  STACK_OK = 0,            // Operation succeeded.
+  STACK_ERROR_NULL,        // A required argument was NULL.
+  STACK_ERROR_NO_MEMORY,   // An allocation or an element copy failed.
+  STACK_ERROR_FULL,        // The stack reached its maximum capacity.
+  STACK_ERROR_UNSUPPORTED, // The operation is not available for this stack.
+  STACK_ERROR_IO,          // Reading or writing serialized data failed.
+  STACK_ERROR_FORMAT,      // Serialized data is malformed or does not match.
+} StackStatus;
+
+/**
+ * Huge page size assumed by the page allocator, and the smallest block it
+ * maps directly instead of using malloc().
+ */
+#define STACK_HUGE_PAGE_SIZE ((size_t)2 * 1024 * 1024)
+
+/**
+ * @enum StackHugePages
+ *
+ * @brief Huge page backing requested for large stack buffers.
+ */
+typedef enum StackHugePages {
+  STACK_HUGE_PAGES_NONE = 0,    // Regular pages from malloc().
+  STACK_HUGE_PAGES_TRANSPARENT, // Anonymous mappings advised with MADV_HUGEPAGE.
+  STACK_HUGE_PAGES_EXPLICIT,    // MAP_HUGETLB, falling back to transparent huge pages.
+} StackHugePages;
+
+/**
+ * @enum StackNumaPolicy
+ *
+ * @brief NUMA placement requested for large stack buffers.
+ */
+typedef enum StackNumaPolicy {
+  STACK_NUMA_DEFAULT = 0, // Pages land on the node that first touches them.
+  STACK_NUMA_BIND,        // Pages are allocated on the nodes in numa_nodes.
+  STACK_NUMA_INTERLEAVE,  // Pages are interleaved across the nodes in numa_nodes.
+} StackNumaPolicy;
+
+/**
+ * @struct StackGrowthPolicy
+ *
+ * @brief Controls how the capacity grows when the stack runs out of space.
+ */
+typedef struct StackGrowthPolicy {
+  double factor;       // Multiplicative growth factor (> 1), used if chunk is 0.
+  size_t chunk;        // Fixed number of slots added per growth, or 0.
+  size_t max_capacity; // Capacity limit at which pushes fail, or 0 for none.
+} StackGrowthPolicy;
+
+/**
+ * @struct StackOptions
+ *
+ * @brief Construction-time configuration of a stack.
+ *
+ * Zero-initialize it and set the fields of interest: zeroed fields select a
+ * pointer stack with no small buffer, the default growth policy and malloc().
+ *
+ * A non-zero bound makes the stack bounded: its buffer is allocated once at
+ * construction and the growth policy is ignored. Pushing onto a full bounded
+ * stack fails with STACK_ERROR_FULL, or with drop_oldest removes the bottom
+ * element (freeing it with free_func) in O(1). The elements of a drop_oldest
+ * stack wrap around a ring of bound slots, so view() cannot expose them.
+ *
+ * A hash_func (together with a cmp_func) gives the stack a membership index
+ * kept up to date by every push and pop, making contains() and index_of()
+ * O(1) expected. It cannot be combined with drop_oldest.
+ *
+ * huge_pages and numa_policy replace malloc() with an internal page
+ * allocator: blocks of STACK_HUGE_PAGE_SIZE bytes or more are mapped directly,
+ * backed by huge pages and bound to or interleaved across NUMA nodes where
+ * the system allows it, and silently fall back to regular pages otherwise.
+ * They cannot be combined with a custom allocator.
+ */
+typedef struct StackOptions {
+  size_t element_size;                // Inline element size, or 0 for pointers.
+  size_t inline_slots;                // Slots stored inside the Stack object.
+  StackCopyFunc copy_func;            // Copies elements (pointer stacks).
+  StackFreeFunc free_func;            // Frees elements (pointer stacks).
+  StackCompareFunc cmp_func;          // Compares elements (optional).
+  StackGrowthPolicy growth;           // Growth policy, zeroed for the default.
+  const StackAllocator *allocator;    // Allocator (copied), or NULL for malloc.
+  StackArenaCopyFunc arena_copy_func; // Copies elements into the stack arena.
+  size_t bound;                       // Fixed capacity, or 0 for a growable stack.
+  bool drop_oldest;                   // Drop the bottom element when bounded and full.
+  StackHashFunc hash_func;            // Hashes elements for the index, or NULL.
+  StackBatchFreeFunc batch_free_func; // Frees runs of elements, replacing free_func.
+  StackHugePages huge_pages;          // Huge page backing of large blocks.
+  StackNumaPolicy numa_policy;        // NUMA placement of large blocks.
+  uint64_t numa_nodes;                // Node mask (nodes 0-59) for numa_policy, 0 for all.
+} StackOptions;
+
+/**
+ * @typedef StackWriteFunc
+ *
+ * @brief Function pointer type for writing serialized bytes.
+ *
+ * @param ctx Writer context.
+ * @param data Bytes to write.
+ * @param size Number of bytes to write.
+ *
+ * @return true if all bytes were written, false on failure.
+ */
+typedef bool (*StackWriteFunc)(void *ctx, const void *data, size_t size);
+
+/**
+ * @typedef StackReadFunc
+ *
+ * @brief Function pointer type for reading serialized bytes.
+ *
+ * @param ctx Reader context.
+ * @param data Destination buffer.
+ * @param size Number of bytes to read.
+ *
+ * @return true if exactly size bytes were read, false on failure or end of
+ * input.
+ */
+typedef bool (*StackReadFunc)(void *ctx, void *data, size_t size);
+
+/**
+ * @typedef StackEncodeFunc
+ *
+ * @brief Function pointer type for serializing one element of a pointer stack.
+ *
+ * @param element Pointer to the element to encode.
+ * @param write Writer to emit the encoded bytes with.
+ * @param ctx Writer context to pass to write.
+ *
+ * @return true on success, false on failure.
+ */
+typedef bool (*StackEncodeFunc)(const void *element, StackWriteFunc write, void *ctx);
+
+/**
+ * @typedef StackDecodeFunc
+ *
+ * @brief Function pointer type for deserializing one element of a pointer
+ * stack.
+ *
+ * @param read Reader to consume the encoded bytes with.
+ * @param ctx Reader context to pass to read.
+ *
+ * @return Pointer to a newly allocated element, or NULL on failure.
+ */
+typedef void *(*StackDecodeFunc)(StackReadFunc read, void *ctx);
+
+/**
+ * @struct StackStats
+ *
+ * @brief Instrumentation counters of a stack.
+ *
+ * Only maintained when the library is compiled with STACK_STATS defined.
+ */
+typedef struct StackStats {
+  size_t pushes;        // Elements pushed.
+  size_t pops;          // Elements popped.
+  size_t high_water;    // Largest size reached.
+  size_t reallocs;      // Buffer allocations and reallocations.
+  size_t realloc_bytes; // Total bytes requested by those allocations.
+  size_t copy_calls;    // Calls to copy_func or arena_copy_func.
+  size_t free_calls;    // Calls to free_func or batch_free_func.
+} StackStats;
+
+/**
+ * @typedef StackGrowthHook
+ *
+ * @brief Function pointer type called after the buffer of a stack grew.
+ *
+ * @param stack Pointer to the Stack that grew.
+ * @param old_capacity Capacity before the growth.
+ * @param new_capacity Capacity after the growth.
+ * @param ctx User context given to set_growth_hook().
+ */
+typedef void (*StackGrowthHook)(const Stack *stack, size_t old_capacity, size_t new_capacity,
+                                void *ctx);
+
+/**
+ * @struct StackView
+ *
+ * @brief Borrowed read-only view of the elements of a stack.
+ *
+ * data points into the live buffer, bottom element first: an array of size
+ * element pointers for pointer stacks, or size packed elements of
+ * element_size bytes for inline stacks. The view is valid until the stack is
+ * next modified. drop_oldest stacks, whose elements wrap around a ring, have
+ * no view.
+ */
+typedef struct StackView {
+  const void *data;    // First (bottom) slot, or NULL if the stack is empty.
+  size_t size;         // Number of elements.
+  size_t element_size; // Inline element size, or 0 for pointer stacks.
+} StackView;
+
+/**
+ * @struct StackIterator
+ *
+ * @brief Borrowing iterator over the elements of a stack.
+ *
+ * Obtained from iter_top() or iter_bottom() and advanced with iter_next().
+ * Invalidated by any modification of the stack.
+ */
+typedef struct StackIterator {
+  const Stack *stack; // Stack being iterated.
+  size_t next;        // Number of elements already visited.
+  bool from_top;      // Whether iteration runs from the top down.
+} StackIterator;
+
+/**
+ * @struct StackMark
+ *
+ * @brief Checkpoint returned by mark() and consumed by rollback() or commit().
+ *
+ * Closed, together with every other open mark of the stack, by clear(),
+ * swap_stacks() or any operation that removes or moves an element below the
+ * innermost open mark.
+ */
+typedef struct StackMark {
+  size_t depth;       // Size of the stack when the mark was taken.
+  size_t serial;      // Identifies the mark within its stack, or 0.
+  size_t outer;       // Serial of the enclosing open mark, or 0.
+  size_t outer_depth; // Depth of the enclosing open mark.
+  const void *chunk;  // Arena chunk in use at that time, or NULL.
+  size_t used;        // Bytes used in that chunk at that time.
+} StackMark;
+
+/**
+ * @typedef StackVisitFunc
+ *
+ * @brief Function pointer type for visiting stack elements with for_each().
+ *
+ * @param element Pointer to the element (do not free).
+ * @param ctx User context passed to for_each().
+ *
+ * @return true to continue, false to stop the iteration.
+ */
+typedef bool (*StackVisitFunc)(void *element, void *ctx);
+
+/**
+ * @typedef StackPredicate
+ *
+ * @brief Function pointer type for testing elements in bulk operations.
+ *
+ * @param element Pointer to the element (do not free).
+ * @param ctx User context passed to the bulk operation.
+ *
+ * @return true if the element matches.
+ */
+typedef bool (*StackPredicate)(const void *element, void *ctx);
+
+/**
+ * @typedef StackMapFunc
+ *
+ * @brief Function pointer type for updating elements in place with map().
+ *
+ * @param element Pointer to the element, modified in place.
+ * @param ctx User context passed to map().
+ */
+typedef void (*StackMapFunc)(void *element, void *ctx);
+
+/**
+ * @struct StackBuffer
+ *
+ * @brief Memory buffer for write_buffer() and read_buffer().
+ */
+typedef struct StackBuffer {
+  unsigned char *data; // Buffer memory.
+  size_t size;         // Size of the buffer in bytes.
+  size_t pos;          // Offset of the next byte to read or write.
+} StackBuffer;
+
 /**
  * @brief Creates a new stack.
  *
- * @param copy_func Function to copy elements (must not be NULL).
- * @param free_func Function to free elements (must not be NULL).
+ * Without a copy_func the stack is move-only and elements are added with
+ * push_owned(). Without a free_func the stack never frees its elements.
+ *
+ * @param copy_func Function to copy elements (may be NULL).
+ * @param free_func Function to free elements (may be NULL).
  * @param cmp_func Function to compare elements (optional, may be NULL).
  *
  * @return Pointer to the new Stack, or NULL on allocation failure.
  */
 Stack *new_stack(StackCopyFunc copy_func, StackFreeFunc free_func, StackCompareFunc cmp_func);
 
+/**
+ * @brief Creates a new stack whose first slots live inside the Stack object.
+ *
+ * The heap buffer is only allocated once more than inline_slots elements are
+ * pushed, so short-lived small stacks cost a single allocation. new_stack()
+ * uses a small buffer of the initial capacity.
+ *
+ * @param inline_slots Number of slots stored inside the Stack object.
+ * @param copy_func Function to copy elements (may be NULL).
+ * @param free_func Function to free elements (may be NULL).
+ * @param cmp_func Function to compare elements (optional, may be NULL).
+ *
+ * @return Pointer to the new Stack, or NULL on allocation failure.
+ */
+Stack *new_small_stack(size_t inline_slots, StackCopyFunc copy_func, StackFreeFunc free_func,
+                       StackCompareFunc cmp_func);
+
+/**
+ * @brief Creates a new inline stack for fixed-size elements.
+ *
+ * Elements are stored by value inside the stack buffer: push() copies
+ * element_size bytes with memcpy and no copy or free function is involved.
+ *
+ * @param elem_size Size in bytes of each element (must not be 0).
+ * @param cmp_func Function to compare elements (optional, may be NULL, in
+ * which case contains() and index_of() compare bytes).
+ *
+ * @return Pointer to the new Stack, or NULL on invalid size or allocation
+ * failure.
+ */
+Stack *new_inline_stack(size_t elem_size, StackCompareFunc cmp_func);
+
+/**
+ * @brief Creates a new stack of small unsigned integers.
+ *
+ * An inline stack packing each value into width_bits / 8 bytes, used with
+ * push_int(), pop_int() and peek_int(). A 16-bit stack takes 2 bytes per
+ * value instead of a pointer slot plus an allocation.
+ *
+ * @param width_bits Width of each value in bits: 8, 16 or 32.
+ *
+ * @return Pointer to the new Stack, or NULL for an unsupported width or on
+ * allocation failure.
+ */
+Stack *new_int_stack(size_t width_bits);
+
+/**
+ * @brief Creates a new bounded stack with a fixed capacity.
+ *
+ * The buffer is allocated once here; pushes never allocate stack memory.
+ * When the stack is full, push() fails or, with drop_oldest, frees the bottom
+ * element to make room, which suits undo histories and "last N" traces.
+ *
+ * drop_oldest uses the bound slots as a ring: each drop advances the ring's
+ * head and the push overwrites the freed slot in place, so every push is
+ * O(1). The elements are not contiguous, so view() returns an empty view;
+ * the iterators and every other operation handle the wrap.
+ *
+ * @param bound Fixed capacity (must not be 0).
+ * @param drop_oldest Whether a full stack drops its bottom element instead of
+ * rejecting the push.
+ * @param copy_func Function to copy elements (may be NULL).
+ * @param free_func Function to free elements (may be NULL).
+ * @param cmp_func Function to compare elements (optional, may be NULL).
+ *
+ * @return Pointer to the new Stack, or NULL if bound is 0 or on allocation
+ * failure.
+ */
+Stack *new_bounded_stack(size_t bound, bool drop_oldest, StackCopyFunc copy_func,
+                         StackFreeFunc free_func, StackCompareFunc cmp_func);
+
+/**
+ * @brief Opens a stack of fixed-size elements backed by a memory-mapped file.
+ *
+ * The buffer is a shared mapping of the file, which grows with the stack by
+ * extending the file, so the stack can exceed RAM and the OS pages it in and
+ * out. Reopening the file resumes with the size recorded by the last
+ * sync_stack(), deinit_stack() or free_stack(); free_stack() closes the file
+ * without clearing it. Elements should be plain data without pointers.
+ *
+ * @param path Path of the backing file, created if missing.
+ * @param elem_size Size in bytes of each element (must not be 0).
+ * @param cmp_func Function to compare elements (optional, may be NULL).
+ *
+ * @return Pointer to the new Stack, or NULL if elem_size is 0, the file
+ * cannot be opened or mapped, or it holds a stack of another element size.
+ */
+Stack *open_file_stack(const char *path, size_t elem_size, StackCompareFunc cmp_func);
+
+/**
+ * @brief Creates a new stack from a set of options.
+ *
+ * With an allocator every allocation of the stack header, buffer and arena
+ * goes through it. With an arena_copy_func element copies are bump-allocated
+ * from an arena owned by the stack: clear() and free_stack() release them all
+ * at once without calling free_func, and popped elements stay valid until
+ * then. copy_func and free_func are then only used by to_array().
+ *
+ * @param options Pointer to the StackOptions.
+ *
+ * @return Pointer to the new Stack, or NULL if the options are invalid (an
+ * inline stack with an arena, an allocator with missing hooks, drop_oldest
+ * without a bound or with an arena, a hash_func without a cmp_func or with
+ * drop_oldest) or on allocation failure.
+ */
+Stack *new_stack_with_options(const StackOptions *options);
+
+/**
+ * @brief Constructs a stack inside caller-owned storage.
+ *
+ * No allocation takes place until the stack outgrows the storage: bytes
+ * beyond the header are used as inline slots. Release the stack with
+ * deinit_stack().
+ *
+ * @param storage Memory for the stack, aligned to STACK_STORAGE_ALIGN (for
+ * example a StackStorage).
+ * @param storage_size Size of storage in bytes (at least STACK_STORAGE_SIZE).
+ * @param copy_func Function to copy elements (may be NULL).
+ * @param free_func Function to free elements (may be NULL).
+ * @param cmp_func Function to compare elements (optional, may be NULL).
+ *
+ * @return Pointer to the Stack inside storage, or NULL if the storage is too
+ * small or misaligned.
+ */
+Stack *init_stack(void *storage, size_t storage_size, StackCopyFunc copy_func,
+                  StackFreeFunc free_func, StackCompareFunc cmp_func);
+
+/**
+ * @brief Constructs a stack described by a set of options inside caller-owned
+ * storage.
+ *
+ * options->inline_slots is ignored: the bytes beyond the header are used as
+ * the small buffer.
+ *
+ * @param storage Memory for the stack, aligned to STACK_STORAGE_ALIGN.
+ * @param storage_size Size of storage in bytes (at least STACK_STORAGE_SIZE).
+ * @param options Pointer to the StackOptions.
+ *
+ * @return Pointer to the Stack inside storage, or NULL if the storage is too
+ * small or misaligned or the options are invalid.
+ */
+Stack *init_stack_with_options(void *storage, size_t storage_size, const StackOptions *options);
+
+/**
+ * @brief Frees the elements and buffer of the stack but not the stack itself.
+ *
+ * Calls the user-provided free_func for each element. Use it for stacks
+ * created with init_stack(); the storage may then be reused.
+ *
+ * @param stack Pointer to the Stack.
+ */
+void deinit_stack(Stack *stack);
+
 /**
  * @brief Frees all memory associated with the stack.
  *
- * Calls the user-provided free_func for each element.
+ * Calls the user-provided free_func for each element, or batch_free_func once
+ * for all of them.
  *
  * @param stack Pointer to the Stack.
  */
 void free_stack(Stack *stack);
 
 /**
- * @brief Pushes a new element onto the stack.
+ * @brief Frees the stack on a background reclaimer thread.
+ *
+ * Only queues the stack, so the caller is not stalled by freeing millions of
+ * elements. The stack must not be used afterwards, and its free functions and
+ * allocator hooks must be safe to call from the reclaimer thread. Stacks in
+ * caller-provided storage are freed synchronously.
  *
  * @param stack Pointer to the Stack.
- * @param element Pointer to the element to push.
+ *
+ * @return true if the stack was queued, false if it was freed synchronously.
  */
-void push(Stack *stack, const void *element);
+bool free_stack_async(Stack *stack);
 
 /**
- * @brief Removes and returns the top element from the stack.
+ * @brief Waits until every stack queued by free_stack_async() has been freed.
+ */
+void wait_stack_reclaimer(void);
+
+/**
+ * @brief Pushes a new element onto the stack.
  *
  * @param stack Pointer to the Stack.
+ * @param element Pointer to the element to push.
  *
- * @return Pointer to the removed element. Caller must be free it. Returns NULL
- * if the stack is empty.
+ * @return true if the element was pushed, false if the stack is full or on
+ * allocation failure.
  */
-void *pop(Stack *stack);
+bool push(Stack *stack, const void *element);
 
 /**
- * @brief Returns the top element of the stack without removing it.
+ * @brief Pushes a new element onto the stack, reporting the failure reason.
+ *
+ * Nothing is pushed on failure, so the caller can shed load instead of
+ * crashing under memory pressure.
  *
  * @param stack Pointer to the Stack.
+ * @param element Pointer to the element to push.
  *
- * @return Pointer to the top element (do not modify or free). Returns NULL if
- * the stack is empty.
+ * @return STACK_OK on success, STACK_ERROR_FULL at the maximum capacity,
+ * STACK_ERROR_NO_MEMORY if growing or copying the element failed, or
+ * STACK_ERROR_UNSUPPORTED for move-only stacks.
  */
-void *peek(const Stack *stack);
+StackStatus try_push(Stack *stack, const void *element);
 
 /**
- * @brief Clears all elements from the stack.
+ * @brief Pushes an element onto the stack, taking ownership of the pointer.
  *
- * Calls free_func for each element.
+ * copy_func is not called: the stack stores the pointer as-is and later frees
+ * it with free_func. pop() hands ownership back. Only pointer stacks support
+ * this.
  *
  * @param stack Pointer to the Stack.
+ * @param element Pointer to the element to push.
+ *
+ * @return true if the element was pushed, false otherwise (the caller then
+ * still owns element).
  */
-void clear(Stack *stack);
+bool push_owned(Stack *stack, void *element);
 
 /**
- * @brief Checks if the stack is empty.
+ * @brief Pushes an element onto the stack, taking ownership of the pointer,
+ * and reports the failure reason.
  *
  * @param stack Pointer to the Stack.
+ * @param element Pointer to the element to push.
  *
- * @return true if empty, false otherwise.
+ * @return STACK_OK on success, or STACK_ERROR_FULL, STACK_ERROR_NO_MEMORY or
+ * STACK_ERROR_UNSUPPORTED (inline stacks) on failure.
  */
-bool is_empty(const Stack *stack);
+StackStatus try_push_owned(Stack *stack, void *element);
 
 /**
- * @brief Returns the number of elements in the stack.
+ * @brief Pushes count elements onto the stack with a single capacity
+ * reservation.
  *
  * @param stack Pointer to the Stack.
+ * @param elements Packed elements for inline stacks, or an array of count
+ * element pointers (each copied with copy_func) for pointer stacks. The last
+ * element ends up on top.
+ * @param count Number of elements to push.
  *
- * @return Number of elements.
+ * @return Number of elements pushed, fewer than count if the maximum capacity
+ * is reached or an allocation fails.
  */
-size_t size(const Stack *stack);
+size_t push_n(Stack *stack, const void *elements, size_t count);
 
 /**
- * @brief Returns the internal capacity of the stack.
+ * @brief Removes and returns the top element from the stack.
+ *
+ * For inline stacks the returned pointer refers to the vacated slot inside the
+ * stack buffer and is only valid until the next push; it must not be freed.
  *
  * @param stack Pointer to the Stack.
  *
- * @return Current allocated capacity.
+ * @return Pointer to the removed element. Caller must be free it. Returns NULL
+ * if the stack is empty.
  */
-size_t capacity(const Stack *stack);
+void *pop(Stack *stack);
 
 /**
- * @brief Checks if the stack contains a given element.
+ * @brief Removes the top element from the stack and copies it into out.
  *
- * Requires cmp_func to be non-NULL.
+ * For inline stacks element_size bytes are copied; for pointer stacks the
+ * element pointer is stored in *(void **)out and the caller owns it.
  *
  * @param stack Pointer to the Stack.
- * @param element Pointer to the element to search for.
+ * @param out Destination buffer for the removed element.
  *
- * @return true if found, false otherwise.
+ * @return true if an element was removed, false if the stack is empty.
  */
-bool contains(const Stack *stack, const void *element);
+bool pop_into(Stack *stack, void *out);
 
 /**
- * @brief Creates a deep copy of the stack.
+ * @brief Removes up to count elements from the top of the stack.
+ *
+ * Slots are written to out in stack order (the former top element last), so
+ * push_n() with the same buffer restores them. For pointer stacks the caller
+ * owns the returned element pointers.
  *
  * @param stack Pointer to the Stack.
+ * @param out Destination buffer with room for count slots.
+ * @param count Maximum number of elements to remove.
  *
- * @return Pointer to a new Stack with copied elements.
+ * @return Number of elements removed.
  */
-Stack *clone(const Stack *stack);
+size_t pop_n(Stack *stack, void *out, size_t count);
 
 /**
- * @brief Reverses the order of elements in the stack.
+ * @brief Returns the top element of the stack without removing it.
  *
  * @param stack Pointer to the Stack.
+ *
+ * @return Pointer to the top element (do not modify or free). Returns NULL if
+ * the stack is empty.
  */
-void reverse(Stack *stack);
+void *peek(const Stack *stack);
 
 /**
- * @brief Converts the stack to a newly allocated array.
+ * @brief Pushes an integer onto an integer stack.
+ *
+ * Works on any inline stack with 1, 2 or 4 byte elements.
  *
  * @param stack Pointer to the Stack.
- * @param out_size Optional pointer to receive the array size.
+ * @param value Value to push (must fit in the stack's width).
  *
- * @return Pointer to a new array containing all stack elements.
+ * @return true if the value was pushed, false if it does not fit, for other
+ * stacks or on allocation failure.
+ */
+bool push_int(Stack *stack, uint32_t value);
+
+/**
+ * @brief Removes the top integer of an integer stack.
+ *
+ * @param stack Pointer to the Stack.
+ * @param out Receives the value (may be NULL).
+ *
+ * @return true if a value was popped, false if the stack is empty or not an
+ * integer stack.
+ */
+bool pop_int(Stack *stack, uint32_t *out);
+
+/**
+ * @brief Reads the top integer of an integer stack without removing it.
+ *
+ * @param stack Pointer to the Stack.
+ * @param out Receives the value.
+ *
+ * @return true if the stack holds a value, false if it is empty or not an
+ * integer stack.
+ */
+bool peek_int(const Stack *stack, uint32_t *out);
+
+/**
+ * @brief Clears all elements from the stack.
+ *
+ * Calls free_func for each element.
+ *
+ * @param stack Pointer to the Stack.
+ */
+void clear(Stack *stack);
+
+/**
+ * @brief Records a checkpoint of the current depth.
+ *
+ * Takes no snapshot: later pushes can be undone with rollback() in
+ * O(pushed since the mark). Marks nest and must be resolved innermost first
+ * with rollback() or commit(). Elements above the innermost open mark may be
+ * popped freely; removing or moving one below it closes all open marks.
+ * drop_oldest stacks do not support marks, since dropping shifts every
+ * element.
+ *
+ * @param stack Pointer to the Stack.
+ *
+ * @return The mark, which rollback() and commit() reject for NULL and
+ * drop_oldest stacks.
+ */
+StackMark mark(Stack *stack);
+
+/**
+ * @brief Discards every element pushed since a mark and closes it.
+ *
+ * The elements above the mark are freed in one batched pass, like clear()
+ * does. Arena stacks also release the arena memory allocated since the mark.
+ *
+ * @param stack Pointer to the Stack.
+ * @param mark Mark returned by mark().
+ *
+ * @return true on success, false if the mark is closed or is not the
+ * innermost open mark. The stack is unchanged on failure.
+ */
+bool rollback(Stack *stack, StackMark mark);
+
+/**
+ * @brief Keeps the elements pushed since a mark and closes it.
+ *
+ * Nothing is freed or copied: the elements join the enclosing mark's scope,
+ * if any, and a later rollback() of that mark still removes them.
+ *
+ * @param stack Pointer to the Stack.
+ * @param mark Mark returned by mark().
+ *
+ * @return true on success, false if the mark is closed or is not the
+ * innermost open mark.
+ */
+bool commit(Stack *stack, StackMark mark);
+
+/**
+ * @brief Checks if the stack is empty.
+ *
+ * @param stack Pointer to the Stack.
+ *
+ * @return true if empty, false otherwise.
+ */
+bool is_empty(const Stack *stack);
+
+/**
+ * @brief Returns the number of elements in the stack.
+ *
+ * @param stack Pointer to the Stack.
+ *
+ * @return Number of elements.
+ */
+size_t size(const Stack *stack);
+
+/**
+ * @brief Returns the internal capacity of the stack.
+ *
+ * @param stack Pointer to the Stack.
+ *
+ * @return Current allocated capacity.
+ */
+size_t capacity(const Stack *stack);
+
+/**
+ * @brief Ensures the stack can hold at least n elements without growing.
+ *
+ * @param stack Pointer to the Stack.
+ * @param n Required capacity.
+ *
+ * @return true on success, false if n exceeds the maximum capacity or on
+ * allocation failure.
+ */
+bool reserve(Stack *stack, size_t n);
+
+/**
+ * @brief Ensures the stack can hold at least n elements, reporting the failure
+ * reason.
+ *
+ * @param stack Pointer to the Stack.
+ * @param n Required capacity.
+ *
+ * @return STACK_OK on success, STACK_ERROR_FULL if n exceeds the maximum
+ * capacity, or STACK_ERROR_NO_MEMORY on allocation failure.
+ */
+StackStatus try_reserve(Stack *stack, size_t n);
+
+/**
+ * @brief Shrinks the internal buffer to the current number of elements.
+ *
+ * Elements that fit in the small buffer are moved back into it.
+ *
+ * @param stack Pointer to the Stack.
+ */
+void shrink_to_fit(Stack *stack);
+
+/**
+ * @brief Writes a file-backed stack to its file.
+ *
+ * Records the current size in the file and waits until all changes reached
+ * the disk.
+ *
+ * @param stack Pointer to the Stack.
+ *
+ * @return true on success, false if the stack is not file-backed or on I/O
+ * failure.
+ */
+bool sync_stack(Stack *stack);
+
+/**
+ * @brief Sets the growth policy used when the stack runs out of space.
+ *
+ * The default policy doubles the capacity with no maximum. Pushes fail with
+ * STACK_ERROR_FULL once the stack holds max_capacity elements, even if the
+ * buffer has room left.
+ *
+ * @param stack Pointer to the Stack.
+ * @param policy New policy, or NULL to restore the default.
+ *
+ * @return true on success, false if the policy has neither a factor > 1 nor a
+ * chunk, if its maximum capacity is below the current size, or for bounded
+ * stacks.
+ */
+bool set_growth_policy(Stack *stack, const StackGrowthPolicy *policy);
+
+/**
+ * @brief Allocates memory from an element arena.
+ *
+ * Intended for StackArenaCopyFunc implementations and for building elements
+ * in place before push_owned(). The memory is aligned for any type and lives
+ * until the owning stack is cleared or freed.
+ *
+ * @param arena Pointer to the StackArena.
+ * @param size Number of bytes to allocate.
+ *
+ * @return Pointer to the memory, or NULL on allocation failure.
+ */
+void *arena_alloc(StackArena *arena, size_t size);
+
+/**
+ * @brief Returns the element arena of a stack.
+ *
+ * @param stack Pointer to the Stack.
+ *
+ * @return Pointer to the arena, or NULL if the stack was not created with an
+ * arena_copy_func.
+ */
+StackArena *get_arena(Stack *stack);
+
+/**
+ * @brief Returns the size of the elements stored by an inline stack.
+ *
+ * @param stack Pointer to the Stack.
+ *
+ * @return Element size in bytes, or 0 for pointer stacks.
+ */
+size_t element_size(const Stack *stack);
+
+/**
+ * @brief Copies the instrumentation counters of the stack.
+ *
+ * @param stack Pointer to the Stack.
+ * @param out Receives the counters.
+ *
+ * @return true on success, false if the library was compiled without
+ * STACK_STATS.
+ */
+bool get_stack_stats(const Stack *stack, StackStats *out);
+
+/**
+ * @brief Resets the instrumentation counters of the stack.
+ *
+ * The high-water mark restarts from the current size.
+ *
+ * @param stack Pointer to the Stack.
+ */
+void reset_stack_stats(Stack *stack);
+
+/**
+ * @brief Installs a callback fired each time the stack buffer grows.
+ *
+ * @param stack Pointer to the Stack.
+ * @param hook Callback, or NULL to remove it.
+ * @param ctx User context passed to hook.
+ *
+ * @return true on success, false if the library was compiled without
+ * STACK_STATS.
+ */
+bool set_growth_hook(Stack *stack, StackGrowthHook hook, void *ctx);
+
+/**
+ * @brief Checks if the stack contains a given element.
+ *
+ * Requires cmp_func to be non-NULL, except on inline stacks where a NULL
+ * cmp_func means bytewise equality. O(1) expected for stacks with a hash
+ * index, a linear scan otherwise.
+ *
+ * @param stack Pointer to the Stack.
+ * @param element Pointer to the element to search for.
+ *
+ * @return true if found, false otherwise.
+ */
+bool contains(const Stack *stack, const void *element);
+
+/**
+ * @brief Finds the topmost element equal to a given element.
+ *
+ * Requires cmp_func to be non-NULL, except on inline stacks where a NULL
+ * cmp_func means bytewise equality, searched with SSE2, AVX2 or NEON when the
+ * element size is a power of two up to the vector width. O(1) expected for
+ * stacks with a hash index, a scan from the top down otherwise.
+ *
+ * @param stack Pointer to the Stack.
+ * @param element Pointer to the element to search for.
+ *
+ * @return Depth of the match (0 for the top element), or SIZE_MAX if no
+ * element is equal.
+ */
+size_t index_of(const Stack *stack, const void *element);
+
+/**
+ * @brief Creates a deep copy of the stack.
+ *
+ * @param stack Pointer to the Stack.
+ *
+ * @return Pointer to a new Stack with copied elements, or NULL on allocation
+ * failure or for move-only stacks.
+ */
+Stack *clone(const Stack *stack);
+
+/**
+ * @brief Reverses the order of elements in the stack.
+ *
+ * @param stack Pointer to the Stack.
+ */
+void reverse(Stack *stack);
+
+/**
+ * @brief Converts the stack to a newly allocated array.
+ *
+ * For inline stacks the result is a single packed array of element_size
+ * bytes per element, which the caller casts to the element type.
+ *
+ * @param stack Pointer to the Stack.
+ * @param out_size Optional pointer to receive the array size.
+ *
+ * @return Pointer to a new array containing all stack elements, or NULL if
+ * the stack is empty or on allocation failure.
  */
 void **to_array(const Stack *stack, size_t *out_size);
 
+/**
+ * @brief Creates a deep copy of the stack, running copy_func on several
+ * threads.
+ *
+ * Each thread copies a contiguous run of elements into a buffer reserved
+ * once, so the result is identical to clone(). copy_func must be safe to call
+ * concurrently. Inline and arena stacks, and small stacks, use clone().
+ *
+ * @param stack Pointer to the Stack.
+ * @param threads Number of threads, or 0 for one per online CPU.
+ *
+ * @return Pointer to a new Stack with copied elements, or NULL on allocation
+ * failure or for move-only stacks.
+ */
+Stack *parallel_clone(const Stack *stack, size_t threads);
+
+/**
+ * @brief Converts the stack to a newly allocated array, running copy_func on
+ * several threads.
+ *
+ * Produces the same array as to_array(). copy_func must be safe to call
+ * concurrently. Inline and small stacks use to_array().
+ *
+ * @param stack Pointer to the Stack.
+ * @param out_size Optional pointer to receive the array size.
+ * @param threads Number of threads, or 0 for one per online CPU.
+ *
+ * @return Pointer to a new array containing all stack elements, or NULL if
+ * the stack is empty or on allocation failure.
+ */
+void **parallel_to_array(const Stack *stack, size_t *out_size, size_t threads);
+
+/**
+ * @brief Removes every element for which pred returns true.
+ *
+ * Compacts the buffer in place in a single pass, keeping the order of the
+ * remaining elements, and frees the removed ones like clear() would.
+ *
+ * @param stack Pointer to the Stack.
+ * @param pred Predicate selecting the elements to remove.
+ * @param ctx User context passed to pred.
+ *
+ * @return Number of elements removed.
+ */
+size_t remove_if(Stack *stack, StackPredicate pred, void *ctx);
+
+/**
+ * @brief Keeps only the elements for which pred returns true.
+ *
+ * @param stack Pointer to the Stack.
+ * @param pred Predicate selecting the elements to keep.
+ * @param ctx User context passed to pred.
+ *
+ * @return Number of elements removed.
+ */
+size_t retain(Stack *stack, StackPredicate pred, void *ctx);
+
+/**
+ * @brief Counts the elements for which pred returns true.
+ *
+ * @param stack Pointer to the Stack.
+ * @param pred Predicate to evaluate.
+ * @param ctx User context passed to pred.
+ *
+ * @return Number of matching elements.
+ */
+size_t count_if(const Stack *stack, StackPredicate pred, void *ctx);
+
+/**
+ * @brief Applies fn to every element in place, from the bottom up.
+ *
+ * Inline stacks pass a pointer to the slot, pointer stacks the element
+ * pointer.
+ *
+ * @param stack Pointer to the Stack.
+ * @param fn Function updating one element.
+ * @param ctx User context passed to fn.
+ */
+void map(Stack *stack, StackMapFunc fn, void *ctx);
+
+/**
+ * @brief Like remove_if(), evaluating pred on several threads.
+ *
+ * pred must be safe to call concurrently; the compaction itself is serial.
+ *
+ * @param stack Pointer to the Stack.
+ * @param pred Predicate selecting the elements to remove.
+ * @param ctx User context passed to pred.
+ * @param threads Number of threads, or 0 for one per online CPU.
+ *
+ * @return Number of elements removed.
+ */
+size_t parallel_remove_if(Stack *stack, StackPredicate pred, void *ctx, size_t threads);
+
+/**
+ * @brief Like count_if(), evaluating pred on several threads.
+ *
+ * @param stack Pointer to the Stack.
+ * @param pred Predicate to evaluate, safe to call concurrently.
+ * @param ctx User context passed to pred.
+ * @param threads Number of threads, or 0 for one per online CPU.
+ *
+ * @return Number of matching elements.
+ */
+size_t parallel_count_if(const Stack *stack, StackPredicate pred, void *ctx, size_t threads);
+
+/**
+ * @brief Like map(), updating contiguous runs of elements on several threads.
+ *
+ * @param stack Pointer to the Stack.
+ * @param fn Function updating one element, safe to call concurrently on
+ * different elements.
+ * @param ctx User context passed to fn.
+ * @param threads Number of threads, or 0 for one per online CPU.
+ */
+void parallel_map(Stack *stack, StackMapFunc fn, void *ctx, size_t threads);
+
+/**
+ * @brief Moves the top k elements of src onto dst, keeping their order.
+ *
+ * Pointers and inline bytes are moved with memcpy; no copy or free function
+ * is called and dst takes over ownership of the elements.
+ *
+ * @param dst Pointer to the destination Stack.
+ * @param src Pointer to the source Stack (same element size, not arena).
+ * @param k Number of elements to move, clamped to the size of src.
+ *
+ * @return STACK_OK on success, or the reason nothing was moved.
+ */
+StackStatus stack_splice(Stack *dst, Stack *src, size_t k);
+
+/**
+ * @brief Moves every element of src onto dst, leaving src empty.
+ *
+ * @param dst Pointer to the destination Stack.
+ * @param src Pointer to the source Stack.
+ *
+ * @return STACK_OK on success, or the reason nothing was moved.
+ */
+StackStatus stack_concat(Stack *dst, Stack *src);
+
+/**
+ * @brief Splits a stack in two at a given index.
+ *
+ * The bottom k elements stay in stack; the rest are moved without copying
+ * into a new stack with the same options.
+ *
+ * @param stack Pointer to the Stack.
+ * @param k Number of elements to keep (must not exceed the size).
+ *
+ * @return Pointer to the new Stack, or NULL for an invalid k, arena stacks
+ * or on allocation failure.
+ */
+Stack *stack_split_at(Stack *stack, size_t k);
+
+/**
+ * @brief Exchanges the contents of two stacks in O(1).
+ *
+ * Buffers, callbacks and options are exchanged; only the small buffers are
+ * copied. Both stacks must use the same allocator, since each header is
+ * released by the allocator of the stack holding it. Open marks of both
+ * stacks are closed.
+ *
+ * @param a Pointer to the first Stack.
+ * @param b Pointer to the second Stack.
+ *
+ * @return true on success, false if the stacks differ in element size,
+ * number of inline slots or allocator (hooks and context).
+ */
+bool swap_stacks(Stack *a, Stack *b);
+
+/**
+ * @brief Returns a borrowed view of the stack elements.
+ *
+ * No memory is allocated and no element is copied.
+ *
+ * @param stack Pointer to the Stack.
+ *
+ * @return View of the live buffer, valid until the next modification. An
+ * empty view for NULL, empty or drop_oldest stacks.
+ */
+StackView view(const Stack *stack);
+
+/**
+ * @brief Returns an iterator from the top element down to the bottom.
+ *
+ * @param stack Pointer to the Stack.
+ *
+ * @return Iterator positioned before the top element.
+ */
+StackIterator iter_top(const Stack *stack);
+
+/**
+ * @brief Returns an iterator from the bottom element up to the top.
+ *
+ * @param stack Pointer to the Stack.
+ *
+ * @return Iterator positioned before the bottom element.
+ */
+StackIterator iter_bottom(const Stack *stack);
+
+/**
+ * @brief Advances an iterator.
+ *
+ * @param it Pointer to the StackIterator.
+ * @param element Receives the next element (the element pointer for pointer
+ * stacks, a pointer to the slot for inline stacks; do not free).
+ *
+ * @return true if an element was produced, false once all were visited.
+ */
+bool iter_next(StackIterator *it, void **element);
+
+/**
+ * @brief Calls visit for each element from the top down.
+ *
+ * The stack must not be modified by visit.
+ *
+ * @param stack Pointer to the Stack.
+ * @param visit Function called with each element.
+ * @param ctx User context passed to visit.
+ *
+ * @return true if every element was visited, false if visit stopped early.
+ */
+bool for_each(const Stack *stack, StackVisitFunc visit, void *ctx);
+
+/**
+ * @brief Serializes the stack through a writer.
+ *
+ * Writes a header (magic, element size, element count) and the elements from
+ * bottom to top. Inline stacks stream their buffer in chunks straight from
+ * the stack; pointer stacks call encode for each element. Integers are
+ * written in native byte order. The stack is not modified.
+ *
+ * @param stack Pointer to the Stack.
+ * @param encode Element encoder (pointer stacks only, ignored for inline
+ * stacks).
+ * @param write Writer receiving the serialized bytes.
+ * @param ctx Writer context.
+ *
+ * @return STACK_OK on success, STACK_ERROR_NULL for missing arguments,
+ * STACK_ERROR_UNSUPPORTED for a pointer stack without encode, or
+ * STACK_ERROR_IO if encode or write fail.
+ */
+StackStatus serialize(const Stack *stack, StackEncodeFunc encode, StackWriteFunc write,
+                      void *ctx);
+
+/**
+ * @brief Deserializes elements from a reader and pushes them onto the stack.
+ *
+ * Reads data produced by serialize(). Inline stacks read straight into their
+ * buffer; pointer stacks take ownership of each element returned by decode.
+ * The element count in the stream is not trusted: the buffer grows in steps
+ * of at most 64 KiB as elements arrive, so a corrupt count fails at the end
+ * of the data instead of reserving memory for it. On failure the stack is
+ * restored to its previous contents and capacity, and arena stacks release
+ * the arena memory decode allocated with arena_alloc(get_arena(stack), ...).
+ *
+ * @param stack Pointer to the Stack.
+ * @param decode Element decoder (pointer stacks only, ignored for inline
+ * stacks).
+ * @param read Reader supplying the serialized bytes.
+ * @param ctx Reader context.
+ *
+ * @return STACK_OK on success, STACK_ERROR_NULL for missing arguments,
+ * STACK_ERROR_UNSUPPORTED for a pointer stack without decode,
+ * STACK_ERROR_FORMAT if the header is invalid or its element size does not
+ * match, STACK_ERROR_FULL or STACK_ERROR_NO_MEMORY if the elements do not
+ * fit, or STACK_ERROR_IO if read or decode fail.
+ */
+StackStatus deserialize(Stack *stack, StackDecodeFunc decode, StackReadFunc read, void *ctx);
+
+/**
+ * @brief Returns the number of bytes serialize() writes for an inline stack.
+ *
+ * @param stack Pointer to the Stack.
+ *
+ * @return Serialized size in bytes, or 0 for pointer stacks, whose size
+ * depends on the encoder.
+ */
+size_t serialized_size(const Stack *stack);
+
+/**
+ * @brief StackWriteFunc writing to a file descriptor.
+ *
+ * Retries short and interrupted writes.
+ *
+ * @param ctx Pointer to an int holding the file descriptor.
+ * @param data Bytes to write.
+ * @param size Number of bytes to write.
+ *
+ * @return true if all bytes were written, false on failure.
+ */
+bool write_fd(void *ctx, const void *data, size_t size);
+
+/**
+ * @brief StackReadFunc reading from a file descriptor.
+ *
+ * Retries short and interrupted reads.
+ *
+ * @param ctx Pointer to an int holding the file descriptor.
+ * @param data Destination buffer.
+ * @param size Number of bytes to read.
+ *
+ * @return true if exactly size bytes were read, false on failure or end of
+ * file.
+ */
+bool read_fd(void *ctx, void *data, size_t size);
+
+/**
+ * @brief StackWriteFunc writing to a StackBuffer.
+ *
+ * @param ctx Pointer to the StackBuffer.
+ * @param data Bytes to write.
+ * @param size Number of bytes to write.
+ *
+ * @return true if the bytes were written, false if the buffer is too small.
+ */
+bool write_buffer(void *ctx, const void *data, size_t size);
+
+/**
+ * @brief StackReadFunc reading from a StackBuffer.
+ *
+ * @param ctx Pointer to the StackBuffer.
+ * @param data Destination buffer.
+ * @param size Number of bytes to read.
+ *
+ * @return true if the bytes were read, false if fewer remain.
+ */
+bool read_buffer(void *ctx, void *data, size_t size);
+
 #endif
@@ -0,0 +1,116 @@
+/**
+ * @file test.h
+ *
+ * @brief Check macro and element and allocator helpers shared by the test
+ * programs.
+ *
+ * Each tests/test_*.c file is a standalone program that links the library
+ * sources and exits with a failure status at the first failed check. The
+ * helpers count their calls in the counters below, one set per program.
+ *
+ * @author trigologiaa
+ */
+
+#ifndef TEST_H
+
+#define TEST_H
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * @brief Aborts the test program with a message if cond is false.
+ */
+#define CHECK(cond)                                                                                \
+  do {                                                                                             \
+    if (!(cond)) {                                                                                 \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);                    \
+      exit(EXIT_FAILURE);                                                                          \
+    }                                                                                              \
+  } while (0)
+
+static atomic_size_t copies; // Elements copied by copy_int().
+static atomic_size_t frees;  // Elements freed by free_int().
+static int copies_left = -1; // Copies copy_int() makes before failing, or -1.
+static size_t allocations;   // Calls to count_alloc() and count_realloc().
+static size_t resizes;       // Calls to count_realloc().
+
+/**
+ * @brief StackCopyFunc duplicating an int into a new heap allocation.
+ *
+ * @param element Pointer to the int to copy.
+ *
+ * @return Pointer to the copy, or NULL once copies_left reaches 0.
+ */
+static inline void *copy_int(const void *element) {
+  if (copies_left == 0) {
+    return NULL;
+  }
+  if (copies_left > 0) {
+    --copies_left;
+  }
+  int *copy = malloc(sizeof(int));
+  if (copy) {
+    *copy = *(const int *)element;
+    atomic_fetch_add(&copies, 1);
+  }
+  return copy;
+}
+
+/**
+ * @brief StackFreeFunc releasing an int made by copy_int().
+ *
+ * @param element Pointer to the int to free.
+ */
+static inline void free_int(void *element) {
+  atomic_fetch_add(&frees, 1);
+  free(element);
+}
+
+/**
+ * @brief StackAllocator alloc_func counting its calls.
+ *
+ * @param ctx Unused.
+ * @param size Number of bytes to allocate.
+ *
+ * @return Pointer to the memory, or NULL on failure.
+ */
+static inline void *count_alloc(void *ctx, size_t size) {
+  (void)ctx;
+  ++allocations;
+  return malloc(size);
+}
+
+/**
+ * @brief StackAllocator realloc_func counting its calls.
+ *
+ * @param ctx Unused.
+ * @param ptr Memory to resize.
+ * @param old_size Unused.
+ * @param new_size New size in bytes.
+ *
+ * @return Pointer to the resized memory, or NULL on failure.
+ */
+static inline void *count_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+  (void)ctx;
+  (void)old_size;
+  ++allocations;
+  ++resizes;
+  return realloc(ptr, new_size);
+}
+
+/**
+ * @brief StackAllocator free_func for count_alloc() and count_realloc().
+ *
+ * @param ctx Unused.
+ * @param ptr Memory to free.
+ * @param size Unused.
+ */
+static inline void count_free(void *ctx, void *ptr, size_t size) {
+  (void)ctx;
+  (void)size;
+  free(ptr);
+}
+
+#endif
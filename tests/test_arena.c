@@ -0,0 +1,154 @@
+/**
+ * @file test_arena.c
+ *
+ * @brief Tests for element arenas and the StackAllocator hooks.
+ */
+
+#include "../stack.h"
+#include "test.h"
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @brief Counting allocator context.
+ */
+typedef struct Heap {
+  size_t live_blocks; // Blocks allocated and not yet released.
+  size_t live_bytes;  // Bytes allocated and not yet released.
+  size_t allocs;      // Calls to alloc_func.
+  size_t fail_after;  // Allocations to allow before failing, or 0.
+} Heap;
+
+static void *heap_alloc(void *ctx, size_t size) {
+  Heap *heap = ctx;
+  if (heap->fail_after && heap->allocs >= heap->fail_after) {
+    return NULL;
+  }
+  ++heap->allocs;
+  ++heap->live_blocks;
+  heap->live_bytes += size;
+  return malloc(size);
+}
+
+static void *heap_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+  Heap *heap = ctx;
+  void *resized = realloc(ptr, new_size);
+  if (resized) {
+    heap->live_bytes += new_size - old_size;
+  }
+  return resized;
+}
+
+static void heap_free(void *ctx, void *ptr, size_t size) {
+  Heap *heap = ctx;
+  CHECK(heap->live_blocks > 0 && heap->live_bytes >= size);
+  --heap->live_blocks;
+  heap->live_bytes -= size;
+  free(ptr);
+}
+
+static void *copy_int_to_arena(const void *element, StackArena *arena) {
+  int *copy = arena_alloc(arena, sizeof(int));
+  if (copy) {
+    *copy = *(const int *)element;
+  }
+  return copy;
+}
+
+static Stack *new_arena_stack(Heap *heap, StackAllocator *allocator) {
+  *allocator = (StackAllocator){heap_alloc, heap_realloc, heap_free, heap};
+  StackOptions options = {0};
+  options.arena_copy_func = copy_int_to_arena;
+  options.free_func = free_int;
+  options.allocator = allocator;
+  return new_stack_with_options(&options);
+}
+
+static void test_arena_copies_are_released_together(void) {
+  Heap heap = {0};
+  StackAllocator allocator;
+  Stack *stack = new_arena_stack(&heap, &allocator);
+  CHECK(stack && get_arena(stack));
+  int first = 0;
+  CHECK(push(stack, &first));
+  size_t one_chunk_blocks = heap.live_blocks;
+  for (int i = 1; i < 20000; ++i) {
+    CHECK(push(stack, &i));
+  }
+  CHECK(heap.live_blocks > one_chunk_blocks);
+  int *top = pop(stack);
+  CHECK(top && *top == 19999);
+  CHECK(*(int *)peek(stack) == 19998);
+  clear(stack);
+  CHECK(frees == 0 && size(stack) == 0);
+  CHECK(heap.live_blocks == one_chunk_blocks);
+  int value = 7;
+  CHECK(push(stack, &value) && *(int *)peek(stack) == 7);
+  free_stack(stack);
+  CHECK(frees == 0 && heap.live_blocks == 0 && heap.live_bytes == 0);
+}
+
+static void test_arena_alloc(void) {
+  Heap heap = {0};
+  StackAllocator allocator;
+  Stack *stack = new_arena_stack(&heap, &allocator);
+  StackArena *arena = get_arena(stack);
+  CHECK(arena_alloc(NULL, 8) == NULL);
+  CHECK(arena_alloc(arena, SIZE_MAX) == NULL);
+  for (size_t request = 0; request < 100; ++request) {
+    void *memory = arena_alloc(arena, request);
+    CHECK(memory && (uintptr_t)memory % _Alignof(max_align_t) == 0);
+    memset(memory, 0xab, request);
+  }
+  unsigned char *large = arena_alloc(arena, 1 << 20);
+  CHECK(large);
+  memset(large, 0xcd, 1 << 20);
+  int *owned = arena_alloc(arena, sizeof(int));
+  *owned = 5;
+  CHECK(push_owned(stack, owned) && peek(stack) == owned);
+  free_stack(stack);
+  CHECK(frees == 0 && heap.live_blocks == 0 && heap.live_bytes == 0);
+}
+
+static void test_allocator_hooks(void) {
+  Heap heap = {0};
+  StackAllocator allocator = {heap_alloc, heap_realloc, heap_free, &heap};
+  StackOptions options = {0};
+  options.element_size = sizeof(int);
+  options.allocator = &allocator;
+  Stack *stack = new_stack_with_options(&options);
+  CHECK(stack && get_arena(stack) == NULL);
+  for (int i = 0; i < 10000; ++i) {
+    CHECK(push(stack, &i));
+  }
+  shrink_to_fit(stack);
+  free_stack(stack);
+  CHECK(heap.live_blocks == 0 && heap.live_bytes == 0);
+  heap.fail_after = heap.allocs;
+  CHECK(new_stack_with_options(&options) == NULL);
+  CHECK(heap.live_blocks == 0);
+}
+
+static void test_invalid_options(void) {
+  StackOptions options = {0};
+  options.element_size = sizeof(int);
+  options.arena_copy_func = copy_int_to_arena;
+  CHECK(new_stack_with_options(&options) == NULL);
+  Heap heap = {0};
+  StackAllocator allocator = {heap_alloc, NULL, heap_free, &heap};
+  options = (StackOptions){0};
+  options.allocator = &allocator;
+  CHECK(new_stack_with_options(&options) == NULL);
+  CHECK(heap.allocs == 0);
+  Stack *stack = new_stack(NULL, NULL, NULL);
+  CHECK(get_arena(stack) == NULL && get_arena(NULL) == NULL);
+  free_stack(stack);
+}
+
+int main(void) {
+  test_arena_copies_are_released_together();
+  test_arena_alloc();
+  test_allocator_hooks();
+  test_invalid_options();
+  return EXIT_SUCCESS;
+}
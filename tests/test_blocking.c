@@ -0,0 +1,151 @@
+/**
+ * @file test_blocking.c
+ *
+ * @brief Tests for the bounded blocking stack.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "../blocking_stack.h"
+#include "test.h"
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+
+#define PRODUCERS 4
+#define CONSUMERS 4
+#define PER_PRODUCER 10000
+
+/**
+ * @brief Work done by one consumer thread.
+ */
+typedef struct Consumer {
+  BlockingStack *stack; // Stack shared by all threads.
+  long long sum;        // Sum of the values popped.
+  size_t pops;          // Number of values popped.
+} Consumer;
+
+static long elapsed_ms(const struct timespec *start) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start->tv_sec) * 1000 + (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+static void *produce(void *arg) {
+  BlockingStack *stack = arg;
+  for (int i = 1; i <= PER_PRODUCER; ++i) {
+    CHECK(blocking_push(stack, &i, BLOCKING_STACK_FOREVER));
+  }
+  return NULL;
+}
+
+static void *consume(void *arg) {
+  Consumer *consumer = arg;
+  int value;
+  while (blocking_pop(consumer->stack, &value, BLOCKING_STACK_FOREVER)) {
+    consumer->sum += value;
+    ++consumer->pops;
+  }
+  return NULL;
+}
+
+static void *pop_forever(void *arg) {
+  int value;
+  return blocking_pop(arg, &value, BLOCKING_STACK_FOREVER) ? arg : NULL;
+}
+
+static void test_timeouts(void) {
+  BlockingStack *stack = new_blocking_stack(sizeof(int), 2);
+  int value = 1;
+  CHECK(blocking_try_push(stack, &value) && blocking_try_push(stack, &value));
+  CHECK(!blocking_try_push(stack, &value) && blocking_size(stack) == 2);
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  CHECK(!blocking_push(stack, &value, 50));
+  CHECK(elapsed_ms(&start) >= 40);
+  CHECK(blocking_try_pop(stack, &value) && blocking_try_pop(stack, &value));
+  CHECK(!blocking_try_pop(stack, &value));
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  CHECK(!blocking_pop(stack, &value, 50));
+  CHECK(elapsed_ms(&start) >= 40);
+  free_blocking_stack(stack);
+  CHECK(new_blocking_stack(0, 2) == NULL);
+}
+
+static void test_close(void) {
+  BlockingStack *stack = new_blocking_stack(sizeof(int), 0);
+  pthread_t waiter;
+  CHECK(pthread_create(&waiter, NULL, pop_forever, stack) == 0);
+  nanosleep(&(struct timespec){0, 20000000L}, NULL);
+  blocking_close(stack);
+  void *result;
+  pthread_join(waiter, &result);
+  CHECK(result == NULL);
+  int value = 1;
+  CHECK(!blocking_push(stack, &value, BLOCKING_STACK_FOREVER));
+  free_blocking_stack(stack);
+  stack = new_blocking_stack(sizeof(int), 0);
+  CHECK(blocking_push(stack, &value, 0));
+  blocking_close(stack);
+  CHECK(blocking_pop(stack, &value, BLOCKING_STACK_FOREVER) && value == 1);
+  CHECK(!blocking_pop(stack, &value, BLOCKING_STACK_FOREVER));
+  free_blocking_stack(stack);
+}
+
+static void test_producers_and_consumers(void) {
+  BlockingStack *stack = new_blocking_stack(sizeof(int), 16);
+  pthread_t producers[PRODUCERS];
+  pthread_t consumers[CONSUMERS];
+  Consumer state[CONSUMERS];
+  for (int i = 0; i < CONSUMERS; ++i) {
+    state[i] = (Consumer){stack, 0, 0};
+    CHECK(pthread_create(&consumers[i], NULL, consume, &state[i]) == 0);
+  }
+  for (int i = 0; i < PRODUCERS; ++i) {
+    CHECK(pthread_create(&producers[i], NULL, produce, stack) == 0);
+  }
+  for (int i = 0; i < PRODUCERS; ++i) {
+    pthread_join(producers[i], NULL);
+  }
+  blocking_close(stack);
+  long long sum = 0;
+  size_t pops = 0;
+  for (int i = 0; i < CONSUMERS; ++i) {
+    pthread_join(consumers[i], NULL);
+    sum += state[i].sum;
+    pops += state[i].pops;
+  }
+  CHECK(pops == (size_t)PRODUCERS * PER_PRODUCER);
+  CHECK(sum == (long long)PRODUCERS * PER_PRODUCER * (PER_PRODUCER + 1) / 2);
+  CHECK(blocking_size(stack) == 0);
+  free_blocking_stack(stack);
+}
+
+static void test_event_fd(void) {
+  BlockingStack *stack = new_blocking_stack(sizeof(int), 0);
+  int value = 1;
+  CHECK(blocking_push(stack, &value, 0));
+  int fd = blocking_event_fd(stack);
+#if defined(__linux__)
+  CHECK(fd >= 0 && blocking_event_fd(stack) == fd);
+  struct pollfd poller = {fd, POLLIN, 0};
+  CHECK(poll(&poller, 1, 0) == 1);
+  CHECK(blocking_push(stack, &value, 0) && blocking_try_pop(stack, &value));
+  CHECK(poll(&poller, 1, 0) == 1);
+  CHECK(blocking_try_pop(stack, &value));
+  CHECK(poll(&poller, 1, 0) == 0);
+  CHECK(blocking_push(stack, &value, 0) && poll(&poller, 1, 0) == 1);
+#else
+  CHECK(fd == -1);
+#endif
+  free_blocking_stack(stack);
+  CHECK(blocking_event_fd(NULL) == -1);
+}
+
+int main(void) {
+  test_timeouts();
+  test_close();
+  test_producers_and_consumers();
+  test_event_fd();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,199 @@
+/**
+ * @file test_bounded.c
+ *
+ * @brief Tests for bounded stacks, with and without drop_oldest.
+ */
+
+#include "../stack.h"
+#include "test.h"
+#include <string.h>
+
+static size_t batches;
+
+static void free_ints(void **elements, size_t count) {
+  ++batches;
+  for (size_t i = 0; i < count; ++i) {
+    free_int(elements[i]);
+  }
+}
+
+static bool is_even(const void *element, void *ctx) {
+  (void)ctx;
+  return *(const int *)element % 2 == 0;
+}
+
+static void test_rejecting_bound(void) {
+  Stack *stack = new_bounded_stack(3, false, copy_int, free_int, NULL);
+  for (int i = 0; i < 3; ++i) {
+    CHECK(try_push(stack, &i) == STACK_OK);
+  }
+  int value = 3;
+  CHECK(try_push(stack, &value) == STACK_ERROR_FULL);
+  CHECK(size(stack) == 3 && capacity(stack) == 3);
+  StackGrowthPolicy policy = {2.0, 0, 0};
+  CHECK(!set_growth_policy(stack, &policy));
+  free_stack(stack);
+  CHECK(new_bounded_stack(0, false, NULL, NULL, NULL) == NULL);
+}
+
+static void test_ring_eviction(void) {
+  const int bound = 5;
+  frees = 0;
+  Stack *stack = new_bounded_stack((size_t)bound, true, copy_int, free_int, NULL);
+  for (int i = 0; i < 1000; ++i) {
+    CHECK(push(stack, &i));
+    CHECK(size(stack) == (size_t)(i < bound ? i + 1 : bound));
+    StackIterator it = iter_bottom(stack);
+    void *element;
+    for (int expected = i - (int)size(stack) + 1; iter_next(&it, &element); ++expected) {
+      CHECK(*(int *)element == expected);
+    }
+  }
+  CHECK(view(stack).data == NULL && view(stack).size == 0);
+  CHECK(frees == 1000 - (size_t)bound);
+  int *top = pop(stack);
+  CHECK(*top == 999);
+  free(top);
+  int value = 7;
+  CHECK(push(stack, &value) && *(int *)peek(stack) == 7);
+  clear(stack);
+  CHECK(size(stack) == 0 && frees == 1000);
+  free_stack(stack);
+}
+
+static void test_inline_ring_never_allocates(void) {
+  StackAllocator allocator = {count_alloc, count_realloc, count_free, NULL};
+  StackOptions options = {0};
+  options.element_size = sizeof(long);
+  options.bound = 64;
+  options.drop_oldest = true;
+  options.allocator = &allocator;
+  Stack *stack = new_stack_with_options(&options);
+  size_t after_creation = allocations;
+  for (long i = 0; i < 100000; ++i) {
+    CHECK(try_push(stack, &i) == STACK_OK);
+  }
+  CHECK(allocations == after_creation);
+  long values[100];
+  for (long i = 0; i < 100; ++i) {
+    values[i] = 100000 + i;
+  }
+  CHECK(push_n(stack, values, 100) == 100 && size(stack) == 64);
+  long out[64];
+  CHECK(pop_n(stack, out, 64) == 64);
+  for (long i = 0; i < 64; ++i) {
+    CHECK(out[i] == 100036 + i);
+  }
+  free_stack(stack);
+}
+
+static void check_ring(const Stack *stack, long first) {
+  size_t count = 0;
+  long *array = (long *)to_array(stack, &count);
+  CHECK(array && count == size(stack));
+  for (size_t i = 0; i < count; ++i) {
+    CHECK(array[i] == first + (long)i);
+  }
+  free(array);
+}
+
+static void test_wrapped_ring_operations(void) {
+  StackOptions options = {0};
+  options.element_size = sizeof(long);
+  options.bound = 7;
+  options.drop_oldest = true;
+  Stack *stack = new_stack_with_options(&options);
+  for (long i = 0; i < 30; ++i) {
+    CHECK(push(stack, &i));
+  }
+  check_ring(stack, 23);
+  long key = 24;
+  CHECK(contains(stack, &key) && index_of(stack, &key) == 5);
+  key = 29;
+  CHECK(index_of(stack, &key) == 0);
+  key = 22;
+  CHECK(!contains(stack, &key));
+  Stack *copy = clone(stack);
+  check_ring(copy, 23);
+  long values[8];
+  unsigned char buffer[256];
+  StackBuffer writer = {buffer, sizeof(buffer), 0};
+  CHECK(serialize(stack, NULL, write_buffer, &writer) == STACK_OK);
+  for (long i = 0; i < 8; ++i) {
+    CHECK(push(copy, &i));
+  }
+  CHECK(pop_n(copy, values, 7) == 7 && values[0] == 1 && values[6] == 7);
+  StackBuffer reader = {buffer, writer.pos, 0};
+  CHECK(deserialize(copy, NULL, read_buffer, &reader) == STACK_OK);
+  check_ring(copy, 23);
+  free_stack(copy);
+  Stack *top = stack_split_at(stack, 2);
+  CHECK(top && size(stack) == 2 && size(top) == 5);
+  check_ring(stack, 23);
+  check_ring(top, 25);
+  for (long i = 30; i < 34; ++i) {
+    CHECK(push(stack, &i));
+  }
+  CHECK(push_n(top, (long[]){50, 51, 52}, 3) == 3 && pop_n(top, values, 4) == 4);
+  CHECK(stack_splice(top, stack, 5) == STACK_ERROR_FULL);
+  CHECK(stack_splice(top, stack, 4) == STACK_OK && size(stack) == 2);
+  long expected[] = {26, 27, 28, 30, 31, 32, 33};
+  size_t count = 0;
+  long *array = (long *)to_array(top, &count);
+  CHECK(array && count == 7 && memcmp(array, expected, sizeof(expected)) == 0);
+  free(array);
+  reverse(top);
+  CHECK(*(long *)peek(top) == 26);
+  free_stack(top);
+  free_stack(stack);
+}
+
+static void test_wrapped_pointer_ring(void) {
+  frees = 0;
+  Stack *stack = new_bounded_stack(6, true, copy_int, free_int, NULL);
+  for (int i = 0; i < 20; ++i) {
+    CHECK(push(stack, &i));
+  }
+  CHECK(frees == 14);
+  CHECK(remove_if(stack, is_even, NULL) == 3 && size(stack) == 3 && frees == 17);
+  int expected[] = {15, 17, 19};
+  StackIterator it = iter_bottom(stack);
+  void *element;
+  for (size_t i = 0; iter_next(&it, &element); ++i) {
+    CHECK(*(int *)element == expected[i]);
+  }
+  for (int i = 20; i < 26; ++i) {
+    CHECK(push(stack, &i));
+  }
+  reverse(stack);
+  CHECK(*(int *)peek(stack) == 20);
+  free_stack(stack);
+  CHECK(frees == 26);
+}
+
+static void test_wrapped_batch_free(void) {
+  StackOptions options = {0};
+  options.copy_func = copy_int;
+  options.batch_free_func = free_ints;
+  options.bound = 4;
+  options.drop_oldest = true;
+  Stack *stack = new_stack_with_options(&options);
+  frees = 0;
+  for (int i = 0; i < 6; ++i) {
+    CHECK(push(stack, &i));
+  }
+  CHECK(frees == 2 && batches == 2);
+  clear(stack);
+  CHECK(frees == 6 && batches == 4);
+  free_stack(stack);
+}
+
+int main(void) {
+  test_rejecting_bound();
+  test_ring_eviction();
+  test_inline_ring_never_allocates();
+  test_wrapped_ring_operations();
+  test_wrapped_pointer_ring();
+  test_wrapped_batch_free();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,90 @@
+/**
+ * @file test_bulk_ops.c
+ *
+ * @brief Tests for remove_if(), retain(), count_if(), map() and their
+ * parallel variants.
+ */
+
+#include "../stack.h"
+#include "test.h"
+#include <stdatomic.h>
+
+#define LARGE 50000
+
+static bool is_multiple(const void *element, void *ctx) {
+  return *(const int *)element % *(const int *)ctx == 0;
+}
+
+static void add(void *element, void *ctx) {
+  *(int *)element += *(const int *)ctx;
+}
+
+static Stack *new_filled_stack(bool inline_elements, int count) {
+  Stack *stack = inline_elements ? new_inline_stack(sizeof(int), NULL)
+                                 : new_stack(copy_int, free_int, NULL);
+  for (int i = 0; i < count; ++i) {
+    CHECK(push(stack, &i));
+  }
+  return stack;
+}
+
+static void check_values(const Stack *stack, int first, int step) {
+  StackIterator it = iter_bottom(stack);
+  void *element;
+  for (int expected = first; iter_next(&it, &element); expected += step) {
+    CHECK(*(int *)element == expected);
+  }
+}
+
+static void test_serial_operations(bool inline_elements) {
+  Stack *stack = new_filled_stack(inline_elements, 100);
+  int three = 3;
+  int two = 2;
+  atomic_store(&frees, 0);
+  CHECK(count_if(stack, is_multiple, &three) == 34);
+  CHECK(remove_if(stack, is_multiple, &two) == 50 && size(stack) == 50);
+  check_values(stack, 1, 2);
+  CHECK(inline_elements || atomic_load(&frees) == 50);
+  CHECK(retain(stack, is_multiple, &three) == 33 && size(stack) == 17);
+  check_values(stack, 3, 6);
+  int ten = 10;
+  map(stack, add, &ten);
+  check_values(stack, 13, 6);
+  CHECK(*(int *)peek(stack) == 13 + 16 * 6);
+  CHECK(remove_if(stack, is_multiple, &(int){1}) == 17 && is_empty(stack));
+  CHECK(remove_if(NULL, is_multiple, &two) == 0 && count_if(NULL, is_multiple, &two) == 0);
+  free_stack(stack);
+}
+
+static void test_parallel_matches_serial(bool inline_elements) {
+  Stack *serial = new_filled_stack(inline_elements, LARGE);
+  Stack *parallel = new_filled_stack(inline_elements, LARGE);
+  int seven = 7;
+  int five = 5;
+  for (size_t threads = 0; threads <= 5; threads += 5) {
+    CHECK(parallel_count_if(parallel, is_multiple, &seven, threads) ==
+          count_if(serial, is_multiple, &seven));
+  }
+  parallel_map(parallel, add, &five, 4);
+  map(serial, add, &five);
+  CHECK(parallel_remove_if(parallel, is_multiple, &seven, 4) ==
+        remove_if(serial, is_multiple, &seven));
+  CHECK(size(parallel) == size(serial));
+  StackIterator a = iter_bottom(parallel);
+  StackIterator b = iter_bottom(serial);
+  void *x;
+  void *y;
+  while (iter_next(&a, &x)) {
+    CHECK(iter_next(&b, &y) && *(int *)x == *(int *)y);
+  }
+  free_stack(parallel);
+  free_stack(serial);
+}
+
+int main(void) {
+  test_serial_operations(false);
+  test_serial_operations(true);
+  test_parallel_matches_serial(false);
+  test_parallel_matches_serial(true);
+  return EXIT_SUCCESS;
+}
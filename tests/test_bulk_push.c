@@ -0,0 +1,61 @@
+/**
+ * @file test_bulk_push.c
+ *
+ * @brief Tests for push_n() and pop_n().
+ */
+
+#include "../stack.h"
+#include "test.h"
+
+static void test_inline_round_trip(void) {
+  StackAllocator allocator = {count_alloc, count_realloc, count_free, NULL};
+  StackOptions options = {0};
+  options.element_size = sizeof(int);
+  options.allocator = &allocator;
+  Stack *stack = new_stack_with_options(&options);
+  int values[10000];
+  for (int i = 0; i < 10000; ++i) {
+    values[i] = i;
+  }
+  CHECK(push_n(stack, values, 10) == 10);
+  resizes = 0;
+  CHECK(push_n(stack, values, 10000) == 10000);
+  CHECK(resizes <= 1 && size(stack) == 10010);
+  int out[10010];
+  CHECK(pop_n(stack, out, 10000) == 10000);
+  for (int i = 0; i < 10000; ++i) {
+    CHECK(out[i] == i);
+  }
+  CHECK(push_n(stack, out, 10000) == 10000 && *(int *)peek(stack) == 9999);
+  CHECK(pop_n(stack, out, 20000) == 10010 && is_empty(stack));
+  CHECK(pop_n(stack, out, 1) == 0 && push_n(stack, values, 0) == 0);
+  free_stack(stack);
+}
+
+static void test_pointer_copies_each_element(void) {
+  Stack *stack = new_stack(copy_int, free, NULL);
+  int values[5] = {1, 2, 3, 4, 5};
+  const void *pointers[5];
+  for (int i = 0; i < 5; ++i) {
+    pointers[i] = &values[i];
+  }
+  CHECK(push_n(stack, pointers, 5) == 5);
+  values[4] = 50;
+  CHECK(*(int *)peek(stack) == 5);
+  copies_left = 2;
+  CHECK(push_n(stack, pointers, 5) == 2 && size(stack) == 7);
+  copies_left = -1;
+  void *out[7];
+  CHECK(pop_n(stack, out, 7) == 7);
+  CHECK(*(int *)out[0] == 1 && *(int *)out[6] == 2);
+  for (int i = 0; i < 7; ++i) {
+    free(out[i]);
+  }
+  free_stack(stack);
+}
+
+int main(void) {
+  test_inline_round_trip();
+  test_pointer_copies_each_element();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,119 @@
+/**
+ * @file test_concurrent.c
+ *
+ * @brief Tests for the lock-free concurrent stack.
+ */
+
+#include "../concurrent_stack.h"
+#include "test.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define THREADS 8
+#define PER_THREAD 20000
+
+static atomic_int running;
+static atomic_int seen[THREADS * PER_THREAD];
+
+static void *churn(void *arg) {
+  ConcurrentStack *stack = arg;
+  static atomic_int next_id;
+  int id = atomic_fetch_add(&next_id, 1);
+  for (int i = 0; i < PER_THREAD; ++i) {
+    int value = id * PER_THREAD + i;
+    CHECK(concurrent_push(stack, &value));
+    if (i % 2) {
+      int *popped = concurrent_pop(stack);
+      CHECK(popped);
+      CHECK(atomic_fetch_add(&seen[*popped], 1) == 0);
+      free(popped);
+    }
+  }
+  return NULL;
+}
+
+static void *push_pop(void *arg) {
+  ConcurrentStack *stack = arg;
+  int value = 1;
+  for (int i = 0; i < PER_THREAD * 10; ++i) {
+    CHECK(concurrent_push(stack, &value));
+    free(concurrent_pop(stack));
+  }
+  atomic_fetch_sub(&running, 1);
+  return NULL;
+}
+
+static void test_single_thread_lifo(void) {
+  ConcurrentStack *stack = new_concurrent_stack(copy_int, free_int);
+  CHECK(concurrent_is_empty(stack) && concurrent_pop(stack) == NULL);
+  for (int i = 0; i < 100; ++i) {
+    CHECK(concurrent_push(stack, &i));
+  }
+  CHECK(concurrent_size(stack) == 100 && !concurrent_is_empty(stack));
+  for (int i = 99; i >= 50; --i) {
+    int *popped = concurrent_pop(stack);
+    CHECK(popped && *popped == i);
+    free(popped);
+  }
+  free_concurrent_stack(stack);
+  CHECK(atomic_load(&frees) == 50);
+}
+
+static void test_move_only(void) {
+  ConcurrentStack *stack = new_concurrent_stack(NULL, free_int);
+  int value = 1;
+  CHECK(!concurrent_push(stack, &value));
+  int *owned = malloc(sizeof(int));
+  *owned = 2;
+  CHECK(concurrent_push_owned(stack, owned));
+  CHECK(concurrent_pop(stack) == owned && concurrent_size(stack) == 0);
+  free(owned);
+  free_concurrent_stack(stack);
+  free_concurrent_stack(NULL);
+}
+
+static void test_threads_pop_each_element_once(void) {
+  ConcurrentStack *stack = new_concurrent_stack(copy_int, free_int);
+  pthread_t threads[THREADS];
+  for (int i = 0; i < THREADS; ++i) {
+    CHECK(pthread_create(&threads[i], NULL, churn, stack) == 0);
+  }
+  for (int i = 0; i < THREADS; ++i) {
+    pthread_join(threads[i], NULL);
+  }
+  CHECK(concurrent_size(stack) == (size_t)THREADS * PER_THREAD / 2);
+  int *popped;
+  while ((popped = concurrent_pop(stack))) {
+    CHECK(atomic_fetch_add(&seen[*popped], 1) == 0);
+    free(popped);
+  }
+  for (int i = 0; i < THREADS * PER_THREAD; ++i) {
+    CHECK(atomic_load(&seen[i]) == 1);
+  }
+  free_concurrent_stack(stack);
+}
+
+static void test_size_never_wraps(void) {
+  ConcurrentStack *stack = new_concurrent_stack(copy_int, free_int);
+  pthread_t threads[THREADS];
+  atomic_store(&running, THREADS);
+  for (int i = 0; i < THREADS; ++i) {
+    CHECK(pthread_create(&threads[i], NULL, push_pop, stack) == 0);
+  }
+  while (atomic_load(&running) > 0) {
+    CHECK(concurrent_size(stack) <= THREADS);
+  }
+  for (int i = 0; i < THREADS; ++i) {
+    pthread_join(threads[i], NULL);
+  }
+  CHECK(concurrent_size(stack) == 0 && concurrent_is_empty(stack));
+  free_concurrent_stack(stack);
+}
+
+int main(void) {
+  test_single_thread_lifo();
+  test_move_only();
+  test_threads_pop_each_element_once();
+  test_size_never_wraps();
+  return EXIT_SUCCESS;
+}
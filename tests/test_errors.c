@@ -0,0 +1,110 @@
+/**
+ * @file test_errors.c
+ *
+ * @brief Tests for the status-returning paths under allocation failure.
+ */
+
+#include "../stack.h"
+#include "test.h"
+#include <stdint.h>
+
+static int allocations_left = -1;
+
+static bool take_allocation(void) {
+  if (allocations_left == 0) {
+    return false;
+  }
+  if (allocations_left > 0) {
+    --allocations_left;
+  }
+  return true;
+}
+
+static void *failing_alloc(void *ctx, size_t size) {
+  (void)ctx;
+  return take_allocation() ? malloc(size) : NULL;
+}
+
+static void *failing_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+  (void)ctx;
+  (void)old_size;
+  return take_allocation() ? realloc(ptr, new_size) : NULL;
+}
+
+static void plain_free(void *ctx, void *ptr, size_t size) {
+  (void)ctx;
+  (void)size;
+  free(ptr);
+}
+
+static void test_growth_failure_leaves_stack_intact(void) {
+  StackAllocator allocator = {failing_alloc, failing_realloc, plain_free, NULL};
+  StackOptions options = {0};
+  options.element_size = sizeof(int);
+  options.allocator = &allocator;
+  Stack *stack = new_stack_with_options(&options);
+  CHECK(stack);
+  int i = 0;
+  while (try_push(stack, &i) == STACK_OK && i < 100) {
+    ++i;
+  }
+  size_t full = size(stack);
+  allocations_left = 0;
+  StackStatus status = STACK_OK;
+  for (int j = 0; j < 1000 && status == STACK_OK; ++j) {
+    status = try_push(stack, &j);
+  }
+  CHECK(status == STACK_ERROR_NO_MEMORY);
+  CHECK(size(stack) >= full && size(stack) == capacity(stack));
+  CHECK(!reserve(stack, capacity(stack) + 1));
+  CHECK(try_reserve(stack, capacity(stack) + 1) == STACK_ERROR_NO_MEMORY);
+  allocations_left = -1;
+  CHECK(try_push(stack, &i) == STACK_OK);
+  free_stack(stack);
+  allocations_left = 0;
+  CHECK(new_stack_with_options(&options) == NULL);
+  allocations_left = -1;
+}
+
+static void test_overflowing_reserve(void) {
+  Stack *stack = new_inline_stack(sizeof(int), NULL);
+  int value = 1;
+  CHECK(try_push(stack, &value) == STACK_OK);
+  CHECK(try_reserve(stack, SIZE_MAX) == STACK_ERROR_NO_MEMORY && !reserve(stack, SIZE_MAX));
+  CHECK(size(stack) == 1 && *(int *)peek(stack) == 1);
+  CHECK(try_push(stack, &value) == STACK_OK && size(stack) == 2);
+  free_stack(stack);
+}
+
+static void test_copy_failure(void) {
+  Stack *stack = new_stack(copy_int, free, NULL);
+  int value = 1;
+  CHECK(try_push(stack, &value) == STACK_OK);
+  copies_left = 0;
+  CHECK(try_push(stack, &value) == STACK_ERROR_NO_MEMORY);
+  CHECK(!push(stack, &value) && size(stack) == 1);
+  copies_left = -1;
+  free_stack(stack);
+}
+
+static void test_argument_errors(void) {
+  int value = 1;
+  CHECK(try_push(NULL, &value) == STACK_ERROR_NULL);
+  CHECK(try_reserve(NULL, 1) == STACK_ERROR_NULL);
+  Stack *move_only = new_stack(NULL, free, NULL);
+  CHECK(try_push(move_only, &value) == STACK_ERROR_UNSUPPORTED);
+  free_stack(move_only);
+  StackOptions options = {0};
+  options.element_size = sizeof(int);
+  options.drop_oldest = true;
+  CHECK(new_stack_with_options(&options) == NULL);
+  CHECK(new_stack_with_options(NULL) == NULL);
+}
+
+int main(void) {
+  test_growth_failure_leaves_stack_intact();
+  test_overflowing_reserve();
+  test_copy_failure();
+  test_argument_errors();
+  return EXIT_SUCCESS;
+}
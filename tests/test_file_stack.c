@@ -0,0 +1,68 @@
+/**
+ * @file test_file_stack.c
+ *
+ * @brief Tests for stacks backed by a memory-mapped file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "../stack.h"
+#include "test.h"
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static off_t file_size(const char *path) {
+  struct stat st;
+  CHECK(stat(path, &st) == 0);
+  return st.st_size;
+}
+
+static void test_reopen_keeps_contents(const char *path) {
+  Stack *stack = open_file_stack(path, sizeof(long), NULL);
+  CHECK(stack && size(stack) == 0);
+  for (long i = 0; i < 100000; ++i) {
+    CHECK(push(stack, &i));
+  }
+  CHECK(sync_stack(stack));
+  free_stack(stack);
+  CHECK(open_file_stack(path, sizeof(int), NULL) == NULL);
+  stack = open_file_stack(path, sizeof(long), NULL);
+  CHECK(stack && size(stack) == 100000);
+  CHECK(*(long *)peek(stack) == 99999);
+  StackView elements = view(stack);
+  CHECK(((const long *)elements.data)[12345] == 12345);
+  long out;
+  CHECK(pop_into(stack, &out) && out == 99999);
+  free_stack(stack);
+  stack = open_file_stack(path, sizeof(long), NULL);
+  CHECK(stack && size(stack) == 99999);
+  free_stack(stack);
+}
+
+static void test_shrink_truncates_file(const char *path) {
+  Stack *stack = open_file_stack(path, sizeof(long), NULL);
+  CHECK(stack);
+  off_t grown = file_size(path);
+  long out;
+  while (size(stack) > 10) {
+    pop_into(stack, &out);
+  }
+  shrink_to_fit(stack);
+  CHECK(capacity(stack) == 10);
+  CHECK(file_size(path) < grown);
+  CHECK(*(long *)peek(stack) == 9);
+  free_stack(stack);
+}
+
+int main(void) {
+  char path[] = "/tmp/stack_test_XXXXXX";
+  int fd = mkstemp(path);
+  CHECK(fd >= 0);
+  close(fd);
+  CHECK(unlink(path) == 0);
+  test_reopen_keeps_contents(path);
+  test_shrink_truncates_file(path);
+  CHECK(unlink(path) == 0);
+  return EXIT_SUCCESS;
+}
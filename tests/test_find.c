@@ -0,0 +1,73 @@
+/**
+ * @file test_find.c
+ *
+ * @brief Tests for the bytewise (vectorized) search of inline stacks.
+ */
+
+#include "../stack.h"
+#include "test.h"
+#include <stdint.h>
+#include <string.h>
+
+#define MAX_ELEMENT 40
+#define MAX_LENGTH 100
+
+static size_t naive_index_of(const unsigned char *elements, size_t count, size_t elem_size,
+                             const unsigned char *key) {
+  for (size_t depth = 0; depth < count; ++depth) {
+    if (memcmp(elements + (count - 1 - depth) * elem_size, key, elem_size) == 0) {
+      return depth;
+    }
+  }
+  return SIZE_MAX;
+}
+
+static void check_element_size(size_t elem_size) {
+  static unsigned char elements[MAX_LENGTH * MAX_ELEMENT];
+  unsigned char key[MAX_ELEMENT];
+  for (size_t length = 0; length <= MAX_LENGTH; length += length < 40 ? 1 : 13) {
+    Stack *stack = new_inline_stack(elem_size, NULL);
+    for (size_t i = 0; i < length * elem_size; ++i) {
+      elements[i] = (unsigned char)(i * 7 + elem_size);
+    }
+    CHECK(push_n(stack, elements, length) == length);
+    for (size_t target = 0; target < length; ++target) {
+      memcpy(key, elements + target * elem_size, elem_size);
+      size_t expected = naive_index_of(elements, length, elem_size, key);
+      CHECK(expected != SIZE_MAX && index_of(stack, key) == expected);
+      CHECK(contains(stack, key));
+      key[elem_size - 1] ^= 0x80;
+      CHECK(index_of(stack, key) == naive_index_of(elements, length, elem_size, key));
+    }
+    memset(key, 0xff, elem_size);
+    CHECK(index_of(stack, key) == naive_index_of(elements, length, elem_size, key));
+    free_stack(stack);
+  }
+}
+
+static void test_all_element_sizes(void) {
+  size_t sizes[] = {1, 2, 3, 4, 8, 12, 16, 32, 40};
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+    check_element_size(sizes[i]);
+  }
+}
+
+static void test_topmost_duplicate(void) {
+  Stack *stack = new_inline_stack(sizeof(uint16_t), NULL);
+  for (uint16_t i = 0; i < 1000; ++i) {
+    uint16_t value = i % 10;
+    CHECK(push(stack, &value));
+  }
+  for (uint16_t value = 0; value < 10; ++value) {
+    CHECK(index_of(stack, &value) == 9u - value);
+  }
+  uint16_t missing = 10;
+  CHECK(index_of(stack, &missing) == SIZE_MAX && !contains(stack, &missing));
+  free_stack(stack);
+}
+
+int main(void) {
+  test_all_element_sizes();
+  test_topmost_duplicate();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,73 @@
+/**
+ * @file test_growth.c
+ *
+ * @brief Tests for growth policies, reserve() and shrink_to_fit().
+ */
+
+#include "../stack.h"
+#include "test.h"
+
+static void test_max_capacity_limits_every_push_path(void) {
+  Stack *stack = new_inline_stack(sizeof(int), NULL);
+  StackGrowthPolicy policy = {2.0, 0, 3};
+  CHECK(set_growth_policy(stack, &policy));
+  int values[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+  for (int i = 0; i < 3; ++i) {
+    CHECK(try_push(stack, &values[i]) == STACK_OK);
+  }
+  CHECK(try_push(stack, &values[3]) == STACK_ERROR_FULL);
+  CHECK(!push(stack, &values[3]));
+  CHECK(push_n(stack, values, 8) == 0);
+  CHECK(size(stack) == 3);
+  CHECK(try_reserve(stack, 4) == STACK_ERROR_FULL);
+  int out;
+  CHECK(pop_into(stack, &out) && out == 2);
+  CHECK(push_n(stack, values, 8) == 1 && size(stack) == 3);
+  CHECK(set_growth_policy(stack, NULL));
+  CHECK(push_n(stack, values, 8) == 8 && size(stack) == 11);
+  policy.max_capacity = 10;
+  CHECK(!set_growth_policy(stack, &policy));
+  free_stack(stack);
+}
+
+static void test_max_capacity_pointer_stack(void) {
+  Stack *stack = new_stack(NULL, NULL, NULL);
+  StackGrowthPolicy policy = {0.0, 4, 2};
+  CHECK(set_growth_policy(stack, &policy));
+  int a = 1;
+  int b = 2;
+  CHECK(try_push_owned(stack, &a) == STACK_OK);
+  CHECK(try_push_owned(stack, &b) == STACK_OK);
+  CHECK(try_push_owned(stack, &a) == STACK_ERROR_FULL);
+  CHECK(size(stack) == 2);
+  Stack *source = new_stack(NULL, NULL, NULL);
+  CHECK(push_owned(source, &a));
+  CHECK(stack_splice(stack, source, 1) == STACK_ERROR_FULL && size(source) == 1);
+  free_stack(source);
+  free_stack(stack);
+}
+
+static void test_chunk_growth_and_shrink(void) {
+  Stack *stack = new_inline_stack(sizeof(int), NULL);
+  StackGrowthPolicy policy = {0.0, 100, 0};
+  CHECK(set_growth_policy(stack, &policy));
+  for (int i = 0; i < 1000; ++i) {
+    CHECK(push(stack, &i));
+  }
+  CHECK(capacity(stack) >= 1000 && capacity(stack) < 1100);
+  CHECK(reserve(stack, 5000) && capacity(stack) >= 5000);
+  shrink_to_fit(stack);
+  CHECK(capacity(stack) == 1000);
+  CHECK(*(int *)peek(stack) == 999);
+  policy.chunk = 0;
+  policy.factor = 1.0;
+  CHECK(!set_growth_policy(stack, &policy));
+  free_stack(stack);
+}
+
+int main(void) {
+  test_max_capacity_limits_every_push_path();
+  test_max_capacity_pointer_stack();
+  test_chunk_growth_and_shrink();
+  return EXIT_SUCCESS;
+}
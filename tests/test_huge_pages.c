@@ -0,0 +1,100 @@
+/**
+ * @file test_huge_pages.c
+ *
+ * @brief Tests for the huge page and NUMA placement options.
+ *
+ * Whether huge pages or NUMA binding are granted depends on the system; the
+ * stacks must behave the same either way.
+ */
+
+#include "../stack.h"
+#include "test.h"
+#include <stdint.h>
+
+#define VALUES (STACK_HUGE_PAGE_SIZE / sizeof(uint32_t) * 3)
+
+static uint32_t values[VALUES];
+
+static void check_placement(StackHugePages huge_pages, StackNumaPolicy numa_policy,
+                            uint64_t numa_nodes) {
+  StackOptions options = {0};
+  options.element_size = sizeof(uint32_t);
+  options.huge_pages = huge_pages;
+  options.numa_policy = numa_policy;
+  options.numa_nodes = numa_nodes;
+  Stack *stack = new_stack_with_options(&options);
+  CHECK(stack);
+  for (uint32_t i = 0; i < 1000; ++i) {
+    CHECK(push(stack, &i));
+  }
+  CHECK(push_n(stack, values, VALUES) == VALUES);
+  CHECK(size(stack) == VALUES + 1000);
+  const uint32_t *data = view(stack).data;
+  CHECK(data[999] == 999 && data[1000] == 0 && data[VALUES + 999] == VALUES - 1);
+  Stack *copy = clone(stack);
+  CHECK(copy && *(uint32_t *)peek(copy) == VALUES - 1);
+  free_stack(copy);
+  CHECK(pop_n(stack, values, VALUES) == VALUES && values[VALUES - 1] == VALUES - 1);
+  shrink_to_fit(stack);
+  CHECK(size(stack) == 1000 && *(uint32_t *)peek(stack) == 999);
+  free_stack(stack);
+}
+
+static void test_all_placements(void) {
+  for (uint32_t i = 0; i < VALUES; ++i) {
+    values[i] = i;
+  }
+  StackHugePages pages[] = {STACK_HUGE_PAGES_NONE, STACK_HUGE_PAGES_TRANSPARENT,
+                            STACK_HUGE_PAGES_EXPLICIT};
+  StackNumaPolicy policies[] = {STACK_NUMA_DEFAULT, STACK_NUMA_BIND, STACK_NUMA_INTERLEAVE};
+  for (size_t p = 0; p < sizeof(pages) / sizeof(pages[0]); ++p) {
+    for (size_t n = 0; n < sizeof(policies) / sizeof(policies[0]); ++n) {
+      check_placement(pages[p], policies[n], 0);
+      check_placement(pages[p], policies[n], 1);
+    }
+  }
+}
+
+static void *heap_alloc(void *ctx, size_t size) {
+  (void)ctx;
+  return malloc(size);
+}
+
+static void *heap_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+  (void)ctx;
+  (void)old_size;
+  return realloc(ptr, new_size);
+}
+
+static void heap_free(void *ctx, void *ptr, size_t size) {
+  (void)ctx;
+  (void)size;
+  free(ptr);
+}
+
+static void test_invalid_options(void) {
+  StackAllocator allocator = {heap_alloc, heap_realloc, heap_free, NULL};
+  StackOptions options = {0};
+  options.element_size = sizeof(uint32_t);
+  options.allocator = &allocator;
+  options.huge_pages = STACK_HUGE_PAGES_TRANSPARENT;
+  CHECK(new_stack_with_options(&options) == NULL);
+  options.huge_pages = STACK_HUGE_PAGES_NONE;
+  options.numa_policy = STACK_NUMA_BIND;
+  CHECK(new_stack_with_options(&options) == NULL);
+  options.allocator = NULL;
+  options.numa_nodes = UINT64_C(1) << 60;
+  CHECK(new_stack_with_options(&options) == NULL);
+  options.numa_nodes = 0;
+  options.numa_policy = (StackNumaPolicy)(STACK_NUMA_INTERLEAVE + 1);
+  CHECK(new_stack_with_options(&options) == NULL);
+  options.numa_policy = STACK_NUMA_DEFAULT;
+  options.huge_pages = (StackHugePages)(STACK_HUGE_PAGES_EXPLICIT + 1);
+  CHECK(new_stack_with_options(&options) == NULL);
+}
+
+int main(void) {
+  test_all_placements();
+  test_invalid_options();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,123 @@
+/**
+ * @file test_index.c
+ *
+ * @brief Tests for the hash index behind contains() and index_of().
+ */
+
+#include "../stack.h"
+#include "test.h"
+#include <stdint.h>
+
+#define VALUES 40
+
+static unsigned int seed = 12345;
+
+static unsigned int next_random(void) {
+  seed = seed * 1103515245u + 12345u;
+  return seed >> 8;
+}
+
+static int cmp_int(const void *a, const void *b) {
+  int x = *(const int *)a;
+  int y = *(const int *)b;
+  return (x > y) - (x < y);
+}
+
+static size_t colliding_hash(const void *element) {
+  return SIZE_MAX - (size_t)(*(const int *)element % 3);
+}
+
+static bool is_odd(const void *element, void *ctx) {
+  (void)ctx;
+  return *(const int *)element % 2;
+}
+
+static Stack *new_int_stack_with_hash(StackHashFunc hash_func) {
+  StackOptions options = {0};
+  options.element_size = sizeof(int);
+  options.cmp_func = cmp_int;
+  options.hash_func = hash_func;
+  return new_stack_with_options(&options);
+}
+
+static void check_matches(const Stack *indexed, const Stack *reference) {
+  CHECK(size(indexed) == size(reference));
+  for (int value = -1; value <= VALUES; ++value) {
+    CHECK(index_of(indexed, &value) == index_of(reference, &value));
+    CHECK(contains(indexed, &value) == contains(reference, &value));
+  }
+}
+
+static void test_random_pushes_and_pops(void) {
+  Stack *indexed = new_int_stack_with_hash(colliding_hash);
+  Stack *reference = new_int_stack_with_hash(NULL);
+  int buffer[16];
+  for (int step = 0; step < 20000; ++step) {
+    unsigned int action = next_random() % 8;
+    int value = (int)(next_random() % VALUES);
+    if (action < 4) {
+      CHECK(push(indexed, &value) && push(reference, &value));
+    } else if (action < 6) {
+      int a = 0;
+      int b = 0;
+      CHECK(pop_into(indexed, &a) == pop_into(reference, &b) && a == b);
+    } else if (action == 6) {
+      size_t count = next_random() % 16;
+      CHECK(pop_n(indexed, buffer, count) == pop_n(reference, buffer, count));
+    } else {
+      size_t count = next_random() % 16;
+      for (size_t i = 0; i < count; ++i) {
+        buffer[i] = (int)(next_random() % VALUES);
+      }
+      CHECK(push_n(indexed, buffer, count) == count && push_n(reference, buffer, count) == count);
+    }
+    if (step % 97 == 0) {
+      check_matches(indexed, reference);
+    }
+  }
+  check_matches(indexed, reference);
+  free_stack(indexed);
+  free_stack(reference);
+}
+
+static void test_operations_that_rebuild(void) {
+  Stack *indexed = new_int_stack_with_hash(colliding_hash);
+  Stack *reference = new_int_stack_with_hash(NULL);
+  for (int i = 0; i < 1000; ++i) {
+    int value = (int)(next_random() % VALUES);
+    CHECK(push(indexed, &value) && push(reference, &value));
+  }
+  reverse(indexed);
+  reverse(reference);
+  check_matches(indexed, reference);
+  CHECK(remove_if(indexed, is_odd, NULL) == remove_if(reference, is_odd, NULL));
+  check_matches(indexed, reference);
+  Stack *copy = clone(indexed);
+  check_matches(copy, reference);
+  clear(indexed);
+  clear(reference);
+  check_matches(indexed, reference);
+  int value = 7;
+  CHECK(push(indexed, &value) && index_of(indexed, &value) == 0);
+  free_stack(copy);
+  free_stack(indexed);
+  free_stack(reference);
+}
+
+static void test_invalid_options(void) {
+  StackOptions options = {0};
+  options.element_size = sizeof(int);
+  options.hash_func = colliding_hash;
+  CHECK(new_stack_with_options(&options) == NULL);
+  options.cmp_func = cmp_int;
+  options.bound = 4;
+  options.drop_oldest = true;
+  CHECK(new_stack_with_options(&options) == NULL);
+}
+
+int main(void) {
+  test_random_pushes_and_pops();
+  test_operations_that_rebuild();
+  test_invalid_options();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,64 @@
+/**
+ * @file test_init_stack.c
+ *
+ * @brief Tests for stacks constructed in caller-provided storage.
+ */
+
+#include "../stack.h"
+#include "test.h"
+
+/**
+ * @brief Struct embedding a stack.
+ */
+typedef struct Parser {
+  int depth;            // Unrelated field before the stack.
+  StackStorage storage; // Storage of the embedded stack.
+} Parser;
+
+static void test_embedded_stack(void) {
+  Parser parser = {0};
+  Stack *stack = init_stack(&parser.storage, sizeof(parser.storage), copy_int, free, NULL);
+  CHECK(stack && (void *)stack == (void *)&parser.storage);
+  for (int i = 0; i < 100; ++i) {
+    CHECK(push(stack, &i));
+  }
+  CHECK(*(int *)peek(stack) == 99);
+  deinit_stack(stack);
+  stack = init_stack(&parser.storage, sizeof(parser.storage), copy_int, free, NULL);
+  CHECK(stack && is_empty(stack));
+  deinit_stack(stack);
+}
+
+static void test_no_allocation_in_storage(void) {
+  StackAllocator allocator = {count_alloc, count_realloc, count_free, NULL};
+  StackOptions options = {0};
+  options.element_size = sizeof(int);
+  options.allocator = &allocator;
+  _Alignas(max_align_t) unsigned char storage[STACK_STORAGE_SIZE + 64 * sizeof(int)];
+  allocations = 0;
+  Stack *stack = init_stack_with_options(storage, sizeof(storage), &options);
+  CHECK(stack && capacity(stack) >= 64);
+  size_t slots = capacity(stack);
+  for (size_t i = 0; i < slots; ++i) {
+    int value = (int)i;
+    CHECK(push(stack, &value));
+  }
+  CHECK(allocations == 0);
+  int value = -1;
+  CHECK(push(stack, &value) && allocations == 1);
+  deinit_stack(stack);
+}
+
+static void test_rejects_bad_storage(void) {
+  StackStorage storage;
+  CHECK(init_stack(&storage, STACK_STORAGE_SIZE - 1, NULL, NULL, NULL) == NULL);
+  CHECK(init_stack(storage.bytes + 1, STACK_STORAGE_SIZE - 1, NULL, NULL, NULL) == NULL);
+  CHECK(init_stack(NULL, STACK_STORAGE_SIZE, NULL, NULL, NULL) == NULL);
+}
+
+int main(void) {
+  test_embedded_stack();
+  test_no_allocation_in_storage();
+  test_rejects_bad_storage();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,86 @@
+/**
+ * @file test_inline.c
+ *
+ * @brief Tests for inline stacks storing elements by value.
+ */
+
+#include "../stack.h"
+#include "test.h"
+
+/**
+ * @brief Element type stored by value.
+ */
+typedef struct Point {
+  int x; // Horizontal coordinate.
+  int y; // Vertical coordinate.
+} Point;
+
+static int compare_points(const void *a, const void *b) {
+  const Point *p = a;
+  const Point *q = b;
+  return p->x != q->x ? p->x - q->x : p->y - q->y;
+}
+
+static void test_push_pop_by_value(void) {
+  Stack *stack = new_inline_stack(sizeof(Point), compare_points);
+  CHECK(stack && element_size(stack) == sizeof(Point) && is_empty(stack));
+  for (int i = 0; i < 1000; ++i) {
+    Point point = {i, -i};
+    CHECK(push(stack, &point));
+  }
+  CHECK(size(stack) == 1000);
+  const Point *top = peek(stack);
+  CHECK(top->x == 999 && top->y == -999);
+  Point out;
+  CHECK(pop_into(stack, &out) && out.x == 999);
+  const Point *popped = pop(stack);
+  CHECK(popped && popped->x == 998);
+  Point missing = {5000, 0};
+  Point present = {10, -10};
+  CHECK(contains(stack, &present) && !contains(stack, &missing));
+  CHECK(index_of(stack, &present) == 987);
+  free_stack(stack);
+  CHECK(new_inline_stack(0, NULL) == NULL);
+}
+
+static void test_clone_reverse_to_array(void) {
+  Stack *stack = new_inline_stack(sizeof(Point), NULL);
+  for (int i = 0; i < 50; ++i) {
+    Point point = {i, i * i};
+    push(stack, &point);
+  }
+  Stack *copy = clone(stack);
+  CHECK(copy && size(copy) == 50);
+  reverse(copy);
+  CHECK(((const Point *)peek(copy))->x == 0);
+  size_t count = 0;
+  Point *array = (Point *)to_array(stack, &count);
+  CHECK(array && count == 50);
+  for (int i = 0; i < 50; ++i) {
+    CHECK(array[i].x == i && array[i].y == i * i);
+  }
+  free(array);
+  Point zero = {0, 0};
+  CHECK(contains(copy, &zero));
+  clear(copy);
+  CHECK(is_empty(copy) && peek(copy) == NULL && !pop_into(copy, &zero));
+  free_stack(copy);
+  free_stack(stack);
+}
+
+static void test_push_copies_value(void) {
+  Stack *stack = new_inline_stack(sizeof(int), NULL);
+  int value = 1;
+  push(stack, &value);
+  value = 2;
+  CHECK(*(int *)peek(stack) == 1);
+  CHECK(push_owned(stack, &value) == false);
+  free_stack(stack);
+}
+
+int main(void) {
+  test_push_pop_by_value();
+  test_clone_reverse_to_array();
+  test_push_copies_value();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,73 @@
+/**
+ * @file test_int_stack.c
+ *
+ * @brief Tests for the packed integer stacks.
+ */
+
+#include "../stack.h"
+#include "test.h"
+#include <stdint.h>
+
+static void check_width(size_t width_bits, uint32_t max) {
+  Stack *stack = new_int_stack(width_bits);
+  CHECK(stack && element_size(stack) == width_bits / 8);
+  uint32_t values[] = {0, 1, max / 2, max - 1, max};
+  for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+    CHECK(push_int(stack, values[i]));
+  }
+  if (max < UINT32_MAX) {
+    CHECK(!push_int(stack, max + 1));
+    CHECK(!push_int(stack, UINT32_MAX));
+  }
+  uint32_t out = 0;
+  CHECK(peek_int(stack, &out) && out == max && size(stack) == 5);
+  for (size_t i = sizeof(values) / sizeof(values[0]); i-- > 0;) {
+    CHECK(pop_int(stack, &out) && out == values[i]);
+  }
+  CHECK(!pop_int(stack, &out) && !peek_int(stack, &out));
+  for (uint32_t i = 0; i < 100000; ++i) {
+    CHECK(push_int(stack, i & max));
+  }
+  CHECK(pop_int(stack, NULL) && size(stack) == 99999);
+  CHECK(peek_int(stack, &out) && out == (99998u & max));
+  free_stack(stack);
+}
+
+static void test_widths(void) {
+  check_width(8, UINT8_MAX);
+  check_width(16, UINT16_MAX);
+  check_width(32, UINT32_MAX);
+  CHECK(new_int_stack(0) == NULL && new_int_stack(24) == NULL && new_int_stack(64) == NULL);
+}
+
+static void test_other_stacks_are_rejected(void) {
+  uint32_t out;
+  Stack *pointers = new_stack(NULL, NULL, NULL);
+  CHECK(!push_int(pointers, 1) && !pop_int(pointers, &out) && !peek_int(pointers, &out));
+  free_stack(pointers);
+  Stack *wide = new_inline_stack(sizeof(uint64_t), NULL);
+  CHECK(!push_int(wide, 1) && size(wide) == 0);
+  free_stack(wide);
+  CHECK(!push_int(NULL, 1) && !pop_int(NULL, &out) && !peek_int(NULL, &out));
+}
+
+static void test_works_with_inline_operations(void) {
+  Stack *stack = new_int_stack(16);
+  uint16_t values[] = {7, 8, 9};
+  CHECK(push_n(stack, values, 3) == 3);
+  uint16_t key = 8;
+  CHECK(index_of(stack, &key) == 1);
+  uint32_t out;
+  CHECK(pop_int(stack, &out) && out == 9);
+  Stack *copy = clone(stack);
+  CHECK(peek_int(copy, &out) && out == 8);
+  free_stack(copy);
+  free_stack(stack);
+}
+
+int main(void) {
+  test_widths();
+  test_other_stacks_are_rejected();
+  test_works_with_inline_operations();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,137 @@
+/**
+ * @file test_mark.c
+ *
+ * @brief Tests for mark(), rollback() and commit().
+ */
+
+#include "../stack.h"
+#include "test.h"
+
+static void *arena_copy_int(const void *element, StackArena *arena) {
+  int *copy = arena_alloc(arena, sizeof(int));
+  if (copy) {
+    *copy = *(const int *)element;
+  }
+  return copy;
+}
+
+static void push_range(Stack *stack, int from, int to) {
+  for (int i = from; i < to; ++i) {
+    CHECK(push(stack, &i));
+  }
+}
+
+static void test_nested_marks(void) {
+  Stack *stack = new_stack(copy_int, free, NULL);
+  push_range(stack, 0, 5);
+  StackMark outer = mark(stack);
+  push_range(stack, 5, 10);
+  StackMark inner = mark(stack);
+  push_range(stack, 10, 20);
+  free(pop(stack));
+  CHECK(!rollback(stack, outer));
+  CHECK(rollback(stack, inner) && size(stack) == 10);
+  CHECK(!rollback(stack, inner) && !commit(stack, inner));
+  StackMark again = mark(stack);
+  push_range(stack, 10, 12);
+  CHECK(commit(stack, again) && size(stack) == 12);
+  CHECK(rollback(stack, outer) && size(stack) == 5);
+  CHECK(*(int *)peek(stack) == 4);
+  free_stack(stack);
+}
+
+static void test_pop_below_mark_closes_it(void) {
+  Stack *stack = new_inline_stack(sizeof(int), NULL);
+  push_range(stack, 0, 10);
+  StackMark outer = mark(stack);
+  push_range(stack, 10, 12);
+  StackMark checkpoint = mark(stack);
+  int out;
+  pop_into(stack, &out);
+  push_range(stack, 0, 5);
+  CHECK(!rollback(stack, checkpoint) && !commit(stack, checkpoint));
+  CHECK(!rollback(stack, outer));
+  CHECK(size(stack) == 16);
+  StackMark cleared = mark(stack);
+  clear(stack);
+  CHECK(!rollback(stack, cleared));
+  free_stack(stack);
+}
+
+static void test_arena_rollback_after_pop_fails(void) {
+  StackOptions options = {0};
+  options.arena_copy_func = arena_copy_int;
+  Stack *stack = new_stack_with_options(&options);
+  push_range(stack, 0, 100);
+  StackMark checkpoint = mark(stack);
+  for (int i = 0; i < 10; ++i) {
+    pop(stack);
+  }
+  push_range(stack, 1000, 1200);
+  CHECK(!rollback(stack, checkpoint));
+  CHECK(size(stack) == 290 && *(int *)peek(stack) == 1199);
+  StackMark inner = mark(stack);
+  push_range(stack, 0, 10000);
+  CHECK(rollback(stack, inner) && size(stack) == 290);
+  push_range(stack, 5, 6);
+  CHECK(*(int *)peek(stack) == 5);
+  free_stack(stack);
+}
+
+static void test_outer_rollback_closes_inner(void) {
+  Stack *stack = new_stack(copy_int, free, NULL);
+  StackMark outer = mark(stack);
+  push_range(stack, 0, 3);
+  StackMark inner = mark(stack);
+  CHECK(!rollback(stack, outer) && size(stack) == 3);
+  CHECK(commit(stack, inner) && rollback(stack, outer) && size(stack) == 0);
+  CHECK(!commit(stack, inner));
+  push_range(stack, 0, 5);
+  CHECK(!rollback(stack, inner));
+  free_stack(stack);
+}
+
+static void test_drop_oldest_rejects_marks(void) {
+  Stack *stack = new_bounded_stack(4, true, copy_int, free, NULL);
+  push_range(stack, 0, 2);
+  StackMark checkpoint = mark(stack);
+  push_range(stack, 2, 10);
+  CHECK(!rollback(stack, checkpoint) && !commit(stack, checkpoint));
+  CHECK(size(stack) == 4);
+  CHECK(!rollback(NULL, checkpoint));
+  free_stack(stack);
+}
+
+static bool is_negative(const void *element, void *ctx) {
+  (void)ctx;
+  return *(const int *)element < 0;
+}
+
+static void test_bulk_changes_below_mark_close_it(void) {
+  Stack *stack = new_inline_stack(sizeof(int), NULL);
+  push_range(stack, 0, 5);
+  StackMark checkpoint = mark(stack);
+  push_range(stack, -3, 0);
+  CHECK(remove_if(stack, is_negative, NULL) == 3);
+  CHECK(rollback(stack, checkpoint) && size(stack) == 5);
+  checkpoint = mark(stack);
+  CHECK(remove_if(stack, is_negative, NULL) == 0);
+  reverse(stack);
+  CHECK(!rollback(stack, checkpoint));
+  checkpoint = mark(stack);
+  Stack *other = new_inline_stack(sizeof(int), NULL);
+  CHECK(stack_splice(other, stack, 1) == STACK_OK);
+  CHECK(!commit(stack, checkpoint) && size(other) == 1);
+  free_stack(other);
+  free_stack(stack);
+}
+
+int main(void) {
+  test_nested_marks();
+  test_pop_below_mark_closes_it();
+  test_arena_rollback_after_pop_fails();
+  test_outer_rollback_closes_inner();
+  test_drop_oldest_rejects_marks();
+  test_bulk_changes_below_mark_close_it();
+  return EXIT_SUCCESS;
+}
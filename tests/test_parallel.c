@@ -0,0 +1,107 @@
+/**
+ * @file test_parallel.c
+ *
+ * @brief Tests for parallel_clone() and parallel_to_array().
+ */
+
+#include "../stack.h"
+#include "test.h"
+#include <stdatomic.h>
+
+#define LARGE 50000
+
+static atomic_int failing = -1;
+
+static void *copy_int_unless_failing(const void *element) {
+  if (*(const int *)element == atomic_load(&failing)) {
+    return NULL;
+  }
+  return copy_int(element);
+}
+
+static long live(void) {
+  return (long)(atomic_load(&copies) - atomic_load(&frees));
+}
+
+static Stack *new_filled_stack(int count) {
+  Stack *stack = new_stack(copy_int_unless_failing, free_int, NULL);
+  for (int i = 0; i < count; ++i) {
+    CHECK(push(stack, &i));
+  }
+  return stack;
+}
+
+static void check_array(void **array, size_t array_size, size_t expected_size) {
+  CHECK(array && array_size == expected_size);
+  for (size_t i = 0; i < array_size; ++i) {
+    CHECK(*(int *)array[i] == (int)i);
+    free_int(array[i]);
+  }
+  free(array);
+}
+
+static void test_matches_serial_versions(void) {
+  size_t counts[] = {0, 1, 100, 8191, 8192, LARGE};
+  size_t threads[] = {0, 1, 3, 64};
+  for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c) {
+    Stack *stack = new_filled_stack((int)counts[c]);
+    for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); ++t) {
+      Stack *copy = parallel_clone(stack, threads[t]);
+      CHECK(copy && size(copy) == counts[c]);
+      size_t array_size;
+      void **array = parallel_to_array(copy, &array_size, threads[t]);
+      if (counts[c] == 0) {
+        CHECK(array == NULL && array_size == 0);
+      } else {
+        check_array(array, array_size, counts[c]);
+      }
+      free_stack(copy);
+    }
+    free_stack(stack);
+  }
+  CHECK(live() == 0);
+}
+
+static void test_failed_copy_frees_everything(void) {
+  Stack *stack = new_filled_stack(LARGE);
+  long before = live();
+  atomic_store(&failing, LARGE / 3);
+  CHECK(parallel_clone(stack, 4) == NULL);
+  CHECK(live() == before);
+  size_t array_size = 1;
+  CHECK(parallel_to_array(stack, &array_size, 4) == NULL && array_size == 0);
+  CHECK(live() == before);
+  atomic_store(&failing, -1);
+  free_stack(stack);
+  CHECK(live() == 0);
+}
+
+static void test_inline_and_move_only_stacks(void) {
+  Stack *stack = new_inline_stack(sizeof(int), NULL);
+  for (int i = 0; i < LARGE; ++i) {
+    CHECK(push(stack, &i));
+  }
+  size_t array_size;
+  int *values = (int *)parallel_to_array(stack, &array_size, 4);
+  CHECK(values && array_size == LARGE && values[0] == 0 && values[LARGE - 1] == LARGE - 1);
+  free(values);
+  Stack *copy = parallel_clone(stack, 4);
+  CHECK(copy && size(copy) == LARGE && *(int *)peek(copy) == LARGE - 1);
+  free_stack(copy);
+  free_stack(stack);
+  Stack *move_only = new_stack(NULL, NULL, NULL);
+  int value = 0;
+  for (int i = 0; i < LARGE; ++i) {
+    CHECK(push_owned(move_only, &value));
+  }
+  CHECK(parallel_clone(move_only, 4) == NULL);
+  CHECK(parallel_to_array(move_only, &array_size, 4) == NULL);
+  free_stack(move_only);
+}
+
+int main(void) {
+  test_matches_serial_versions();
+  test_failed_copy_frees_everything();
+  test_inline_and_move_only_stacks();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,87 @@
+/**
+ * @file test_persistent.c
+ *
+ * @brief Tests for the persistent stack.
+ */
+
+#include "../persistent_stack.h"
+#include "test.h"
+
+static void test_versions_share_their_tail(void) {
+  PersistentPool *pool = new_persistent_pool(copy_int, free_int);
+  PersistentStack *base = NULL;
+  for (int i = 0; i < 3; ++i) {
+    PersistentStack *next = persistent_push(pool, base, &i);
+    CHECK(next);
+    persistent_release(pool, base);
+    base = next;
+  }
+  int left_value = 10;
+  int right_value = 20;
+  PersistentStack *left = persistent_push(pool, base, &left_value);
+  PersistentStack *right = persistent_push(pool, base, &right_value);
+  CHECK(copies == 5);
+  CHECK(*(int *)persistent_peek(left) == 10 && *(int *)persistent_peek(right) == 20);
+  CHECK(persistent_size(left) == 4 && persistent_size(base) == 3);
+  PersistentStack *tail = persistent_pop(left);
+  CHECK(tail == base && *(int *)persistent_peek(tail) == 2);
+  persistent_release(pool, tail);
+  persistent_release(pool, left);
+  CHECK(frees == 1 && *(int *)persistent_peek(right) == 20);
+  persistent_release(pool, base);
+  CHECK(frees == 1 && persistent_size(right) == 4);
+  persistent_release(pool, right);
+  CHECK(frees == 5);
+  free_persistent_pool(pool);
+}
+
+static void test_empty_version(void) {
+  PersistentPool *pool = new_persistent_pool(copy_int, free_int);
+  CHECK(persistent_is_empty(NULL) && persistent_size(NULL) == 0);
+  CHECK(persistent_peek(NULL) == NULL && persistent_pop(NULL) == NULL);
+  CHECK(persistent_retain(NULL) == NULL);
+  int value = 1;
+  PersistentStack *one = persistent_push(pool, NULL, &value);
+  CHECK(persistent_pop(one) == NULL && !persistent_is_empty(one));
+  CHECK(persistent_retain(one) == one);
+  persistent_release(pool, one);
+  persistent_release(pool, one);
+  persistent_release(pool, NULL);
+  free_persistent_pool(pool);
+}
+
+static void test_move_only_pool(void) {
+  PersistentPool *pool = new_persistent_pool(NULL, NULL);
+  int value = 1;
+  CHECK(persistent_push(pool, NULL, &value) == NULL);
+  PersistentStack *one = persistent_push_owned(pool, NULL, &value);
+  CHECK(one && persistent_peek(one) == &value);
+  persistent_release(pool, one);
+  free_persistent_pool(pool);
+}
+
+static void test_deep_release_reuses_nodes(void) {
+  PersistentPool *pool = new_persistent_pool(copy_int, free_int);
+  for (int round = 0; round < 3; ++round) {
+    frees = 0;
+    PersistentStack *stack = NULL;
+    for (int i = 0; i < 200000; ++i) {
+      PersistentStack *next = persistent_push(pool, stack, &i);
+      CHECK(next);
+      persistent_release(pool, stack);
+      stack = next;
+    }
+    CHECK(persistent_size(stack) == 200000);
+    persistent_release(pool, stack);
+    CHECK(frees == 200000);
+  }
+  free_persistent_pool(pool);
+}
+
+int main(void) {
+  test_versions_share_their_tail();
+  test_empty_version();
+  test_move_only_pool();
+  test_deep_release_reuses_nodes();
+  return EXIT_SUCCESS;
+}
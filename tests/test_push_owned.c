@@ -0,0 +1,52 @@
+/**
+ * @file test_push_owned.c
+ *
+ * @brief Tests for push_owned() and try_push_owned().
+ */
+
+#include "../stack.h"
+#include "test.h"
+
+static void test_ownership_moves_without_copies(void) {
+  Stack *stack = new_stack(copy_int, free_int, NULL);
+  int *element = malloc(sizeof(int));
+  *element = 42;
+  CHECK(push_owned(stack, element));
+  CHECK(copies == 0 && peek(stack) == element);
+  int *popped = pop(stack);
+  CHECK(popped == element && frees == 0);
+  CHECK(try_push_owned(stack, popped) == STACK_OK);
+  clear(stack);
+  CHECK(frees == 1 && copies == 0);
+  free_stack(stack);
+}
+
+static void test_move_only_stack(void) {
+  Stack *stack = new_stack(NULL, free_int, NULL);
+  int value = 1;
+  CHECK(!push(stack, &value));
+  for (int i = 0; i < 100; ++i) {
+    int *element = malloc(sizeof(int));
+    *element = i;
+    CHECK(push_owned(stack, element));
+  }
+  CHECK(clone(stack) == NULL);
+  frees = 0;
+  free_stack(stack);
+  CHECK(frees == 100);
+}
+
+static void test_inline_stack_rejects_ownership(void) {
+  Stack *stack = new_inline_stack(sizeof(int), NULL);
+  int value = 1;
+  CHECK(try_push_owned(stack, &value) == STACK_ERROR_UNSUPPORTED);
+  CHECK(try_push_owned(NULL, &value) == STACK_ERROR_NULL);
+  free_stack(stack);
+}
+
+int main(void) {
+  test_ownership_moves_without_copies();
+  test_move_only_stack();
+  test_inline_stack_rejects_ownership();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,82 @@
+/**
+ * @file test_reclaim.c
+ *
+ * @brief Tests for batch freeing and the asynchronous reclaimer.
+ */
+
+#include "../stack.h"
+#include "test.h"
+#include <stdatomic.h>
+
+#define STACKS 16
+#define PER_STACK 5000
+
+static size_t batches;
+static size_t batched;
+
+static void free_batch(void **elements, size_t count) {
+  ++batches;
+  batched += count;
+  for (size_t i = 0; i < count; ++i) {
+    free(elements[i]);
+  }
+}
+
+static Stack *new_filled_stack(const StackOptions *options, int count) {
+  Stack *stack = new_stack_with_options(options);
+  CHECK(stack);
+  for (int i = 0; i < count; ++i) {
+    CHECK(push(stack, &i));
+  }
+  return stack;
+}
+
+static void test_batch_free(void) {
+  StackOptions options = {0};
+  options.copy_func = copy_int;
+  options.free_func = free_int;
+  options.batch_free_func = free_batch;
+  Stack *stack = new_filled_stack(&options, 1000);
+  free(pop(stack));
+  clear(stack);
+  CHECK(batches == 1 && batched == 999 && atomic_load(&frees) == 0);
+  int value = 1;
+  CHECK(push(stack, &value) && push(stack, &value));
+  free_stack(stack);
+  CHECK(batches == 2 && batched == 1001 && atomic_load(&frees) == 0);
+  options.element_size = sizeof(int);
+  stack = new_filled_stack(&options, 10);
+  free_stack(stack);
+  CHECK(batches == 2);
+}
+
+static void test_async_free(void) {
+  StackOptions options = {0};
+  options.copy_func = copy_int;
+  options.free_func = free_int;
+  atomic_store(&frees, 0);
+  for (int i = 0; i < STACKS; ++i) {
+    CHECK(free_stack_async(new_filled_stack(&options, PER_STACK)));
+  }
+  wait_stack_reclaimer();
+  CHECK(atomic_load(&frees) == (size_t)STACKS * PER_STACK);
+  wait_stack_reclaimer();
+  CHECK(!free_stack_async(NULL));
+}
+
+static void test_caller_storage_frees_synchronously(void) {
+  StackStorage storage;
+  Stack *stack = init_stack(&storage, sizeof(storage), copy_int, free_int, NULL);
+  int value = 3;
+  CHECK(push(stack, &value));
+  atomic_store(&frees, 0);
+  CHECK(!free_stack_async(stack));
+  CHECK(atomic_load(&frees) == 1);
+}
+
+int main(void) {
+  test_batch_free();
+  test_async_free();
+  test_caller_storage_frees_synchronously();
+  return EXIT_SUCCESS;
+}
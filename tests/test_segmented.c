@@ -0,0 +1,78 @@
+/**
+ * @file test_segmented.c
+ *
+ * @brief Tests for the segmented stack.
+ */
+
+#include "../segmented_stack.h"
+#include "test.h"
+
+/**
+ * @brief Element larger than a pointer.
+ */
+typedef struct Point {
+  double x; // Horizontal coordinate.
+  double y; // Vertical coordinate.
+} Point;
+
+static void test_pointers_stay_valid_while_growing(void) {
+  SegmentedStack *stack = new_segmented_stack(sizeof(Point), 8);
+  Point first = {1.0, 2.0};
+  CHECK(segmented_push(stack, &first));
+  Point *kept = segmented_peek(stack);
+  for (int i = 0; i < 1000; ++i) {
+    Point point = {i, -i};
+    CHECK(segmented_push(stack, &point));
+  }
+  CHECK(kept->x == 1.0 && kept->y == 2.0);
+  CHECK(segmented_size(stack) == 1001);
+  Point out;
+  for (int i = 999; i >= 0; --i) {
+    CHECK(segmented_pop(stack, &out) && out.x == i && out.y == -i);
+  }
+  CHECK(segmented_peek(stack) == kept);
+  CHECK(segmented_pop(stack, NULL) && segmented_is_empty(stack));
+  CHECK(!segmented_pop(stack, &out) && segmented_peek(stack) == NULL);
+  free_segmented_stack(stack);
+}
+
+static void test_segment_boundary(void) {
+  SegmentedStack *stack = new_segmented_stack(sizeof(int), 4);
+  for (int i = 0; i < 4; ++i) {
+    CHECK(segmented_push(stack, &i));
+  }
+  int out;
+  for (int step = 0; step < 100; ++step) {
+    int value = 100 + step;
+    CHECK(segmented_push(stack, &value));
+    CHECK(*(int *)segmented_peek(stack) == value);
+    CHECK(segmented_pop(stack, &out) && out == value);
+    CHECK(*(int *)segmented_peek(stack) == 3);
+  }
+  segmented_clear(stack);
+  CHECK(segmented_is_empty(stack) && segmented_size(stack) == 0);
+  for (int i = 0; i < 9; ++i) {
+    CHECK(segmented_push(stack, &i));
+  }
+  CHECK(segmented_size(stack) == 9 && *(int *)segmented_peek(stack) == 8);
+  free_segmented_stack(stack);
+}
+
+static void test_invalid_arguments(void) {
+  CHECK(new_segmented_stack(0, 4) == NULL);
+  SegmentedStack *stack = new_segmented_stack(sizeof(int), 0);
+  CHECK(stack && segmented_is_empty(stack));
+  for (int i = 0; i < SEGMENTED_STACK_DEFAULT_SLOTS + 1; ++i) {
+    CHECK(segmented_push(stack, &i));
+  }
+  CHECK(*(int *)segmented_peek(stack) == SEGMENTED_STACK_DEFAULT_SLOTS);
+  free_segmented_stack(stack);
+  free_segmented_stack(NULL);
+}
+
+int main(void) {
+  test_pointers_stay_valid_while_growing();
+  test_segment_boundary();
+  test_invalid_arguments();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,198 @@
+/**
+ * @file test_serialize.c
+ *
+ * @brief Tests for serialize() and deserialize().
+ */
+
+#include "../stack.h"
+#include "test.h"
+#include <stdint.h>
+#include <string.h>
+
+static size_t largest_alloc;
+static size_t live_bytes;
+static StackArena *decode_arena;
+
+static void *track_alloc(void *ctx, size_t size) {
+  (void)ctx;
+  if (size > largest_alloc) {
+    largest_alloc = size;
+  }
+  live_bytes += size;
+  return malloc(size);
+}
+
+static void *track_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+  (void)ctx;
+  if (new_size > largest_alloc) {
+    largest_alloc = new_size;
+  }
+  void *resized = realloc(ptr, new_size);
+  if (resized) {
+    live_bytes += new_size - old_size;
+  }
+  return resized;
+}
+
+static void track_free(void *ctx, void *ptr, size_t size) {
+  (void)ctx;
+  live_bytes -= size;
+  free(ptr);
+}
+
+static bool encode_int(const void *element, StackWriteFunc write, void *ctx) {
+  return write(ctx, element, sizeof(int));
+}
+
+static void *decode_int(StackReadFunc read, void *ctx) {
+  int *element = malloc(sizeof(int));
+  if (!read(ctx, element, sizeof(int))) {
+    free(element);
+    return NULL;
+  }
+  return element;
+}
+
+static void *copy_int_to_arena(const void *element, StackArena *arena) {
+  int *copy = arena_alloc(arena, sizeof(int));
+  if (copy) {
+    *copy = *(const int *)element;
+  }
+  return copy;
+}
+
+static void *decode_int_to_arena(StackReadFunc read, void *ctx) {
+  int *element = arena_alloc(decode_arena, sizeof(int));
+  if (!element || !read(ctx, element, sizeof(int))) {
+    return NULL;
+  }
+  return element;
+}
+
+static void set_count(unsigned char *data, uint64_t count) {
+  memcpy(data + 16, &count, sizeof(count));
+}
+
+static void test_round_trip(void) {
+  Stack *stack = new_inline_stack(sizeof(int), NULL);
+  for (int i = 0; i < 100000; ++i) {
+    push(stack, &i);
+  }
+  size_t length = serialized_size(stack);
+  StackBuffer buffer = {malloc(length), length, 0};
+  CHECK(serialize(stack, NULL, write_buffer, &buffer) == STACK_OK && buffer.pos == length);
+  Stack *copy = new_inline_stack(sizeof(int), NULL);
+  int first = -1;
+  push(copy, &first);
+  buffer.pos = 0;
+  CHECK(deserialize(copy, NULL, read_buffer, &buffer) == STACK_OK);
+  CHECK(size(copy) == 100001 && *(int *)peek(copy) == 99999);
+  CHECK(((const int *)view(copy).data)[1] == 0);
+  Stack *other = new_inline_stack(sizeof(long long), NULL);
+  buffer.pos = 0;
+  CHECK(deserialize(other, NULL, read_buffer, &buffer) == STACK_ERROR_FORMAT);
+  free(buffer.data);
+  free_stack(other);
+  free_stack(copy);
+  free_stack(stack);
+}
+
+static void test_pointer_round_trip(void) {
+  Stack *stack = new_stack(copy_int, free, NULL);
+  for (int i = 0; i < 1000; ++i) {
+    push(stack, &i);
+  }
+  unsigned char data[8192];
+  StackBuffer buffer = {data, sizeof(data), 0};
+  CHECK(serialize(stack, NULL, write_buffer, &buffer) == STACK_ERROR_UNSUPPORTED);
+  CHECK(serialize(stack, encode_int, write_buffer, &buffer) == STACK_OK);
+  Stack *copy = new_stack(copy_int, free, NULL);
+  buffer.size = buffer.pos;
+  buffer.pos = 0;
+  CHECK(deserialize(copy, decode_int, read_buffer, &buffer) == STACK_OK);
+  CHECK(size(copy) == 1000 && *(int *)peek(copy) == 999);
+  buffer.size -= 10;
+  buffer.pos = 0;
+  size_t before = capacity(copy);
+  CHECK(deserialize(copy, decode_int, read_buffer, &buffer) == STACK_ERROR_IO);
+  CHECK(size(copy) == 1000 && capacity(copy) == before);
+  free_stack(copy);
+  free_stack(stack);
+}
+
+static void test_hostile_count(void) {
+  Stack *small = new_inline_stack(sizeof(int), NULL);
+  for (int i = 0; i < 3; ++i) {
+    push(small, &i);
+  }
+  unsigned char data[64];
+  StackBuffer buffer = {data, sizeof(data), 0};
+  CHECK(serialize(small, NULL, write_buffer, &buffer) == STACK_OK);
+  set_count(data, (uint64_t)1 << 40);
+  buffer.size = buffer.pos;
+  StackAllocator allocator = {track_alloc, track_realloc, track_free, NULL};
+  StackOptions options = {0};
+  options.element_size = sizeof(int);
+  options.allocator = &allocator;
+  Stack *stack = new_stack_with_options(&options);
+  int value = 42;
+  push(stack, &value);
+  size_t before = capacity(stack);
+  largest_alloc = 0;
+  buffer.pos = 0;
+  CHECK(deserialize(stack, NULL, read_buffer, &buffer) == STACK_ERROR_IO);
+  CHECK(largest_alloc <= 4 * 65536);
+  CHECK(size(stack) == 1 && capacity(stack) == before && *(int *)peek(stack) == 42);
+  StackGrowthPolicy policy = {2.0, 0, 100};
+  CHECK(set_growth_policy(stack, &policy));
+  buffer.pos = 0;
+  CHECK(deserialize(stack, NULL, read_buffer, &buffer) == STACK_ERROR_FULL);
+  CHECK(buffer.pos == 24);
+  free_stack(stack);
+  free_stack(small);
+}
+
+static void test_arena_failure_releases_decoded(void) {
+  Stack *source = new_stack(copy_int, free, NULL);
+  for (int i = 0; i < 10000; ++i) {
+    push(source, &i);
+  }
+  size_t length = 24 + 10000 * sizeof(int);
+  StackBuffer buffer = {malloc(length), length, 0};
+  CHECK(serialize(source, encode_int, write_buffer, &buffer) == STACK_OK && buffer.pos == length);
+  StackAllocator allocator = {track_alloc, track_realloc, track_free, NULL};
+  StackOptions options = {0};
+  options.arena_copy_func = copy_int_to_arena;
+  options.allocator = &allocator;
+  live_bytes = 0;
+  Stack *stack = new_stack_with_options(&options);
+  decode_arena = get_arena(stack);
+  int value = 42;
+  push(stack, &value);
+  size_t before = live_bytes;
+  buffer.size -= 2;
+  buffer.pos = 0;
+  CHECK(deserialize(stack, decode_int_to_arena, read_buffer, &buffer) == STACK_ERROR_IO);
+  CHECK(live_bytes == before && size(stack) == 1 && *(int *)peek(stack) == 42);
+  buffer.size = length;
+  buffer.pos = 0;
+  CHECK(deserialize(stack, decode_int_to_arena, read_buffer, &buffer) == STACK_OK);
+  CHECK(size(stack) == 10001 && *(int *)peek(stack) == 9999);
+  for (int i = 9999; i >= 0; --i) {
+    int *popped = pop(stack);
+    CHECK(popped && *popped == i);
+  }
+  CHECK(size(stack) == 1 && *(int *)peek(stack) == 42);
+  free_stack(stack);
+  CHECK(live_bytes == 0);
+  free(buffer.data);
+  free_stack(source);
+}
+
+int main(void) {
+  test_round_trip();
+  test_pointer_round_trip();
+  test_hostile_count();
+  test_arena_failure_releases_decoded();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,102 @@
+/**
+ * @file test_sharded.c
+ *
+ * @brief Tests for the sharded stack.
+ */
+
+#include "../sharded_stack.h"
+#include "test.h"
+#include <pthread.h>
+
+#define THREADS 8
+#define PER_THREAD 20000
+#define BATCH 32
+
+/**
+ * @brief Work done by one thread.
+ */
+typedef struct Worker {
+  ShardedStack *stack; // Stack shared by all workers.
+  int id;              // Index of the worker.
+  long long pushed;    // Sum of the values pushed.
+  long long popped;    // Sum of the values popped.
+  size_t pops;         // Number of values popped.
+} Worker;
+
+static void *work(void *arg) {
+  Worker *worker = arg;
+  ShardedStackLocal *local = sharded_attach(worker->stack);
+  CHECK(local);
+  for (int i = 0; i < PER_THREAD; ++i) {
+    int value = worker->id * PER_THREAD + i;
+    CHECK(sharded_push(local, &value));
+    worker->pushed += value;
+    if (i % 3 == 0) {
+      int out;
+      CHECK(sharded_pop(local, &out));
+      worker->popped += out;
+      ++worker->pops;
+    }
+  }
+  CHECK(sharded_detach(local));
+  return NULL;
+}
+
+static void test_single_thread_batches(void) {
+  ShardedStack *stack = new_sharded_stack(sizeof(int), 4);
+  ShardedStackLocal *local = sharded_attach(stack);
+  for (int i = 0; i < 8; ++i) {
+    CHECK(sharded_push(local, &i));
+  }
+  CHECK(sharded_central_size(stack) == 0);
+  int value = 8;
+  CHECK(sharded_push(local, &value));
+  CHECK(sharded_central_size(stack) == 4);
+  int expected[] = {8, 3, 2, 1, 0};
+  int out;
+  for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); ++i) {
+    CHECK(sharded_pop(local, &out) && out == expected[i]);
+  }
+  CHECK(sharded_central_size(stack) == 4);
+  CHECK(sharded_pop(local, &out) && out == 7 && sharded_central_size(stack) == 0);
+  CHECK(sharded_detach(local));
+  CHECK(sharded_central_size(stack) == 3);
+  CHECK(sharded_detach(NULL));
+  CHECK(new_sharded_stack(sizeof(int), 0) == NULL);
+  free_sharded_stack(stack);
+}
+
+static void test_threads_conserve_elements(void) {
+  ShardedStack *stack = new_sharded_stack(sizeof(int), BATCH);
+  pthread_t threads[THREADS];
+  Worker workers[THREADS];
+  for (int i = 0; i < THREADS; ++i) {
+    workers[i] = (Worker){stack, i, 0, 0, 0};
+    CHECK(pthread_create(&threads[i], NULL, work, &workers[i]) == 0);
+  }
+  long long pushed = 0;
+  long long popped = 0;
+  size_t pops = 0;
+  for (int i = 0; i < THREADS; ++i) {
+    pthread_join(threads[i], NULL);
+    pushed += workers[i].pushed;
+    popped += workers[i].popped;
+    pops += workers[i].pops;
+  }
+  CHECK(sharded_central_size(stack) == (size_t)THREADS * PER_THREAD - pops);
+  ShardedStackLocal *local = sharded_attach(stack);
+  int out;
+  long long remaining = 0;
+  while (sharded_pop(local, &out)) {
+    remaining += out;
+  }
+  CHECK(popped + remaining == pushed);
+  CHECK(sharded_detach(local));
+  free_sharded_stack(stack);
+}
+
+int main(void) {
+  test_single_thread_batches();
+  test_threads_conserve_elements();
+  return EXIT_SUCCESS;
+}
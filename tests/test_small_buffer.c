@@ -0,0 +1,76 @@
+/**
+ * @file test_small_buffer.c
+ *
+ * @brief Tests for the small buffer inside the stack object.
+ */
+
+#include "../stack.h"
+#include "test.h"
+
+static void test_single_allocation_until_overflow(void) {
+  StackAllocator allocator = {count_alloc, count_realloc, count_free, NULL};
+  StackOptions options = {0};
+  options.element_size = sizeof(int);
+  options.inline_slots = 16;
+  options.allocator = &allocator;
+  allocations = 0;
+  Stack *stack = new_stack_with_options(&options);
+  CHECK(stack && allocations == 1 && capacity(stack) == 16);
+  for (int i = 0; i < 16; ++i) {
+    CHECK(push(stack, &i));
+  }
+  CHECK(allocations == 1);
+  int value = 16;
+  CHECK(push(stack, &value) && allocations == 2 && capacity(stack) > 16);
+  int out;
+  while (size(stack) > 4) {
+    pop_into(stack, &out);
+  }
+  shrink_to_fit(stack);
+  CHECK(capacity(stack) == 16 && *(int *)peek(stack) == 3);
+  for (int i = 0; i < 12; ++i) {
+    CHECK(push(stack, &i));
+  }
+  CHECK(allocations == 2);
+  Stack *copy = clone(stack);
+  CHECK(copy && size(copy) == 16 && *(int *)peek(copy) == 11);
+  free_stack(copy);
+  free_stack(stack);
+}
+
+static void test_inline_slots_until_overflow(void) {
+  Stack *stack = new_small_stack(16, NULL, NULL, NULL);
+  CHECK(stack && capacity(stack) == 16);
+  int values[17];
+  for (int i = 0; i < 16; ++i) {
+    CHECK(push_owned(stack, &values[i]));
+  }
+  CHECK(capacity(stack) == 16);
+  CHECK(push_owned(stack, &values[16]) && capacity(stack) > 16);
+  while (size(stack) > 4) {
+    pop(stack);
+  }
+  shrink_to_fit(stack);
+  CHECK(capacity(stack) == 16 && peek(stack) == &values[3]);
+  free_stack(stack);
+}
+
+static void test_pointer_small_stack(void) {
+  Stack *stack = new_small_stack(4, NULL, NULL, NULL);
+  int values[10];
+  for (int i = 0; i < 10; ++i) {
+    values[i] = i;
+    CHECK(push_owned(stack, &values[i]));
+  }
+  for (int i = 9; i >= 0; --i) {
+    CHECK(pop(stack) == &values[i]);
+  }
+  free_stack(stack);
+}
+
+int main(void) {
+  test_single_allocation_until_overflow();
+  test_inline_slots_until_overflow();
+  test_pointer_small_stack();
+  return EXIT_SUCCESS;
+}
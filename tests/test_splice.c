@@ -0,0 +1,125 @@
+/**
+ * @file test_splice.c
+ *
+ * @brief Tests for stack_splice(), stack_concat(), stack_split_at() and swap_stacks().
+ */
+
+#include "../stack.h"
+#include "test.h"
+#include <stdint.h>
+
+static size_t custom_frees;
+
+static int compare_int(const void *a, const void *b) {
+  return *(const int *)a - *(const int *)b;
+}
+
+static size_t hash_int(const void *element) {
+  return (size_t)*(const int *)element * 2654435761u;
+}
+
+static void *custom_alloc(void *ctx, size_t size) {
+  (void)ctx;
+  return malloc(size);
+}
+
+static void *custom_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+  (void)ctx;
+  (void)old_size;
+  return realloc(ptr, new_size);
+}
+
+static void custom_free(void *ctx, void *ptr, size_t size) {
+  (void)ctx;
+  (void)size;
+  ++custom_frees;
+  free(ptr);
+}
+
+static void test_splice_moves_without_copies(void) {
+  StackOptions options = {0};
+  options.copy_func = copy_int;
+  options.free_func = free;
+  options.cmp_func = compare_int;
+  options.hash_func = hash_int;
+  Stack *a = new_stack_with_options(&options);
+  for (int i = 0; i < 100; ++i) {
+    CHECK(push(a, &i));
+  }
+  size_t before = copies;
+  Stack *b = stack_split_at(a, 60);
+  CHECK(b && size(a) == 60 && size(b) == 40 && copies == before);
+  int key = 70;
+  CHECK(!contains(a, &key) && index_of(b, &key) == 29);
+  CHECK(stack_splice(a, b, 10) == STACK_OK);
+  CHECK(size(a) == 70 && *(int *)peek(a) == 99 && *(int *)peek(b) == 89);
+  CHECK(stack_concat(b, a) == STACK_OK && size(a) == 0 && size(b) == 100);
+  CHECK(stack_split_at(b, 101) == NULL);
+  Stack *bounded = new_bounded_stack(5, false, copy_int, free, NULL);
+  CHECK(stack_splice(bounded, b, 6) == STACK_ERROR_FULL && size(b) == 100);
+  CHECK(stack_splice(bounded, b, 5) == STACK_OK && size(bounded) == 5);
+  Stack *inline_stack = new_inline_stack(sizeof(int), NULL);
+  CHECK(stack_splice(inline_stack, b, 1) == STACK_ERROR_UNSUPPORTED);
+  free_stack(inline_stack);
+  free_stack(bounded);
+  free_stack(a);
+  free_stack(b);
+}
+
+static void test_swap_small_and_heap_buffers(void) {
+  Stack *a = new_small_stack(8, copy_int, free, NULL);
+  Stack *b = new_small_stack(8, copy_int, free, NULL);
+  for (int i = 0; i < 3; ++i) {
+    push(a, &i);
+  }
+  for (int i = 0; i < 30; ++i) {
+    push(b, &i);
+  }
+  CHECK(swap_stacks(a, b));
+  CHECK(size(a) == 30 && size(b) == 3 && *(int *)peek(a) == 29 && *(int *)peek(b) == 2);
+  CHECK(swap_stacks(a, a));
+  int value = 7;
+  CHECK(push(a, &value) && push(b, &value));
+  free_stack(a);
+  free_stack(b);
+  Stack *packed = new_inline_stack(sizeof(int), NULL);
+  Stack *pointers = new_small_stack(8, copy_int, free, NULL);
+  CHECK(!swap_stacks(packed, pointers));
+  free_stack(packed);
+  free_stack(pointers);
+}
+
+static void test_swap_requires_same_allocator(void) {
+  StackAllocator allocator = {custom_alloc, custom_realloc, custom_free, NULL};
+  StackOptions options = {0};
+  options.inline_slots = 8;
+  options.copy_func = copy_int;
+  options.free_func = free;
+  options.allocator = &allocator;
+  Stack *a = new_small_stack(8, copy_int, free, NULL);
+  Stack *b = new_stack_with_options(&options);
+  Stack *c = new_stack_with_options(&options);
+  int value = 1;
+  push(a, &value);
+  push(b, &value);
+  CHECK(!swap_stacks(a, b));
+  CHECK(size(a) == 1 && size(b) == 1);
+  for (int i = 0; i < 20; ++i) {
+    push(c, &i);
+  }
+  CHECK(swap_stacks(b, c));
+  CHECK(size(b) == 20 && size(c) == 1);
+  size_t frees_before = custom_frees;
+  free_stack(a);
+  CHECK(custom_frees == frees_before);
+  free_stack(b);
+  free_stack(c);
+  CHECK(custom_frees == frees_before + 3);
+}
+
+int main(void) {
+  test_splice_moves_without_copies();
+  test_swap_small_and_heap_buffers();
+  test_swap_requires_same_allocator();
+  return EXIT_SUCCESS;
+}
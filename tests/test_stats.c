@@ -0,0 +1,97 @@
+/**
+ * @file test_stats.c
+ *
+ * @brief Tests for the instrumentation counters and growth hooks.
+ *
+ * Build once as is and once with -DSTACK_STATS to cover both configurations.
+ */
+
+#include "../stack.h"
+#include "test.h"
+
+/**
+ * @brief Growth events recorded by record_growth().
+ */
+typedef struct Growth {
+  size_t events;      // Number of calls.
+  size_t last_old;    // old_capacity of the last call.
+  size_t last_new;    // new_capacity of the last call.
+  const Stack *stack; // Stack passed to the last call.
+} Growth;
+
+static void record_growth(const Stack *stack, size_t old_capacity, size_t new_capacity,
+                          void *ctx) {
+  Growth *growth = ctx;
+  CHECK(new_capacity > old_capacity);
+  ++growth->events;
+  growth->last_old = old_capacity;
+  growth->last_new = new_capacity;
+  growth->stack = stack;
+}
+
+#ifdef STACK_STATS
+
+static void test_counters(void) {
+  Stack *stack = new_stack(copy_int, free, NULL);
+  for (int i = 0; i < 100; ++i) {
+    CHECK(push(stack, &i));
+  }
+  for (int i = 0; i < 30; ++i) {
+    free(pop(stack));
+  }
+  clear(stack);
+  StackStats stats;
+  CHECK(get_stack_stats(stack, &stats));
+  CHECK(stats.pushes == 100 && stats.pops == 30 && stats.high_water == 100);
+  CHECK(stats.copy_calls == 100 && stats.free_calls == 70);
+  CHECK(stats.reallocs > 0 && stats.realloc_bytes >= 100 * sizeof(void *));
+  int value = 1;
+  CHECK(push(stack, &value));
+  reset_stack_stats(stack);
+  CHECK(get_stack_stats(stack, &stats));
+  CHECK(stats.pushes == 0 && stats.pops == 0 && stats.high_water == 1);
+  CHECK(!get_stack_stats(NULL, &stats) && !get_stack_stats(stack, NULL));
+  free_stack(stack);
+}
+
+static void test_growth_hook(void) {
+  Stack *stack = new_inline_stack(sizeof(int), NULL);
+  Growth growth = {0};
+  CHECK(set_growth_hook(stack, record_growth, &growth));
+  for (int i = 0; i < 1000; ++i) {
+    CHECK(push(stack, &i));
+  }
+  CHECK(growth.events > 0 && growth.stack == stack);
+  CHECK(growth.last_new == capacity(stack) && growth.last_old < growth.last_new);
+  size_t events = growth.events;
+  CHECK(set_growth_hook(stack, NULL, NULL));
+  for (int i = 0; i < 10000; ++i) {
+    CHECK(push(stack, &i));
+  }
+  CHECK(growth.events == events);
+  free_stack(stack);
+}
+
+int main(void) {
+  test_counters();
+  test_growth_hook();
+  return EXIT_SUCCESS;
+}
+
+#else
+
+int main(void) {
+  Stack *stack = new_stack(copy_int, free, NULL);
+  StackStats stats;
+  Growth growth = {0};
+  CHECK(!get_stack_stats(stack, &stats));
+  CHECK(!set_growth_hook(stack, record_growth, &growth));
+  int value = 1;
+  CHECK(push(stack, &value));
+  reset_stack_stats(stack);
+  CHECK(growth.events == 0);
+  free_stack(stack);
+  return EXIT_SUCCESS;
+}
+
+#endif
@@ -0,0 +1,56 @@
+/**
+ * @file test_typed_stack.c
+ *
+ * @brief Tests for the stacks generated by STACK_DEFINE.
+ */
+
+#include "../typed_stack.h"
+#include "test.h"
+
+/**
+ * @brief Element type for the struct stack.
+ */
+typedef struct Pair {
+  int key;      // Key of the pair.
+  double value; // Value of the pair.
+} Pair;
+
+STACK_DEFINE(IntStack, int)
+STACK_DEFINE(PairStack, Pair)
+
+static void test_int_stack(void) {
+  IntStack stack;
+  IntStack_init(&stack);
+  CHECK(IntStack_is_empty(&stack) && IntStack_peek(&stack) == NULL);
+  for (int i = 0; i < 10000; ++i) {
+    CHECK(IntStack_push(&stack, i));
+  }
+  CHECK(IntStack_size(&stack) == 10000 && IntStack_capacity(&stack) >= 10000);
+  CHECK(*IntStack_peek(&stack) == 9999);
+  int out;
+  for (int i = 9999; i >= 0; --i) {
+    CHECK(IntStack_pop(&stack, &out) && out == i);
+  }
+  CHECK(!IntStack_pop(&stack, &out));
+  IntStack_deinit(&stack);
+}
+
+static void test_struct_stack(void) {
+  PairStack *stack = PairStack_new();
+  CHECK(stack && PairStack_reserve(stack, 100) && PairStack_capacity(stack) >= 100);
+  for (int i = 0; i < 100; ++i) {
+    CHECK(PairStack_push(stack, (Pair){i, i / 2.0}));
+  }
+  PairStack_peek(stack)->value = -1.0;
+  Pair out;
+  CHECK(PairStack_pop(stack, &out) && out.key == 99 && out.value == -1.0);
+  PairStack_clear(stack);
+  CHECK(PairStack_size(stack) == 0);
+  PairStack_free(stack);
+}
+
+int main(void) {
+  test_int_stack();
+  test_struct_stack();
+  return EXIT_SUCCESS;
+}
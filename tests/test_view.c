@@ -0,0 +1,101 @@
+/**
+ * @file test_view.c
+ *
+ * @brief Tests for view(), the borrowing iterators and for_each().
+ */
+
+#include "../stack.h"
+#include "test.h"
+
+static bool sum_until_negative(void *element, void *ctx) {
+  int value = *(int *)element;
+  if (value < 0) {
+    return false;
+  }
+  *(int *)ctx += value;
+  return true;
+}
+
+static void test_pointer_stack_view(void) {
+  Stack *stack = new_stack(copy_int, free, NULL);
+  StackView empty = view(stack);
+  CHECK(empty.data == NULL && empty.size == 0);
+  for (int i = 0; i < 5; ++i) {
+    CHECK(push(stack, &i));
+  }
+  StackView elements = view(stack);
+  CHECK(elements.size == 5 && elements.element_size == 0);
+  void *const *slots = elements.data;
+  for (int i = 0; i < 5; ++i) {
+    CHECK(*(int *)slots[i] == i);
+  }
+  CHECK(slots[4] == peek(stack));
+  free_stack(stack);
+  CHECK(view(NULL).size == 0);
+}
+
+static void test_inline_iterators(void) {
+  Stack *stack = new_inline_stack(sizeof(int), NULL);
+  void *element;
+  StackIterator it = iter_top(stack);
+  CHECK(!iter_next(&it, &element));
+  for (int i = 0; i < 100; ++i) {
+    CHECK(push(stack, &i));
+  }
+  StackView elements = view(stack);
+  CHECK(elements.element_size == sizeof(int) && ((const int *)elements.data)[42] == 42);
+  int expected = 99;
+  for (it = iter_top(stack); iter_next(&it, &element); --expected) {
+    CHECK(*(int *)element == expected);
+  }
+  CHECK(expected == -1);
+  expected = 0;
+  for (it = iter_bottom(stack); iter_next(&it, &element); ++expected) {
+    CHECK(*(int *)element == expected);
+  }
+  CHECK(expected == 100 && !iter_next(&it, &element));
+  free_stack(stack);
+}
+
+static void test_for_each(void) {
+  Stack *stack = new_inline_stack(sizeof(int), NULL);
+  int values[] = {-1, 1, 2, 3};
+  CHECK(push_n(stack, values, 4) == 4);
+  int sum = 0;
+  CHECK(!for_each(stack, sum_until_negative, &sum) && sum == 6);
+  clear(stack);
+  CHECK(push_n(stack, values + 1, 3) == 3);
+  sum = 0;
+  CHECK(for_each(stack, sum_until_negative, &sum) && sum == 6);
+  free_stack(stack);
+}
+
+static void test_drop_oldest_has_no_view(void) {
+  StackOptions options = {0};
+  options.element_size = sizeof(int);
+  options.bound = 4;
+  options.drop_oldest = true;
+  Stack *stack = new_stack_with_options(&options);
+  for (int i = 0; i < 23; ++i) {
+    CHECK(push(stack, &i));
+  }
+  StackView elements = view(stack);
+  CHECK(elements.data == NULL && elements.size == 0);
+  void *element;
+  StackIterator it = iter_bottom(stack);
+  for (int i = 19; i < 23; ++i) {
+    CHECK(iter_next(&it, &element) && *(int *)element == i);
+  }
+  CHECK(!iter_next(&it, &element));
+  it = iter_top(stack);
+  CHECK(iter_next(&it, &element) && *(int *)element == 22);
+  free_stack(stack);
+}
+
+int main(void) {
+  test_pointer_stack_view();
+  test_inline_iterators();
+  test_for_each();
+  test_drop_oldest_has_no_view();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,119 @@
+/**
+ * @file test_ws_deque.c
+ *
+ * @brief Tests for the work-stealing deque.
+ */
+
+#include "../ws_deque.h"
+#include "test.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define THIEVES 4
+#define ELEMENTS 100000
+
+static atomic_int seen[ELEMENTS];
+static atomic_bool done;
+
+static void take(int *element) {
+  CHECK(element && *element >= 0 && *element < ELEMENTS);
+  CHECK(atomic_fetch_add(&seen[*element], 1) == 0);
+  free(element);
+}
+
+static void *steal_until_done(void *arg) {
+  WorkStealingDeque *deque = arg;
+  while (!atomic_load(&done) || !ws_is_empty(deque)) {
+    int *element = ws_steal(deque);
+    if (element) {
+      take(element);
+    }
+  }
+  return NULL;
+}
+
+static void test_pop_and_steal_ends(void) {
+  WorkStealingDeque *deque = new_ws_deque(copy_int, free_int);
+  CHECK(ws_is_empty(deque) && ws_pop(deque) == NULL && ws_steal(deque) == NULL);
+  for (int i = 0; i < 10; ++i) {
+    CHECK(ws_push(deque, &i));
+  }
+  int *top = ws_pop(deque);
+  int *bottom = ws_steal(deque);
+  CHECK(top && *top == 9 && bottom && *bottom == 0);
+  free(top);
+  free(bottom);
+  CHECK(ws_size(deque) == 8);
+  free_ws_deque(deque);
+  CHECK(atomic_load(&frees) == 8);
+  free_ws_deque(NULL);
+}
+
+static void test_growth_keeps_order(void) {
+  WorkStealingDeque *deque = new_ws_deque(copy_int, free_int);
+  int next = 0;
+  int oldest = 0;
+  for (int round = 0; round < 20; ++round) {
+    for (int i = 0; i < 50; ++i, ++next) {
+      CHECK(ws_push(deque, &next));
+    }
+    for (int i = 0; i < 30; ++i, ++oldest) {
+      int *element = ws_steal(deque);
+      CHECK(element && *element == oldest);
+      free(element);
+    }
+  }
+  CHECK(ws_size(deque) == (size_t)(next - oldest));
+  while (next > oldest) {
+    int *element = ws_pop(deque);
+    CHECK(element && *element == --next);
+    free(element);
+  }
+  CHECK(ws_is_empty(deque));
+  free_ws_deque(deque);
+}
+
+static void test_move_only(void) {
+  WorkStealingDeque *deque = new_ws_deque(NULL, NULL);
+  int value = 1;
+  CHECK(!ws_push(deque, &value));
+  CHECK(ws_push_owned(deque, &value) && ws_steal(deque) == &value);
+  free_ws_deque(deque);
+}
+
+static void test_thieves_take_each_element_once(void) {
+  WorkStealingDeque *deque = new_ws_deque(copy_int, free_int);
+  pthread_t thieves[THIEVES];
+  for (int i = 0; i < THIEVES; ++i) {
+    CHECK(pthread_create(&thieves[i], NULL, steal_until_done, deque) == 0);
+  }
+  for (int i = 0; i < ELEMENTS; ++i) {
+    CHECK(ws_push(deque, &i));
+    if (i % 4 == 0) {
+      int *element = ws_pop(deque);
+      if (element) {
+        take(element);
+      }
+    }
+  }
+  int *element;
+  while ((element = ws_pop(deque))) {
+    take(element);
+  }
+  atomic_store(&done, true);
+  for (int i = 0; i < THIEVES; ++i) {
+    pthread_join(thieves[i], NULL);
+  }
+  for (int i = 0; i < ELEMENTS; ++i) {
+    CHECK(atomic_load(&seen[i]) == 1);
+  }
+  free_ws_deque(deque);
+}
+
+int main(void) {
+  test_pop_and_steal_ends();
+  test_growth_keeps_order();
+  test_move_only();
+  test_thieves_take_each_element_once();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,153 @@
+/**
+ * @file typed_stack.h
+ *
+ * @brief Header-only, type-specialized stack generator.
+ *
+ * STACK_DEFINE(Name, T) emits a stack of T values whose operations are static
+ * inline functions, so the compiler can inline push, pop and peek and
+ * specialize them for the element type. Semantics follow stack.h inline
+ * stacks: elements are stored by value, push returns false on allocation
+ * failure and pop copies the top element out.
+ *
+ * Example:
+ *
+ *   STACK_DEFINE(IntStack, int)
+ *
+ *   IntStack s;
+ *   IntStack_init(&s);
+ *   IntStack_push(&s, 42);
+ *   int top;
+ *   IntStack_pop(&s, &top);
+ *   IntStack_deinit(&s);
+ *
+ * @author trigologiaa
+ */
+
+#ifndef TYPED_STACK_H
+
+#define TYPED_STACK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * Initial capacity for typed stacks, matching stack.c.
+ */
+#define TYPED_STACK_INITIAL_CAPACITY 8
+
+/**
+ * @brief Defines a stack type Name holding elements of type T.
+ *
+ * Generated API, where Name is the type name:
+ *
+ * - void Name_init(Name *s) — initializes an empty stack in place.
+ * - void Name_deinit(Name *s) — releases the buffer of an initialized stack.
+ * - Name *Name_new(void) — allocates an empty stack, or NULL on failure.
+ * - void Name_free(Name *s) — deinitializes and frees a Name_new() stack.
+ * - bool Name_reserve(Name *s, size_t n) — ensures room for n elements.
+ * - bool Name_push(Name *s, T value) — pushes value, false on failure.
+ * - bool Name_pop(Name *s, T *out) — pops into out, false if empty.
+ * - T *Name_peek(const Name *s) — top element, or NULL if empty.
+ * - void Name_clear(Name *s) — removes all elements.
+ * - bool Name_is_empty(const Name *s) — true if the stack is empty.
+ * - size_t Name_size(const Name *s) — number of elements.
+ * - size_t Name_capacity(const Name *s) — allocated capacity.
+ *
+ * @param Name Name of the generated struct type and function prefix.
+ * @param T Element type.
+ */
+#define STACK_DEFINE(Name, T)                                                                      \
+  typedef struct Name {                                                                            \
+    T *data;                                                                                       \
+    size_t size;                                                                                   \
+    size_t capacity;                                                                               \
+  } Name;                                                                                          \
+                                                                                                   \
+  static inline void Name##_init(Name *s) {                                                        \
+    s->data = NULL;                                                                                \
+    s->size = 0;                                                                                   \
+    s->capacity = 0;                                                                               \
+  }                                                                                                \
+                                                                                                   \
+  static inline void Name##_deinit(Name *s) {                                                      \
+    free(s->data);                                                                                 \
+    Name##_init(s);                                                                                \
+  }                                                                                                \
+                                                                                                   \
+  static inline Name *Name##_new(void) {                                                           \
+    Name *s = malloc(sizeof(Name));                                                                \
+    if (s) {                                                                                       \
+      Name##_init(s);                                                                              \
+    }                                                                                              \
+    return s;                                                                                      \
+  }                                                                                                \
+                                                                                                   \
+  static inline void Name##_free(Name *s) {                                                        \
+    if (!s) {                                                                                      \
+      return;                                                                                      \
+    }                                                                                              \
+    Name##_deinit(s);                                                                              \
+    free(s);                                                                                       \
+  }                                                                                                \
+                                                                                                   \
+  static inline bool Name##_reserve(Name *s, size_t n) {                                           \
+    if (n <= s->capacity) {                                                                        \
+      return true;                                                                                 \
+    }                                                                                              \
+    if (n > SIZE_MAX / sizeof(T)) {                                                                \
+      return false;                                                                                \
+    }                                                                                              \
+    T *data = realloc(s->data, n * sizeof(T));                                                     \
+    if (!data) {                                                                                   \
+      return false;                                                                                \
+    }                                                                                              \
+    s->data = data;                                                                                \
+    s->capacity = n;                                                                               \
+    return true;                                                                                   \
+  }                                                                                                \
+                                                                                                   \
+  static inline bool Name##_push(Name *s, T value) {                                               \
+    if (s->size == s->capacity) {                                                                  \
+      size_t n = s->capacity ? s->capacity * 2 : TYPED_STACK_INITIAL_CAPACITY;                     \
+      if (n < s->capacity || !Name##_reserve(s, n)) {                                              \
+        return false;                                                                              \
+      }                                                                                            \
+    }                                                                                              \
+    s->data[s->size++] = value;                                                                    \
+    return true;                                                                                   \
+  }                                                                                                \
+                                                                                                   \
+  static inline bool Name##_pop(Name *s, T *out) {                                                 \
+    if (s->size == 0) {                                                                            \
+      return false;                                                                                \
+    }                                                                                              \
+    --s->size;                                                                                     \
+    if (out) {                                                                                     \
+      *out = s->data[s->size];                                                                     \
+    }                                                                                              \
+    return true;                                                                                   \
+  }                                                                                                \
+                                                                                                   \
+  static inline T *Name##_peek(const Name *s) {                                                    \
+    return s->size ? &s->data[s->size - 1] : NULL;                                                 \
+  }                                                                                                \
+                                                                                                   \
+  static inline void Name##_clear(Name *s) {                                                       \
+    s->size = 0;                                                                                   \
+  }                                                                                                \
+                                                                                                   \
+  static inline bool Name##_is_empty(const Name *s) {                                              \
+    return s->size == 0;                                                                           \
+  }                                                                                                \
+                                                                                                   \
+  static inline size_t Name##_size(const Name *s) {                                                \
+    return s->size;                                                                                \
+  }                                                                                                \
+                                                                                                   \
+  static inline size_t Name##_capacity(const Name *s) {                                            \
+    return s->capacity;                                                                            \
+  }
+
+#endif
@@ -0,0 +1,315 @@
+/**
+ * @file ws_deque.c
+ *
+ * @brief Implementation of a Chase-Lev work-stealing deque.
+ *
+ * This file contains the internal implementation of the WorkStealingDeque
+ * defined in ws_deque.h, following the C11 formulation by Le, Pop, Cohen and
+ * Zappa Nardelli ("Correct and Efficient Work-Stealing for Weak Memory
+ * Models"). The owner works on bottom, thieves advance top, and only the race
+ * for the last element needs a compare-and-swap on the owner side.
+ */
+
+#include "ws_deque.h"
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * Initial number of slots in the circular buffer (a power of two).
+ */
+#define WS_DEQUE_INITIAL_CAPACITY 64
+
+/**
+ * Assumed size of a cache line, used to keep the owner and thief ends apart.
+ */
+#define CACHE_LINE 64
+
+/**
+ * @struct Buffer
+ *
+ * @brief Circular array of element slots.
+ *
+ * Buffers replaced by a resize are kept on the retired list until the deque is
+ * freed, since thieves may still be reading them.
+ */
+typedef struct Buffer {
+  int64_t capacity;        // Number of slots (a power of two).
+  struct Buffer *retired;  // Next retired buffer.
+  _Atomic(void *) slots[]; // Element slots, indexed modulo capacity.
+} Buffer;
+
+/**
+ * @struct WorkStealingDeque
+ *
+ * @brief Internal representation of the work-stealing deque.
+ *
+ * Elements live in slots [top, bottom) of the current buffer. bottom is only
+ * written by the owner; top only moves forward, by compare-and-swap.
+ */
+struct WorkStealingDeque {
+  alignas(CACHE_LINE) _Atomic int64_t top;    // Next element to steal.
+  alignas(CACHE_LINE) _Atomic int64_t bottom; // Next free slot for the owner.
+  _Atomic(Buffer *) buffer;                   // Current circular buffer.
+  Buffer *retired;                            // Buffers replaced by a resize.
+  StackCopyFunc copy;                         // Function to copy elements.
+  StackFreeFunc free_func;                    // Function to free elements.
+};
+
+/**
+ * @brief Allocates a buffer with the given number of slots.
+ *
+ * @param capacity Number of slots (a power of two).
+ *
+ * @return Pointer to the new Buffer, or NULL on allocation failure.
+ */
+static Buffer *new_buffer(int64_t capacity) {
+  Buffer *buffer = malloc(sizeof(Buffer) + (size_t)capacity * sizeof(_Atomic(void *)));
+  if (!buffer) {
+    return NULL;
+  }
+  buffer->capacity = capacity;
+  buffer->retired = NULL;
+  return buffer;
+}
+
+/**
+ * @brief Returns the slot for a deque index.
+ *
+ * @param buffer Pointer to the Buffer.
+ * @param index Deque index.
+ *
+ * @return Pointer to the slot.
+ */
+static inline _Atomic(void *) *buffer_slot(Buffer *buffer, int64_t index) {
+  return &buffer->slots[index & (buffer->capacity - 1)];
+}
+
+/**
+ * @brief Doubles the buffer of the deque.
+ *
+ * Owner thread only. The old buffer is retired, not freed.
+ *
+ * @param deque Pointer to the WorkStealingDeque.
+ * @param old Current buffer.
+ * @param top Current top index.
+ * @param bottom Current bottom index.
+ *
+ * @return Pointer to the new Buffer, or NULL on allocation failure.
+ */
+static Buffer *grow(WorkStealingDeque *deque, Buffer *old, int64_t top, int64_t bottom) {
+  Buffer *buffer = new_buffer(old->capacity * 2);
+  if (!buffer) {
+    return NULL;
+  }
+  for (int64_t i = top; i < bottom; ++i) {
+    void *element = atomic_load_explicit(buffer_slot(old, i), memory_order_relaxed);
+    atomic_store_explicit(buffer_slot(buffer, i), element, memory_order_relaxed);
+  }
+  old->retired = deque->retired;
+  deque->retired = old;
+  atomic_store_explicit(&deque->buffer, buffer, memory_order_release);
+  return buffer;
+}
+
+/**
+ * @brief Initializes a new work-stealing deque structure.
+ *
+ * @param copy_func Function to copy elements (may be NULL).
+ * @param free_func Function to free elements (may be NULL).
+ *
+ * @return Pointer to the new WorkStealingDeque, or NULL on allocation failure.
+ */
+WorkStealingDeque *new_ws_deque(StackCopyFunc copy_func, StackFreeFunc free_func) {
+  WorkStealingDeque *deque = aligned_alloc(_Alignof(WorkStealingDeque),
+                                           sizeof(WorkStealingDeque));
+  if (!deque) {
+    return NULL;
+  }
+  Buffer *buffer = new_buffer(WS_DEQUE_INITIAL_CAPACITY);
+  if (!buffer) {
+    free(deque);
+    return NULL;
+  }
+  atomic_init(&deque->top, 0);
+  atomic_init(&deque->bottom, 0);
+  atomic_init(&deque->buffer, buffer);
+  deque->retired = NULL;
+  deque->copy = copy_func;
+  deque->free_func = free_func;
+  return deque;
+}
+
+/**
+ * @brief Frees all memory associated with the deque.
+ *
+ * Calls free_func for each remaining element, then releases the current and
+ * retired buffers.
+ *
+ * @param deque Pointer to the WorkStealingDeque.
+ */
+void free_ws_deque(WorkStealingDeque *deque) {
+  if (!deque) {
+    return;
+  }
+  Buffer *buffer = atomic_load_explicit(&deque->buffer, memory_order_relaxed);
+  int64_t top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+  int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+  for (int64_t i = top; deque->free_func && i < bottom; ++i) {
+    deque->free_func(atomic_load_explicit(buffer_slot(buffer, i), memory_order_relaxed));
+  }
+  free(buffer);
+  while (deque->retired) {
+    Buffer *next = deque->retired->retired;
+    free(deque->retired);
+    deque->retired = next;
+  }
+  free(deque);
+}
+
+/**
+ * @brief Pushes a copy of an element onto the top of the deque.
+ *
+ * The element is copied using the user-supplied copy function.
+ *
+ * @param deque Pointer to the WorkStealingDeque.
+ * @param element Pointer to the element to push.
+ *
+ * @return true if the element was pushed, false otherwise.
+ */
+bool ws_push(WorkStealingDeque *deque, const void *element) {
+  if (!deque || !deque->copy) {
+    return false;
+  }
+  void *copy = deque->copy(element);
+  if (!copy) {
+    return false;
+  }
+  if (!ws_push_owned(deque, copy)) {
+    if (deque->free_func) {
+      deque->free_func(copy);
+    }
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Pushes an element onto the top of the deque, taking ownership of it.
+ *
+ * Grows the buffer when it is full.
+ *
+ * @param deque Pointer to the WorkStealingDeque.
+ * @param element Pointer to the element to push.
+ *
+ * @return true if the element was pushed, false on allocation failure.
+ */
+bool ws_push_owned(WorkStealingDeque *deque, void *element) {
+  if (!deque) {
+    return false;
+  }
+  int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+  int64_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+  Buffer *buffer = atomic_load_explicit(&deque->buffer, memory_order_relaxed);
+  if (bottom - top > buffer->capacity - 1) {
+    buffer = grow(deque, buffer, top, bottom);
+    if (!buffer) {
+      return false;
+    }
+  }
+  atomic_store_explicit(buffer_slot(buffer, bottom), element, memory_order_relaxed);
+  atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_release);
+  return true;
+}
+
+/**
+ * @brief Removes and returns the top element of the deque.
+ *
+ * Races with thieves only when a single element is left.
+ *
+ * @param deque Pointer to the WorkStealingDeque.
+ *
+ * @return Pointer to the removed element. Caller must free it. Returns NULL
+ * if the deque is empty.
+ */
+void *ws_pop(WorkStealingDeque *deque) {
+  if (!deque) {
+    return NULL;
+  }
+  int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+  Buffer *buffer = atomic_load_explicit(&deque->buffer, memory_order_relaxed);
+  atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+  atomic_thread_fence(memory_order_seq_cst);
+  int64_t top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+  if (top > bottom) {
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    return NULL;
+  }
+  void *element = atomic_load_explicit(buffer_slot(buffer, bottom), memory_order_relaxed);
+  if (top == bottom) {
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                 memory_order_seq_cst, memory_order_relaxed)) {
+      element = NULL;
+    }
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+  }
+  return element;
+}
+
+/**
+ * @brief Removes and returns the bottom element of the deque.
+ *
+ * Retries when another thief or the owner wins the race for the same element.
+ *
+ * @param deque Pointer to the WorkStealingDeque.
+ *
+ * @return Pointer to the removed element. Caller must free it. Returns NULL
+ * if the deque is empty.
+ */
+void *ws_steal(WorkStealingDeque *deque) {
+  if (!deque) {
+    return NULL;
+  }
+  for (;;) {
+    int64_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    if (top >= bottom) {
+      return NULL;
+    }
+    Buffer *buffer = atomic_load_explicit(&deque->buffer, memory_order_acquire);
+    void *element = atomic_load_explicit(buffer_slot(buffer, top), memory_order_relaxed);
+    if (atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst,
+                                                memory_order_relaxed)) {
+      return element;
+    }
+  }
+}
+
+/**
+ * @brief Checks if the deque has no elements.
+ *
+ * @param deque Pointer to the WorkStealingDeque.
+ *
+ * @return true if empty, false otherwise.
+ */
+bool ws_is_empty(const WorkStealingDeque *deque) {
+  return ws_size(deque) == 0;
+}
+
+/**
+ * @brief Returns the number of elements in the deque.
+ *
+ * @param deque Pointer to the WorkStealingDeque.
+ *
+ * @return Number of elements.
+ */
+size_t ws_size(const WorkStealingDeque *deque) {
+  if (!deque) {
+    return 0;
+  }
+  int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+  int64_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+  return bottom > top ? (size_t)(bottom - top) : 0;
+}
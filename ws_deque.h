@@ -0,0 +1,126 @@
+/**
+ * @file ws_deque.h
+ *
+ * @brief Chase-Lev work-stealing deque in C.
+ *
+ * Provides a growable deque for task schedulers: the owning thread pushes and
+ * pops at the top like a stack, touching only its own end in the common case,
+ * while any number of thief threads concurrently steal the oldest elements
+ * from the bottom.
+ *
+ * Element ownership follows stack.h: push copies the element with the
+ * user-supplied StackCopyFunc, pop and steal hand the element to the caller,
+ * and StackFreeFunc releases whatever is left when the deque is freed.
+ *
+ * @author trigologiaa
+ */
+
+#ifndef WS_DEQUE_H
+
+#define WS_DEQUE_H
+
+#include "stack.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @typedef WorkStealingDeque
+ *
+ * @brief Opaque struct representing a work-stealing deque.
+ */
+typedef struct WorkStealingDeque WorkStealingDeque;
+
+/**
+ * @brief Creates a new work-stealing deque.
+ *
+ * @param copy_func Function to copy elements (may be NULL for a move-only
+ * deque filled with ws_push_owned()).
+ * @param free_func Function to free elements (may be NULL).
+ *
+ * @return Pointer to the new WorkStealingDeque, or NULL on allocation failure.
+ */
+WorkStealingDeque *new_ws_deque(StackCopyFunc copy_func, StackFreeFunc free_func);
+
+/**
+ * @brief Frees all memory associated with the deque.
+ *
+ * Calls free_func for each remaining element. No other thread may use the
+ * deque concurrently.
+ *
+ * @param deque Pointer to the WorkStealingDeque.
+ */
+void free_ws_deque(WorkStealingDeque *deque);
+
+/**
+ * @brief Pushes a copy of an element onto the top of the deque.
+ *
+ * Owner thread only.
+ *
+ * @param deque Pointer to the WorkStealingDeque.
+ * @param element Pointer to the element to push.
+ *
+ * @return true if the element was pushed, false on allocation failure or for
+ * move-only deques.
+ */
+bool ws_push(WorkStealingDeque *deque, const void *element);
+
+/**
+ * @brief Pushes an element onto the top of the deque, taking ownership of it.
+ *
+ * copy_func is not called. Owner thread only.
+ *
+ * @param deque Pointer to the WorkStealingDeque.
+ * @param element Pointer to the element to push.
+ *
+ * @return true if the element was pushed, false on allocation failure (the
+ * caller then still owns element).
+ */
+bool ws_push_owned(WorkStealingDeque *deque, void *element);
+
+/**
+ * @brief Removes and returns the top (most recently pushed) element.
+ *
+ * Owner thread only.
+ *
+ * @param deque Pointer to the WorkStealingDeque.
+ *
+ * @return Pointer to the removed element. Caller must free it. Returns NULL
+ * if the deque is empty.
+ */
+void *ws_pop(WorkStealingDeque *deque);
+
+/**
+ * @brief Removes and returns the bottom (oldest) element.
+ *
+ * Safe to call from any thread, concurrently with the owner and other thieves.
+ *
+ * @param deque Pointer to the WorkStealingDeque.
+ *
+ * @return Pointer to the removed element. Caller must free it. Returns NULL
+ * if the deque is empty.
+ */
+void *ws_steal(WorkStealingDeque *deque);
+
+/**
+ * @brief Checks if the deque is empty.
+ *
+ * May be stale while other threads are stealing.
+ *
+ * @param deque Pointer to the WorkStealingDeque.
+ *
+ * @return true if empty, false otherwise.
+ */
+bool ws_is_empty(const WorkStealingDeque *deque);
+
+/**
+ * @brief Returns the number of elements in the deque.
+ *
+ * Approximate while other threads are stealing.
+ *
+ * @param deque Pointer to the WorkStealingDeque.
+ *
+ * @return Number of elements.
+ */
+size_t ws_size(const WorkStealingDeque *deque);
+
+#endif